@@ -0,0 +1,73 @@
+/*
+
+	Acceleration
+	
+	Velocity-sensitive rotary encoder acceleration
+	
+*/
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "Acceleration.h"
+#include "RTC.h"
+
+
+/*	Acceleration
+
+*/
+Acceleration::Acceleration() :
+	fRate(0),
+	fLastTime(0),
+	fCurve(1 /* moderate */)
+{
+}
+
+
+/*	Select
+	Select acceleration curve; return whether it exists
+*/
+bool Acceleration::Select(
+	const uint8_t	curve
+	)
+{
+if (curve >= kCurves.size()) return false;
+
+fCurve = curve;
+return true;
+}
+
+
+/*	()
+	Account for detents turned at the given time; return the multiplier for them
+*/
+unsigned Acceleration::operator()(
+	const signed	indents,
+	const uint32_t	time
+	)
+{
+const uint32_t elapsed = RTC::Elapsed(fLastTime, time);
+fLastTime = time;
+
+// starting from rest?
+if (elapsed > kIdleTicks)
+	fRate = 0;
+
+else {
+	// instantaneous rate
+	/* at most 64 detents per report keeps this within 32 bits */
+	const uint32_t detents = std::min<uint32_t>(std::abs(indents), 64);
+	const uint32_t rate = (detents * RTC::kFrequency << kFractionBits) / std::max<uint32_t>(elapsed, 1);
+	
+	// smooth
+	fRate = fRate - (fRate >> kFilterShift) + (rate >> kFilterShift);
+	}
+
+// highest step the rate has reached
+const Curve &curve = kCurves[fCurve];
+unsigned multiplier = curve[0].multiplier;
+for (const Step &step: curve)
+	if (fRate >> kFractionBits >= step.rate) multiplier = step.multiplier;
+
+return multiplier;
+}
@@ -0,0 +1,69 @@
+/*
+
+	Acceleration
+	
+	Velocity-sensitive rotary encoder acceleration
+	
+*/
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+
+/*	Acceleration
+	Scale encoder detents by how fast the knob is turning
+	
+	The detent rate is estimated in fixed point (detents per second, 8 fractional bits) and smoothed with an
+	exponential filter, so a single quick flick doesn't jump the frequency.
+*/
+struct Acceleration {
+	/*	Step
+		Multiplier applied from a detent rate upward
+	*/
+	struct Step {
+		uint16_t	rate;		// detents per second
+		uint8_t		multiplier;
+		};
+	
+	static constexpr unsigned kSteps = 4;
+	using Curve = std::array<Step, kSteps>;
+	
+	// selectable through the feature report; curve 0 disables acceleration
+	static constexpr std::array<Curve, 3> kCurves = {{
+		/* off */	{{ { 0, 1 }, { 0, 1 }, { 0, 1 }, { 0, 1 } }},
+		/* moderate */	{{ { 0, 1 }, { 12, 2 }, { 24, 4 }, { 48, 8 } }},
+		/* aggressive */ {{ { 0, 1 }, { 8, 4 }, { 16, 10 }, { 32, 20 } }}
+		}};
+	
+	static constexpr unsigned kFractionBits = 8;
+	static constexpr unsigned kFilterShift = 2;	// new estimate weighs 1/4
+	static constexpr uint32_t kIdleTicks = 32768 / 4; // turning resumes from rest after 250 ms
+
+protected:
+	uint32_t	fRate;		// smoothed detents per second << kFractionBits
+	uint32_t	fLastTime;	// RTC ticks at the last detent
+	uint8_t		fCurve;
+
+public:
+	static constexpr bool Monotonic(const Curve &curve) {
+				for (unsigned i = 1; i < kSteps; i++)
+					if (curve[i].rate < curve[i - 1].rate || curve[i].multiplier < curve[i - 1].multiplier) return false;
+				return true;
+				}
+	
+
+			Acceleration();
+	
+	uint8_t		Selected() const { return fCurve; }
+	bool		Select(uint8_t curve);
+	
+	unsigned	operator()(signed indents, uint32_t time);
+	};
+static_assert(
+	Acceleration::Monotonic(Acceleration::kCurves[0]) &&
+	Acceleration::Monotonic(Acceleration::kCurves[1]) &&
+	Acceleration::Monotonic(Acceleration::kCurves[2]),
+	"acceleration curves must be increasing"
+	);
@@ -0,0 +1,47 @@
+/*
+
+	Capabilities
+	
+	Capabilities Feature report, shared by the firmware and the host
+	
+	Tells the host what this firmware can do, so it can pick the fastest way of talking to the panel that both
+	sides know without trying things.  Firmware without this report only sends its two 20-bit values.  Fields
+	are little-endian at fixed offsets; later protocol versions only add fields at the end, or feature bits.
+	
+*/
+
+#pragma once
+
+#include <cstdint>
+
+
+namespace Capabilities {
+	/*	Offset
+		Where each field starts, counting the report ID as byte 0
+	*/
+	enum Offset : uint8_t {
+		kOffsetProtocol = 1,	// uint8_t: kProtocol
+		kOffsetStateLayout = 2,	// uint8_t: State::kLayout of the state report, if kFeatureStateReport
+		kOffsetPages = 3,	// uint8_t: radio pages
+		kOffsetInterval = 4,	// uint8_t: Endpoint 1 IN polling interval, in 1 ms frames
+		kOffsetCurves = 5,	// uint8_t: encoder acceleration curves
+		kOffsetFeatures = 6	// uint16_t: Feature bits
+		};
+	
+	
+	/*	Feature
+		Optional parts of the protocol
+	*/
+	enum Feature : uint16_t {
+		kFeatureStateReport = 1 << 0,	// Endpoint 1 IN sends the State.h report instead of the two values
+		kFeatureSync = 1 << 1,		// GET_REPORT answers the Input reports
+		kFeatureIdleRate = 1 << 2,	// SET_IDLE and the settings idle rate repeat the state
+		kFeatureLowLatency = 1 << 3,	// settings can select low-latency encoder sampling
+		kFeatureProfile = 1 << 4,	// profile Feature report counts cycles (INSTRUMENTATION builds)
+		kFeatureLog = 1 << 5,		// log Feature report
+		kFeatureDiagnostics = 1 << 6	// vendor bulk diagnostics interface
+		};
+	
+	constexpr uint8_t kProtocol = 1;
+	constexpr uint8_t kReportLength = 8;	// including the ID
+	}
@@ -0,0 +1,230 @@
+/*
+
+	Channel
+
+	Radio frequencies as channel indices, as the panel holds and steps its values
+
+	A band is a run of blocks, `spacing` kHz apart from `first`, each holding 2^`shift` channel names
+	`offset` kHz apart.  A 25 kHz COM channel is a block of one; 8.33 kHz COM channel names come four to a
+	25 kHz block (118.000, .005, .010, .015, then 118.025).  An index fits in 12 bits for any band, and
+	stepping through a band is adding to it.  Converting an index to kHz takes a shift, a mask and two
+	multiplies; converting kHz to an index multiplies by a reciprocal instead of dividing, checked for
+	every channel of every band at compile time (in Panel.cc, so it's only done once).  Reports, the saved
+	state and the bridge carry kHz: the host never sees an index.
+	
+	Turning a knob steps through the band the way the radio does: the coarse knob steps whole MHz and the
+	fine knob steps within the MHz, each wrapping around without carrying into the other.  ADF bands have
+	no such digits, and wrap around as a whole.  Any number of detents takes the same few operations.
+
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <initializer_list>
+
+
+namespace Channel {
+	/*	Band
+		Radio bands
+	*/
+	enum Band : uint8_t {
+		kCOM25,			// VHF COM, 25 kHz spacing
+		kCOM833,		// VHF COM, 8.33 kHz channel names
+		kNAV,			// VHF NAV, 50 kHz spacing
+		kADF,			// LF/MF ADF, 1 kHz spacing
+		kBands
+		};
+	
+	
+	/*	Knob
+		Which knob turned
+	*/
+	enum Knob : uint8_t {
+		kCoarse,
+		kFine
+		};
+	
+	
+	/*	Wrap
+		What a band does past its ends
+	*/
+	enum Wrap : uint8_t {
+		kWrapDigits,		// each knob wraps around its own digits
+		kWrapBand		// the whole band wraps around
+		};
+
+
+	/*	Description
+		Where a band's channels are
+	*/
+	struct Description {
+		uint32_t	first;		// kHz
+		uint16_t	count;		// channels
+		uint8_t		spacing,	// kHz between blocks
+				shift,		// log2 channels per block
+				offset;		// kHz between the channels of a block
+		uint32_t	reciprocal;	// 2^kReciprocalShift / spacing, rounded up
+		uint16_t	coarse;		// channels per coarse knob detent
+		uint8_t		fine;		// channels per fine knob detent
+		Wrap		wrap;
+		};
+
+	constexpr unsigned kReciprocalShift = 24;
+	constexpr uint8_t kIndexBits = 12;
+
+	constexpr uint32_t Reciprocal(uint8_t spacing) { return ((1u << kReciprocalShift) + spacing - 1) / spacing; }
+
+	constexpr Description kDescriptions[kBands] = {
+		{ 118000, 760, 25, 0, 0, Reciprocal(25), 40, 1, kWrapDigits },	// 118.000 to 136.975
+		{ 118000, 3040, 25, 2, 5, Reciprocal(25), 160, 4, kWrapDigits }, // 118.000 to 136.990; fine knob in 25 kHz
+		{ 108000, 200, 50, 0, 0, Reciprocal(50), 20, 1, kWrapDigits },	// 108.00 to 117.95
+		{ 190, 1561, 1, 0, 0, Reciprocal(1), 100, 1, kWrapBand }	// 190 to 1750 kHz; coarse knob in 100 kHz
+		};
+
+
+	/*	Frequency
+		kHz of a channel
+	*/
+	constexpr uint32_t Frequency(
+		Band		band,
+		uint16_t	index
+		)
+	{
+	const Description &d = kDescriptions[band];
+
+	return d.first + (index >> d.shift) * d.spacing + (index & ((1u << d.shift) - 1)) * d.offset;
+	}
+
+
+	/*	Index
+		Channel at or below a frequency, kept within the band
+	*/
+	constexpr uint16_t Index(
+		Band		band,
+		uint32_t	kHz
+		)
+	{
+	const Description &d = kDescriptions[band];
+
+	if (kHz <= d.first) return 0;
+	if (kHz >= Frequency(band, d.count - 1)) return d.count - 1;
+
+	// which block, and how far into it
+	const uint32_t above = kHz - d.first;
+	const uint32_t block = static_cast<uint32_t>((static_cast<uint64_t>(above) * d.reciprocal) >> kReciprocalShift);
+	const uint32_t into = above - block * d.spacing;
+
+	// which channel of the block; past the last, it is the last
+	/* The offsets are 5 kHz, so a block has at most 5 channels' room: multiplying by 52/256 divides by 5 there. */
+	uint32_t name = d.shift ? (into * 52) >> 8 : 0;
+	if (name > (1u << d.shift) - 1) name = (1u << d.shift) - 1;
+
+	return static_cast<uint16_t>(block << d.shift | name);
+	}
+
+
+	/*	Checked
+		Whether every channel of every band converts to kHz and back to itself, and kHz between channels to
+		the one below
+	*/
+	constexpr bool Checked()
+	{
+	for (uint8_t band = 0; band < kBands; band++) {
+		const Description &d = kDescriptions[band];
+		if (d.count > 1u << kIndexBits || (d.shift && d.offset != 5)) return false;
+
+		for (uint16_t index = 0; index < d.count; index++) {
+			const uint32_t kHz = Frequency(static_cast<Band>(band), index);
+			if (Index(static_cast<Band>(band), kHz) != index) return false;
+
+			// up to the next channel
+			const uint32_t next = index + 1 < d.count ? Frequency(static_cast<Band>(band), index + 1) : kHz + 1;
+			for (uint32_t between = kHz + 1; between < next; between++)
+				if (Index(static_cast<Band>(band), between) != index) return false;
+			}
+		}
+
+	return true;
+	}
+	
+	
+	/*	Around
+		Wrap into 0 to modulus - 1
+	*/
+	constexpr uint32_t Around(
+		int32_t		value,
+		int32_t		modulus
+		)
+	{
+	const int32_t remainder = value % modulus;
+	
+	return remainder < 0 ? remainder + modulus : remainder;
+	}
+	
+	
+	/*	Step
+		Channel after turning a knob some detents, either way
+		
+		The band is a template argument so the moduli are constants, which the compiler turns into multiplies.
+	*/
+	template <Band band>
+	constexpr uint16_t Step(
+		uint16_t	index,
+		Knob		knob,
+		int32_t		detents
+		)
+	{
+	constexpr Description d = kDescriptions[band];
+	static_assert(d.wrap == kWrapBand || (d.count % d.coarse == 0 && d.coarse % d.fine == 0), "knobs must divide the band's digits evenly");
+	
+	if constexpr (d.wrap == kWrapBand)
+		return Around(index + detents * (knob == kCoarse ? d.coarse : d.fine), d.count);
+	
+	else {
+		// each knob's digits
+		const uint32_t digits = index / d.coarse, within = index % d.coarse;
+		
+		return knob == kCoarse ?
+			Around(digits + detents, d.count / d.coarse) * d.coarse + within :
+			digits * d.coarse + Around(within + detents * d.fine, d.coarse);
+		}
+	}
+	
+	
+	/*	Stepped
+		Whether every channel of a band steps one detent the way the radio does, turning all the way around
+		comes back to it, and big turns add up
+	*/
+	template <Band band>
+	constexpr bool Stepped()
+	{
+	constexpr Description d = kDescriptions[band];
+	
+	for (uint16_t index = 0; index < d.count; index++)
+		for (const Knob knob : { kCoarse, kFine }) {
+			const int32_t step = knob == kCoarse ? d.coarse : d.fine;
+			
+			// one detent: the next channel along, wrapping within the knob's digits (span channels from base)
+			const bool digits = d.wrap == kWrapDigits;
+			const uint32_t
+				span = digits && knob == kFine ? d.coarse : d.count,
+				base = !digits ? 0 : knob == kCoarse ? index % d.coarse : index - index % d.coarse,
+				up = (index - base + step) % span + base,
+				down = (index - base + span - step % span) % span + base;
+			if (Step<band>(index, knob, +1) != up || Step<band>(index, knob, -1) != down) return false;
+			
+			// all the way around
+			if (span % step == 0) {
+				const int32_t around = static_cast<int32_t>(span) / step;
+				if (Step<band>(index, knob, around) != index || Step<band>(index, knob, -around) != index) return false;
+				}
+			
+			// big turns are the sum of smaller ones
+			for (const int32_t detents : { 7, -13, 1000, -1000 })
+				if (Step<band>(index, knob, detents + 1) != Step<band>(Step<band>(index, knob, detents), knob, 1)) return false;
+			}
+	
+	return true;
+	}
+	}
@@ -0,0 +1,34 @@
+/*
+
+	Diagnostics
+	
+	Vendor bulk interface protocol, shared by the firmware and the host reader
+	
+	The host sends a one-byte command on the bulk OUT endpoint.  The device answers on the bulk IN endpoint
+	with one response of up to kResponseLength bytes, ended by a short (possibly zero-length) packet.  Every
+	response starts with a header: the command, a 16-bit little-endian value, and the count of the items
+	that follow (the same layout as the log Feature report).  Commands arriving while a response is still
+	being sent are ignored.
+	
+*/
+
+#pragma once
+
+#include <cstdint>
+
+
+namespace Diagnostics {
+	/*	Command
+		What the host asks for
+	*/
+	enum Command : uint8_t {
+		kLog = 1,	// log records, as Log::Encode(); value is the count of records dropped
+		kProfile	// probe statistics, as Profile::Encode(); value is zero
+		};
+	
+	constexpr uint8_t kInterface = 1;		// interface number in the configuration
+	constexpr uint8_t kEndpoint = 2;		// bulk IN and OUT endpoint number
+	constexpr uint16_t kPacketSize = 64;		// full-speed bulk maximum
+	constexpr uint16_t kHeaderLength = 4;
+	constexpr uint16_t kResponseLength = 1024;
+	}
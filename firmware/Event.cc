@@ -0,0 +1,15 @@
+/*
+
+	Event
+
+	Interrupt handler to event loop queue
+
+*/
+
+#include "Event.h"
+
+
+/*	gEvents
+	Events from all interrupt handlers, in order of occurrence
+*/
+Queue<Event, 32> gEvents;
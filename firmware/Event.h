@@ -0,0 +1,60 @@
+/*
+
+	Event
+
+	Interrupt handler to event loop queue
+
+*/
+
+#pragma once
+
+#include <cstdint>
+
+#include "Queue.h"
+
+
+/*	Event
+	Something that happened in an interrupt handler
+*/
+struct Event {
+	enum Type : uint8_t {
+		kNone,
+		kUSBDetected,		// USB power detected
+		kUSBReset,		// USB bus reset
+		kUSBSuspend,		// USB bus idle; host suspended us
+		kUSBResume,		// USB host resumed us
+		kUSBWakeupAllowed,	// USB low power exited; may signal remote wakeup
+		kUSBFrame,		// USB start of frame
+		kUSBSetup,		// SETUP stage on Endpoint 0
+		kUSBEndpoint0DataDone,	// DATA stage packet on Endpoint 0 done
+		kUSBEndpoint0OUTEnd,	// DATA stage OUT packet on Endpoint 0 in RAM
+		kUSBData,		// data transfer on an endpoint other than 0
+		kUSBDataOUTEnd,		// OUT data on an endpoint other than 0 in RAM
+		kKey,			// MAX key interrupt
+		kKeys,			// MAX keys read (posted by the event loop)
+		kQDECReport,		// quadrature decoder report
+		kAlarm			// RTC alarm
+		};
+
+	Type		type;
+	union {
+		uint32_t	datastatus;	// kUSBData: USBD EPDATASTATUS bits
+		uint32_t	frame;		// kUSBFrame: USBD FRAMECNTR
+		uint8_t		endpoint;	// kUSBDataOUTEnd: endpoint number
+		int32_t		accumulator;	// kQDECReport: QDEC ACCREAD
+		struct {
+			uint32_t	before,		// kKeys: MAX keys down at the last read, bank * 8 + bit
+					debounced,	// ... went down since, by the debounce registers
+					pressed;	// ... down now
+			}		keys;
+		uint32_t	i;
+		};
+	uint32_t	time = 0;		// RTC ticks, for events whose timing matters
+	uint8_t		encoder = 0;		// kQDECReport: 0 for the QDEC, 1 on for SoftQDEC instances
+	};
+
+
+/*	gEvents
+	Events from all interrupt handlers, in order of occurrence
+*/
+extern Queue<Event, 32> gEvents;
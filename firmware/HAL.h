@@ -0,0 +1,23 @@
+/*
+
+	HAL
+	
+	Hardware abstraction
+	
+	The peripherals the panel logic uses (SPI, QDEC, GPIOTE with PPI and TIMERs, RTC, flash, and the USB
+	device stack) are reached only through the static policy classes of one HAL, chosen when compiling.
+	The functions used outside of configuration are inline forwards to the nRF HAL, so the firmware build
+	compiles to the same code as calling nrf_* directly.  Defining SIMULATION instead selects models of
+	the peripherals, so the panel logic can run on Linux.
+	
+*/
+
+#pragma once
+
+#ifdef SIMULATION
+	#include "SimulationHAL.h"
+	using HAL = SimulationHAL;
+#else
+	#include "nRFHAL.h"
+	using HAL = nRFHAL;
+#endif
@@ -0,0 +1,78 @@
+/*
+
+	Log
+	
+	Deferred binary logging
+	
+*/
+
+#include "Log.h"
+#include "RTC.h"
+
+
+/*	gRecords
+	Logged messages, oldest first
+*/
+Queue<Log::Record, 64> Log::gRecords;
+
+
+/*	Now
+	Time stamp for a record
+*/
+uint32_t Log::Now()
+{
+return RTC::Now();
+}
+
+
+/*	Write
+	Record a message
+*/
+void Log::Write(
+	const Record	&record
+	)
+{
+// dropped records are counted by the queue
+(void) gRecords.Push(record);
+}
+
+
+/*	Encode
+	Move as many whole records as fit into the buffer; return the number of bytes written
+	
+	Each record is written little-endian: a 32-bit time, a 16-bit format, an 8-bit argument count, a
+	padding byte, and two 32-bit arguments (unused ones are zero).  'dropped' is set to the number of
+	records dropped so far, saturating.
+*/
+size_t Log::Encode(
+	uint8_t		*const buffer,
+	const size_t	length,
+	uint16_t	&dropped
+	)
+{
+uint8_t *p = buffer;
+
+// write one little-endian value
+/* Byte by byte, so the encoding doesn't depend on the host it's tested on. */
+const auto bytes = [&p](uint32_t value, unsigned n) {
+	for (unsigned i = 0; i < n; i++, value >>= 8)
+		*p++ = static_cast<uint8_t>(value);
+	};
+
+while (p + kEncodedRecord <= buffer + length) {
+	const std::optional<Record> record = gRecords.Pop();
+	if (!record) break;
+	
+	bytes(record->time, 4);
+	bytes(record->format, 2);
+	bytes(record->argumentsN, 1);
+	bytes(0, 1);
+	bytes(record->argumentsN > 0 ? record->arguments[0] : 0, 4);
+	bytes(record->argumentsN > 1 ? record->arguments[1] : 0, 4);
+	}
+
+const uint32_t overflows = gRecords.Overflows();
+dropped = overflows > UINT16_MAX ? UINT16_MAX : overflows;
+
+return p - buffer;
+}
@@ -0,0 +1,56 @@
+/*
+
+	Log
+	
+	Deferred binary logging
+	
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Queue.h"
+
+
+/*	Log
+	Log records waiting to be collected by the host
+	
+	Logging a message only records its format identifier and raw arguments in RAM; the text is
+	put together by the host, from the same LogFormats.h.  Any interrupt handler may log.  When the
+	host doesn't keep up, the newest records are dropped and counted.
+*/
+struct Log {
+	enum Format : uint16_t {
+		#define LOG_FORMAT(identifier, format) identifier,
+		#include "LogFormats.h"
+		#undef LOG_FORMAT
+		kFormats
+		};
+	
+	/*	Record
+		One logged message
+	*/
+	struct Record {
+		uint32_t	time;		// RTC ticks
+		Format		format;
+		uint8_t		argumentsN;
+		uint32_t	arguments[2];
+		};
+	
+	static constexpr size_t kEncodedRecord = 16;	// as Encode() writes it
+
+protected:
+	static Queue<Record, 64> gRecords;
+	
+	static void	Write(const Record&);
+
+public:
+	static void	Write(Format format) { Write({ Now(), format, 0, {} }); }
+	static void	Write(Format format, uint32_t argument0) { Write({ Now(), format, 1, { argument0 } }); }
+	static void	Write(Format format, uint32_t argument0, uint32_t argument1) { Write({ Now(), format, 2, { argument0, argument1 } }); }
+	
+	static uint32_t	Now();
+	static size_t	Encode(uint8_t *buffer, size_t length, uint16_t &dropped);
+	};
@@ -0,0 +1,26 @@
+/*
+
+	LogFormats
+	
+	Log message formats, shared by the firmware and the host-side decoder
+	
+	Each LOG_FORMAT(identifier, format) defines one message.  The firmware only records the
+	identifier (by position in this list) and the raw arguments; the host expands the printf-style
+	format, with every argument passed as a 32-bit unsigned value.  Append new formats at the end so
+	that a host decoder built earlier still decodes the messages it knows about.
+	
+	Included repeatedly, with LOG_FORMAT defined differently each time; so no include guard.
+	
+*/
+
+LOG_FORMAT(kLogStart,			"firmware started")
+LOG_FORMAT(kLogUSBReset,		"USB bus reset")
+LOG_FORMAT(kLogSetupNotHandled,		"SETUP request type 0x%02x request %u not handled")
+LOG_FORMAT(kLogControlTimeout,		"control transfer abandoned at byte %u of %u")
+LOG_FORMAT(kLogEventsDropped,		"event queue full; %u events dropped")
+LOG_FORMAT(kLogDiagnosticsCommand,	"diagnostics command %u not known")
+LOG_FORMAT(kLogStateSaved,		"state saved to flash page %u record %u")
+LOG_FORMAT(kLogUSBSuspend,		"USB suspended")
+LOG_FORMAT(kLogUSBResume,		"USB resumed, ready %u ticks after waking")
+LOG_FORMAT(kLogEncoderResync,		"encoder %u missed an edge; its direction was put right")
+LOG_FORMAT(kLogOutputReportIgnored,	"Output report ID %u of %u bytes ignored")
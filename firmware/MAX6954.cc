@@ -6,19 +6,13 @@
 	
 */
 
-#include <nrf_gpio.h>
-#include <nrf_gpiote.h>
-
+#include "Event.h"
+#include "HAL.h"
 #include "MAX6954.h"
+#include "RTC.h"
 
 
-#define PIN_KEY_INTERRUPT NRF_GPIO_PIN_MAP(0, 26)
-
-
-/*	gKey
-	Key pressed
-*/
-std::atomic<bool> MAX6954::gKey;
+#define PIN_KEY_INTERRUPT HAL::Pin(0, 26)
 
 
 /*	GPIOTE_IRQHandler
@@ -28,41 +22,24 @@ std::atomic<bool> MAX6954::gKey;
 extern "C" void GPIOTE_IRQHandler()
 {
 // key-pressed event?
-if (nrf_gpiote_in_event_get(0 /* channel */)) {
-	// must clear the event, or the interrupt keeps recurring
-	nrf_gpiote_event_clear(NRF_GPIOTE_EVENTS_IN_0);
-	
-	MAX6954::gKey = true;
-	}
+if (HAL::GPIOTE::Triggered(0 /* channel */))
+	(void) gEvents.Push({ Event::kKey, {}, RTC::Now() });
 }
 
 
 /*	MAX6954
-
+	One chip on the bus; the first one's key IRQ is wired to us
 */
 MAX6954::MAX6954(
-	SPIM		&spim
+	MAXBus		&bus,
+	uint8_t		chip
 	) :
-	fSPIM(spim)
+	fBus(bus),
+	fChip(chip)
 {
-// disable CPU interrupt and task interrupts
-NVIC_DisableIRQ(GPIOTE_IRQn);
-nrf_gpiote_int_disable(~0 /* NRF_SPIM_ALL_INTS_MASK */);
-
-// configure GPIO pin for input from MAX IRQ
-/* Seems redundant [nRF52840 6.10.3] but needed for the pull-up */
+// interrupt on a falling edge of MAX IRQ, on GPIOTE Channel 0
 /* Don't see the need for pull-up documented anywhere in [MAX6954], but it's reasonable (and P4 is always low otherwise). */
-nrf_gpio_cfg(PIN_KEY_INTERRUPT, NRF_GPIO_PIN_DIR_INPUT, NRF_GPIO_PIN_INPUT_CONNECT, NRF_GPIO_PIN_PULLUP, NRF_GPIO_PIN_S0S1 /* dummy */, NRF_GPIO_PIN_NOSENSE);
-
-// configure GPIOTE Channel 0 as an event on a transition of this pin
-nrf_gpiote_event_configure(0 /* channel */, PIN_KEY_INTERRUPT, NRF_GPIOTE_POLARITY_HITOLO);
-nrf_gpiote_event_enable(0 /* channel */);
-
-// enable CPU interrupt and task interrupt
-NVIC_SetPriority(GPIOTE_IRQn, 7 /* priority */);
-NVIC_ClearPendingIRQ(GPIOTE_IRQn);
-NVIC_EnableIRQ(GPIOTE_IRQn);
-nrf_gpiote_int_enable(NRF_GPIOTE_INT_IN0_MASK);
+if (chip == 0) HAL::GPIOTE::Configure(0 /* channel */, PIN_KEY_INTERRUPT);
 }
 
 
@@ -73,7 +50,7 @@ void MAX6954::DecodeMode(
 	const uint8_t	mode
 	)
 {
-(void) fSPIM(Message {{ .data = mode, .registre = kRegisterDecodeMode }});
+fBus.Write(fChip, kRegisterDecodeMode, mode);
 }
 
 
@@ -84,7 +61,7 @@ void MAX6954::GlobalIntensity(
 	const uint8_t	intensity
 	)
 {
-(void) fSPIM(Message {{ .data = intensity, .registre = kRegisterGlobalIntensity }});
+fBus.Write(fChip, kRegisterGlobalIntensity, intensity);
 }
 
 
@@ -95,7 +72,7 @@ void MAX6954::ScanLimit(
 	const uint8_t	limit
 	)
 {
-(void) fSPIM(Message {{ .data = limit, .registre = kRegisterScanLimit }});
+fBus.Write(fChip, kRegisterScanLimit, limit);
 }
 
 
@@ -106,18 +83,15 @@ void MAX6954::Configure(
 	const Configuration configuration
 	)
 {
-(void) fSPIM(Message {{ .data = configuration.i, .registre = kRegisterConfiguration }});
+fBus.Write(fChip, kRegisterConfiguration, configuration.i);
+
+// digit registers are all zero now
+if (configuration.clearDigits) fBus.Forget(fChip);
 }
 
 MAX6954::Configuration MAX6954::Configure()
 {
-// issue read request
-(void) fSPIM(Message {{ .registre = kRegisterConfiguration, .read = true }});
-
-// issue dummy request to retrieve response
-Message result = { .i = fSPIM(Message {{ .registre = kRegisterNoOperation, .read = true }}) };
-
-return { .i = static_cast<uint8_t>(result.data) };
+return { .i = Read(kRegisterConfiguration) };
 }
 
 
@@ -128,7 +102,7 @@ void MAX6954::PortConfigure(
 	uint8_t		configuration
 	)
 {
-(void) fSPIM(Message {{ .data = configuration, .registre = kRegisterPortConfiguration }});
+fBus.Write(fChip, kRegisterPortConfiguration, configuration);
 }
 
 
@@ -141,7 +115,7 @@ void MAX6954::KeyMask(
 	)
 {
 // configure key scan interrupt mask
-(void) fSPIM(Message {{ .data = value, .registre = static_cast<uint8_t>(kRegisterKeyAMaskDebounce + keys) }});
+fBus.Write(fChip, kRegisterKeyAMaskDebounce + keys, value);
 }
 
 
@@ -152,13 +126,31 @@ uint8_t MAX6954::DebouncedKey(
 	unsigned char	keys
 	)
 {
-// issue read request
-(void) fSPIM(Message {{ .registre = static_cast<uint8_t>(kRegisterKeyAMaskDebounce + keys), .read = true }});
+return Read(kRegisterKeyAMaskDebounce + keys);
+}
 
-// issue dummy request to retrieve response
-Message result = { .i = fSPIM(Message {{ .registre = kRegisterNoOperation, .read = true }}) };
 
-return { static_cast<uint8_t>(result.data) };
+/*	ReadKeys
+	Debounced and pressed keys of every bank, in one sequence (nine words, where reading each register on its
+	own takes sixteen); resets MAX IRQ
+*/
+MAX6954::Keys MAX6954::ReadKeys()
+{
+uint8_t registers[2 * kKeyBanks], values[2 * kKeyBanks];
+for (unsigned bank = 0; bank < kKeyBanks; bank++) {
+	registers[bank] = kRegisterKeyAMaskDebounce + bank;
+	registers[kKeyBanks + bank] = kRegisterDigitTypeKeyAPressed + bank;
+	}
+
+Read(registers, values, 2 * kKeyBanks);
+
+Keys keys = { 0, 0 };
+for (unsigned bank = 0; bank < kKeyBanks; bank++) {
+	keys.debounced |= static_cast<uint32_t>(values[bank]) << 8 * bank;
+	keys.pressed |= static_cast<uint32_t>(values[kKeyBanks + bank]) << 8 * bank;
+	}
+
+return keys;
 }
 
 
@@ -169,7 +161,7 @@ void MAX6954::DigitType(
 	const uint8_t	type
 	)
 {
-(void) fSPIM(Message {{ .data = type, .registre = kRegisterDigitTypeKeyAPressed }});
+fBus.Write(fChip, kRegisterDigitTypeKeyAPressed, type);
 }
 
 
@@ -180,39 +172,47 @@ uint8_t MAX6954::KeyPressed(
 	unsigned char	keys
 	)
 {
-// issue read request
-(void) fSPIM(Message {{ .registre = static_cast<uint8_t>(kRegisterDigitTypeKeyAPressed + keys), .read = true }});
-
-// issue dummy request to retrieve response
-Message result = { .i = fSPIM(Message {{ .registre = kRegisterNoOperation, .read = true }}) };
-
-return { static_cast<uint8_t>(result.data) };
+return Read(kRegisterDigitTypeKeyAPressed + keys);
 }
 
 
 /*	Digit
-
+	Write a digit at the bus's next Flush(), if it changed
 */
 void MAX6954::Digit(
 	unsigned char	digit,
 	const uint8_t	value
 	)
 {
-Message data = { 0 };
-data.registre = 0x20 + digit;
-data.data = value;
-(void) fSPIM(data.i);
+fBus.Stage(fChip, 0x20 + digit, value);
 }
 
 uint8_t MAX6954::Digit(
 	unsigned char	digit
 	)
 {
-// issue read request
-(void) fSPIM(Message {{ .registre = static_cast<uint8_t>(0x20 + digit), .read = true }});
+return Read(0x20 + digit);
+}
+
+
+/*	Read
+	Read registers in one sequence (see MAXBus::Read)
+*/
+void MAX6954::Read(
+	const uint8_t	*const registers,
+	uint8_t		*const values,
+	const size_t	count
+	)
+{
+fBus.Read(fChip, registers, values, count);
+}
 
-// issue dummy request to retrieve response
-Message result = { .i = fSPIM(Message {{ .registre = kRegisterNoOperation, .read = true }}) };
+uint8_t MAX6954::Read(
+	const uint8_t	registre
+	)
+{
+uint8_t value;
+Read(&registre, &value, 1);
 
-return { static_cast<uint8_t>(result.data) };
+return value;
 }
@@ -8,13 +8,10 @@
 
 #pragma once
 
-#include <atomic>
+#include <cstddef>
 #include <cstdint>
 
-#include "SPIM.h"
-
-
-extern "C" void GPIOTE_IRQHandler();
+#include "MAXBus.h"
 
 
 /*	MAX6954
@@ -22,8 +19,6 @@ extern "C" void GPIOTE_IRQHandler();
 */
 struct MAX6954 {
 protected:
-	friend void GPIOTE_IRQHandler();
-	
 	enum Register {
 		kRegisterNoOperation = 0x00,
 		kRegisterDecodeMode = 0x01,
@@ -37,33 +32,25 @@ protected:
 		};
 	
 	
-	/*	Message
-		SPI message
-	*/
-	union __attribute__((packed)) Message {
-		struct __attribute__((packed)) {
-			unsigned	data : 8;
-			unsigned
-					registre : 7,
-					read : 1;
-			};
-		
-		uint16_t	i;
-		
-		operator	uint16_t() const { return i; }
-		};
-	static_assert(sizeof(Message) == 2);
+	MAXBus		&fBus;
+	const uint8_t	fChip;
 	
+	void		HandleKeyPress();
+	uint8_t		Read(uint8_t registre);
+
+public:
+	static constexpr unsigned kKeyBanks = 4;	// A to D, 8 keys each
 	
-	// key pressed
-	static std::atomic<bool> gKey;
 	
+	/*	Keys
+		All four banks at once, bank A in the low byte
+	*/
+	struct Keys {
+		uint32_t	debounced,	// pressed since the last read, even if released since
+				pressed;	// down now
+		};
 	
-	SPIM		&fSPIM;
 	
-	void		HandleKeyPress();
-
-public:
 	/*	Configuration
 		
 	*/
@@ -81,11 +68,18 @@ public:
 			};
 		
 		uint8_t		i;
+		
+		// running, or shut down, and nothing else
+		static Configuration Running(bool on) {
+					Configuration configuration = {};
+					configuration.shutdownOff = on;
+					return configuration;
+					}
 		};
 	static_assert(sizeof(Configuration) == 1);
 	
 	
-	explicit	MAX6954(SPIM&);
+			MAX6954(MAXBus&, uint8_t chip);
 			MAX6954(const MAX6954&) = delete;
 	
 	void		DecodeMode(uint8_t);
@@ -98,9 +92,10 @@ public:
 	uint8_t		DebouncedKey(unsigned char keys);
 	void		DigitType(uint8_t);
 	uint8_t		KeyPressed(unsigned char keys);
+	Keys		ReadKeys();
+	
+	void		Read(const uint8_t *registers, uint8_t *values, size_t count);
 	
 	void		Digit(unsigned char digit, uint8_t value);
 	uint8_t		Digit(unsigned char digit);
-	
-	bool		WasKeyPressed() { return gKey.exchange(false); }
 	};
@@ -0,0 +1,163 @@
+/*
+
+	MAXBus
+	
+	MAX6954s sharing one SPI master
+	
+*/
+
+#include <algorithm>
+
+#include "MAXBus.h"
+
+
+/*	MAXBus
+	Chain of the given number of chips; nothing is known of what they hold
+*/
+MAXBus::MAXBus(
+	SPIM		&spim,
+	uint8_t		chips
+	) :
+	fSPIM(spim),
+	fChips(std::clamp<uint8_t>(chips, 1, kChipsMaximum)),
+	fValues{},
+	fDirty{},
+	fKnown{}
+{
+}
+
+
+/*	Write
+	Write a register of one chip now, in a frame of its own
+*/
+void MAXBus::Write(
+	uint8_t		chip,
+	uint8_t		registre,
+	uint8_t		value
+	)
+{
+registre &= 0x7f;
+
+uint16_t out[kChipsMaximum], in[kChipsMaximum];
+std::fill_n(out, fChips, kNoOperation);
+out[Slot(chip)] = Message {{ .data = value, .registre = registre, .read = false }};
+
+fSPIM(out, in, fChips, fChips);
+
+// whatever was staged for it is overtaken
+const uint32_t bit = 1u << registre % 32;
+fValues[chip][registre] = value;
+fDirty[chip][registre / 32] &= ~bit;
+fKnown[chip][registre / 32] |= bit;
+}
+
+
+/*	Stage
+	Write a register of one chip at the next Flush(), unless it already holds the value
+*/
+void MAXBus::Stage(
+	uint8_t		chip,
+	uint8_t		registre,
+	uint8_t		value
+	)
+{
+registre &= 0x7f;
+const uint32_t bit = 1u << registre % 32;
+if ((fKnown[chip][registre / 32] & bit) && fValues[chip][registre] == value) return;
+
+fValues[chip][registre] = value;
+fDirty[chip][registre / 32] |= bit;
+fKnown[chip][registre / 32] &= ~bit;
+}
+
+
+/*	TakeDirty
+	The lowest staged register of a chip, no longer staged, or -1 if none
+*/
+int MAXBus::TakeDirty(
+	uint8_t		chip
+	)
+{
+for (unsigned word = 0; word < kRegisters / 32; word++)
+	if (uint32_t &dirty = fDirty[chip][word]; dirty != 0) {
+		const unsigned bit = __builtin_ctz(dirty);
+		dirty &= dirty - 1;
+		fKnown[chip][word] |= 1u << bit;
+		return word * 32 + bit;
+		}
+
+return -1;
+}
+
+
+/*	Flush
+	Send every chip's staged registers, one from each chip per frame
+*/
+void MAXBus::Flush()
+{
+const size_t framesMaximum = SPIM::kSequenceMaximum / fChips;
+
+for (;;) {
+	uint16_t out[SPIM::kSequenceMaximum], in[SPIM::kSequenceMaximum];
+	size_t frames = 0;
+	
+	for (bool any = true; any && frames < framesMaximum;) {
+		any = false;
+		for (uint8_t chip = 0; chip < fChips; chip++) {
+			const int registre = TakeDirty(chip);
+			out[frames * fChips + Slot(chip)] = registre < 0 ? kNoOperation :
+				Message {{ .data = fValues[chip][registre], .registre = static_cast<uint8_t>(registre), .read = false }};
+			any |= registre >= 0;
+			}
+		if (any) frames++;
+		}
+	
+	if (frames == 0) return;
+	fSPIM(out, in, frames * fChips, fChips);
+	
+	// more than one sequence holds?
+	if (frames < framesMaximum) return;
+	}
+}
+
+
+/*	Forget
+	The chip's registers may have changed behind our back (clearing digits); stage them anew from now on
+*/
+void MAXBus::Forget(
+	uint8_t		chip
+	)
+{
+std::fill_n(fKnown[chip], kRegisters / 32, 0);
+}
+
+
+/*	Read
+	Read registers of one chip in one sequence
+	
+	A read's result comes back in the next frame, so the next read command goes there instead of a No-Op;
+	only the last needs a frame of its own.  N reads take N + 1 frames, with one wait for them all.
+*/
+void MAXBus::Read(
+	uint8_t		chip,
+	const uint8_t	*const registers,
+	uint8_t		*const values,
+	const size_t	count
+	)
+{
+const size_t readsMaximum = SPIM::kSequenceMaximum / fChips - 1;
+
+for (size_t first = 0; first < count; first += readsMaximum) {
+	const size_t n = std::min(count - first, readsMaximum);
+	
+	uint16_t out[SPIM::kSequenceMaximum], in[SPIM::kSequenceMaximum];
+	std::fill_n(out, (n + 1) * fChips, kNoOperation);
+	for (size_t i = 0; i < n; i++)
+		out[i * fChips + Slot(chip)] = Message {{ .data = 0, .registre = static_cast<uint8_t>(registers[first + i] & 0x7f), .read = true }};
+	
+	fSPIM(out, in, (n + 1) * fChips, fChips);
+	
+	for (size_t i = 0; i < n; i++)
+		values[first + i] = static_cast<uint8_t>(in[(i + 1) * fChips + Slot(chip)]);
+	}
+}
@@ -0,0 +1,73 @@
+/*
+
+	MAXBus
+	
+	MAX6954s sharing one SPI master
+	
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "SPIM.h"
+
+
+/*	MAXBus
+	Daisy chain of MAX6954s: DOUT of each to DIN of the next, chip select and clock in common
+	
+	A frame (chip select low, then high) carries one 16-bit word for every chip; the first word goes furthest
+	down the chain, and a chip with nothing to do gets a No-Op.  In the frame after a read, each chip's word
+	comes back in its own slot.  Registers written with Stage() are only sent by Flush(), which interleaves
+	the chips' changed registers one per frame, so the chain takes as many frames as the busiest chip needs,
+	in one SPIM sequence.
+*/
+struct MAXBus {
+	static constexpr uint8_t kChipsMaximum = 4;
+
+protected:
+	static constexpr uint8_t kRegisters = 0x80;
+	
+	
+	/*	Message
+		SPI message
+	*/
+	union __attribute__((packed)) Message {
+		struct __attribute__((packed)) {
+			unsigned	data : 8;
+			unsigned
+					registre : 7,
+					read : 1;
+			};
+		
+		uint16_t	i;
+		
+		operator	uint16_t() const { return i; }
+		};
+	static_assert(sizeof(Message) == 2);
+	
+	static constexpr uint16_t kNoOperation = 0x0000;
+	
+	
+	SPIM		&fSPIM;
+	const uint8_t	fChips;
+	uint8_t		fValues[kChipsMaximum][kRegisters];	// as last written or staged
+	uint32_t	fDirty[kChipsMaximum][kRegisters / 32],	// staged, not yet sent
+			fKnown[kChipsMaximum][kRegisters / 32];	// the chip has fValues
+	
+	size_t		Slot(uint8_t chip) const { return fChips - 1 - chip; }
+	int		TakeDirty(uint8_t chip);
+
+public:
+			MAXBus(SPIM&, uint8_t chips);
+			MAXBus(const MAXBus&) = delete;
+	
+	uint8_t		Chips() const { return fChips; }
+	
+	void		Write(uint8_t chip, uint8_t registre, uint8_t value);
+	void		Stage(uint8_t chip, uint8_t registre, uint8_t value);
+	void		Flush();
+	void		Forget(uint8_t chip);
+	void		Read(uint8_t chip, const uint8_t *registers, uint8_t *values, size_t count);
+	};
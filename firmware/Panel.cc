@@ -6,43 +6,70 @@
 	
 */
 
+#include "Event.h"
+#include "HAL.h"
+#include "Log.h"
 #include "Panel.h"
-#include "USB.h"
+#include "Persist.h"
+#include "Profile.h"
 
-#include <nrf_gpio.h>
-#include <nrf_gpiote.h>
+
+// every channel converts and steps as it should
+static_assert(Channel::Checked(), "channel conversions don't round-trip");
+static_assert(
+	Channel::Stepped<Channel::kCOM25>() && Channel::Stepped<Channel::kCOM833>() &&
+		Channel::Stepped<Channel::kNAV>() && Channel::Stepped<Channel::kADF>(),
+	"channel steps don't wrap"
+	);
 
 
 /*	Panel
 	Constructor
 */
 Panel::Panel() :
-	fAccumulate(0),
-	fValue(121500),
-	fValueStandby(122900),
+	fAccumulate{},
+	fChannel(Channel::Index(kBand, 121500)),
+	fChannelStandby(Channel::Index(kBand, 122900)),
 	fSPIM(
-		NRF_GPIO_PIN_MAP(1, 8),
-		NRF_GPIO_PIN_MAP(0, 14),
-		NRF_GPIO_PIN_MAP(0, 13),
-		NRF_GPIO_PIN_MAP(0, 15)
+		HAL::Pin(1, 8),
+		HAL::Pin(0, 14),
+		HAL::Pin(0, 13),
+		HAL::Pin(0, 15)
 		),
-	fMAX(fSPIM),
+	fBus(fSPIM, kDisplayChips),
+	fMAX(fBus, 0),
 	fQDEC(
-		NRF_GPIO_PIN_MAP(0, 6),
-		NRF_GPIO_PIN_MAP(0, 8)
+		HAL::Pin(0, 6),
+		HAL::Pin(0, 8)
 		)
 {
+#ifdef INSTRUMENTATION
+Profile::Start();
+#endif
+
 fMAX.ScanLimit(5 /* digit pairs 0/0a through 5/5a only */);
 fMAX.GlobalIntensity(0);
 fMAX.DigitType(0x00 /* all 7-segment displays */);
 fMAX.DecodeMode(0xff /* hexadecimal decoding */);
-fMAX.Configure(MAX6954::Configuration { .shutdownOff = true });
-fMAX.PortConfigure(0x20 /* 8 keys scanned; P1,2,3 are left as output; P4 becomes IRQ */);
-fMAX.KeyMask(0, 1 << 1); // enable interrupt on 1
-(void) fMAX.DebouncedKey(0); // reset IRQ
+fMAX.Configure(MAX6954::Configuration::Running(true));
+fMAX.PortConfigure(0x80 /* 32 keys scanned on P0 to P3; P4 becomes IRQ */);
+for (unsigned bank = 0; bank < MAX6954::kKeyBanks; bank++)
+	fMAX.KeyMask(bank, 0xff); // enable interrupt on every key
+fKeys = fMAX.ReadKeys().pressed; // reset IRQ
+
+// pick up where we were before power was lost
+if (const std::optional<Persist::Record> saved = Persist::Load()) {
+	fChannel = Channel::Index(kBand, saved->value);
+	fChannelStandby = Channel::Index(kBand, saved->valueStandby);
+	(void) fAcceleration.Select(saved->accelerationCurve);
+	if (saved->encoderSampling <= QDEC::kLowLatency) fQDEC.Sampling(static_cast<QDEC::Mode>(saved->encoderSampling));
+	}
 
 // initialize display
+/* Before USB enumerates, so it shows the last state without waiting for the host. */
 UpdateDisplay();
+
+Log::Write(Log::kLogStart);
 }
 
 
@@ -64,17 +91,20 @@ fMAX.Digit(base + 5, (value / 1) % 10);
 
 
 /*	UpdateDisplay
-	Update displayed values based on state
+	Update displayed values based on state; only the digits that changed are sent
 */
 void Panel::UpdateDisplay()
 {
-UpdateOneDisplay(0, fValue);
-UpdateOneDisplay(8, fValueStandby);
+PROFILE(kUpdateDisplay);
+
+UpdateOneDisplay(0, Value());
+UpdateOneDisplay(8, ValueStandby());
+fBus.Flush();
 }
 
 
 /*	SetValue
-	Set panel values
+	Set panel values, in kHz; each becomes the channel at or below it
 */
 void Panel::SetValue(
 	unsigned	value0,
@@ -82,60 +112,330 @@ void Panel::SetValue(
 	)
 {
 // update state
-fValue = value0;
-fValueStandby = value1;
+fChannel = Channel::Index(kBand, value0);
+fChannelStandby = Channel::Index(kBand, value1);
 
 // update displayed values
 UpdateDisplay();
+Changed();
 
 // don't send updated values back through USB
 }
 
 
+/*	SetAccelerationCurve
+	Select an encoder acceleration curve; return whether it exists
+*/
+bool Panel::SetAccelerationCurve(
+	uint8_t		curve
+	)
+{
+if (!fAcceleration.Select(curve)) return false;
+
+Changed();
+return true;
+}
+
+
+/*	SetEncoderSampling
+	Select normal or low-latency rotary encoder sampling; return whether the mode exists
+*/
+bool Panel::SetEncoderSampling(
+	uint8_t		mode
+	)
+{
+if (mode > QDEC::kLowLatency) return false;
+
+fQDEC.Sampling(static_cast<QDEC::Mode>(mode));
+Changed();
+return true;
+}
+
+
+/*	SetEncoder
+	Select acceleration curve and sampling mode together; return whether both exist, changing neither if not
+*/
+bool Panel::SetEncoder(
+	uint8_t		curve,
+	uint8_t		mode
+	)
+{
+if (curve >= Acceleration::kCurves.size() || mode > QDEC::kLowLatency) return false;
+
+return SetAccelerationCurve(curve) && SetEncoderSampling(mode);
+}
+
+
+/*	Changed
+	Save the state once it stops changing
+	
+	Each change pushes the alarm back, so flash is only written after kQuietTicks without one.
+*/
+void Panel::Changed()
+{
+fChanged = RTC::Now();
+fUnsaved = true;
+RTC::Alarm(fChanged + kQuietTicks);
+}
+
+
+/*	Save
+	Write the state to flash, if it's been quiet long enough
+*/
+void Panel::Save(
+	uint32_t	time
+	)
+{
+// changed since the alarm was set, or an alarm already handled?
+/* A change after the alarm went off but before we got here has set a later alarm. */
+if (!fUnsaved || RTC::Elapsed(fChanged, time) < kQuietTicks) return;
+
+Persist::Save({ Value(), ValueStandby(), fAcceleration.Selected(), static_cast<uint8_t>(fQDEC.Sampling()) });
+fUnsaved = false;
+}
+
+
 /*	ProcessQDEC
-	Respond to rotary encoder
+	Respond to a rotary encoder
+	
+	The QDEC's encoder turns the coarse knob, or the fine one while the 'decimals' key is held; any other
+	is the inner knob of a concentric pair, and turns the fine one.
 */
-void Panel::ProcessQDEC()
+void Panel::ProcessQDEC(
+	uint8_t		encoder,
+	int32_t		accumulator,
+	uint32_t	time
+	)
 {
-// MAX can't interrupt when our 'decimals' key is released, so instead we must check synchronously
-/* Use the instantaneous value, not the debounced one (which looks to be reset after reading) */
-uint8_t noopr = fMAX.KeyPressed(0);
-bool decimals = noopr & 1;
+PROFILE(kProcessQDEC);
+
+if (encoder >= kEncoders) return;
+
+Wakeup();
+
+Channel::Knob knob = Channel::kFine;
+if (encoder == 0) {
+	// MAX can't interrupt when our 'decimals' key is released, so instead we must check synchronously
+	/* Use the instantaneous value, not the debounced one (which looks to be reset after reading) */
+	uint8_t noopr = fMAX.KeyPressed(0);
+	bool decimals = noopr & 1 << kKeyDecimals;
+	UpdateKeys(0, (fKeys & ~0xffu) | noopr, time);
+	
+	knob = decimals ? Channel::kFine : Channel::kCoarse;
+	}
 
-// trigger reading the accumulator
+// accumulate the reading
 /* Each indent is four samples; we really only care about those multiples of four.
    However, we may get a 'report' on just one of the samples; so we must accumulate them. */
-fAccumulate += fQDEC.operator int32_t();
-signed indents = fAccumulate / 4;	// integer division truncates towards zero, for negative numbers as well
+fAccumulate[encoder] += accumulator;
+signed indents = fAccumulate[encoder] / 4;	// integer division truncates towards zero, for negative numbers as well
 
 if (indents != 0) {
-	fAccumulate -= indents * 4;
-	fValueStandby += indents * (decimals ? 25 : 1000);
+	fAccumulate[encoder] -= indents * 4;
+	
+	// turning faster covers more of the band per detent
+	const unsigned multiplier = fAcceleration(indents, time);
+	
+	StepStandby(knob, indents * static_cast<signed>(multiplier));
 	
 	// display updated values immediately
 	UpdateDisplay();
+	Changed();
 	
 	// send updated values through USB
-	USBEndpointIN1(fValue, fValueStandby);
+	Report(indents, time);
 	}
 }
 
 
-void Panel::ProcessMAXKeyPress()
+/*	StepStandby
+	Turn the standby value some detents; it stays within the band, wrapping around as the radio's knobs do
+*/
+void Panel::StepStandby(
+	Channel::Knob	knob,
+	signed		detents
+	)
+{
+PROFILE(kStepChannel);
+
+fChannelStandby = Channel::Step<kBand>(fChannelStandby, knob, detents);
+}
+
+
+/*	ProcessMAXKeyPress
+	Respond to MAX IRQ: some key went down
+*/
+void Panel::ProcessMAXKeyPress(
+	uint32_t	time
+	)
+{
+Wakeup();
+
+// read every bank's debounced register, which resets MAX IRQ, and what is down now
+const MAX6954::Keys keys = fMAX.ReadKeys();
+UpdateKeys(keys.debounced, keys.pressed, time);
+}
+
+
+/*	UpdateKeys
+	Post the keys as last read and now, to be taken apart into edges when the event comes round
+	
+	One event however many keys changed: edges of all 32 keys, up to three each, would overrun the queue
+	the interrupt handlers share.  With the queue full, the keys as last read are kept, so the next read
+	posts the edges this one couldn't (short of a tap it would have caught in between).
+*/
+void Panel::UpdateKeys(
+	uint32_t	debounced,
+	uint32_t	pressed,
+	uint32_t	time
+	)
+{
+// nothing went down or up?
+/* Every report of the QDEC's encoder reads its keys; most of them find nothing new. */
+if (pressed == fKeys && debounced == 0) return;
+
+if (!gEvents.Push({ Event::kKeys, { .keys = { fKeys, debounced, pressed } }, time })) return;
+
+fKeys = pressed;
+}
+
+
+/*	ProcessKeys
+	Respond to the key edges between two reads of the keys
+	
+	A debounced key went down since the last read, even if it's up again now; if it was down then, it must
+	have gone up in between.
+*/
+void Panel::ProcessKeys(
+	uint32_t	before,
+	uint32_t	debounced,
+	uint32_t	pressed,
+	uint32_t	time
+	)
 {
-// read debounced register resets MAX IRQ
-uint8_t noopr = fMAX.DebouncedKey(0);
+const auto edges = [this, time](uint32_t keys, bool down) {
+	for (; keys != 0; keys &= keys - 1)
+		ProcessKey(static_cast<uint8_t>(__builtin_ctz(keys)), down, time);
+	};
+
+edges(before & debounced, false);
+edges(debounced | (pressed & ~before), true);
+edges((before | debounced) & ~pressed, false);
+}
+
 
-if (noopr & 2) {
+/*	ProcessKey
+	Respond to a key going down or up
+*/
+void Panel::ProcessKey(
+	uint8_t		key,
+	bool		down,
+	uint32_t	time
+	)
+{
+if (down && key == kKeyFlip) {
 	/* Adds 72 bytes in Debug build; zero in Release. */
-	std::swap(fValue, fValueStandby);
+	std::swap(fChannel, fChannelStandby);
 	
 	// display updated values immediately
 	UpdateDisplay();
+	Changed();
+	}
+
+// send updated values and keys through USB
+Report(0, time);
+}
+
+
+/*	Suspend
+	Shut the display down to stay within suspend current
 	
-	// send updated values through USB
-	USBEndpointIN1(fValue, fValueStandby);
+	In shutdown the MAX also stops scanning keys; the knob is what wakes us.
+*/
+void Panel::Suspend()
+{
+if (fSuspended) return;
+fSuspended = true;
+
+fMAX.Configure(MAX6954::Configuration::Running(false));
+}
+
+
+/*	Resume
+	Light the display again
+*/
+void Panel::Resume()
+{
+if (!fSuspended) return;
+fSuspended = false;
+
+fMAX.Configure(MAX6954::Configuration::Running(true));
+}
+
+
+/*	Wakeup
+	User input while suspended: ask the host to resume
+	
+	The display stays dark until the bus does resume, which the host may not allow.
+*/
+void Panel::Wakeup()
+{
+if (!fSuspended) return;
+
+HAL::USBD::Wakeup();
+}
+
+
+/*	Report
+	Send the panel state to the host, with the detents turned to get there
+*/
+void Panel::Report(
+	int16_t		delta,
+	uint32_t	time
+	)
+{
+HAL::USBD::Report({ time, Value(), ValueStandby(), delta, fKeys });
+}
+
+
+/*	Run
+	Handle everything the interrupt handlers posted, in the order it happened
+*/
+void Panel::Run()
+{
+// interrupt handlers lost events since we last looked?
+if (const uint32_t overflows = gEvents.Overflows(); overflows != fEventOverflows) {
+	Log::Write(Log::kLogEventsDropped, overflows - fEventOverflows);
+	fEventOverflows = overflows;
 	}
+
+while (const std::optional<Event> event = gEvents.Pop())
+	switch (event->type) {
+		// MAX key pressed?
+		case Event::kKey:
+			ProcessMAXKeyPress(event->time);
+			break;
+		
+		// MAX keys read?
+		case Event::kKeys:
+			ProcessKeys(event->keys.before, event->keys.debounced, event->keys.pressed, event->time);
+			break;
+		
+		// quadrature decoder report?
+		case Event::kQDECReport:
+			ProcessQDEC(event->encoder, event->accumulator, event->time);
+			break;
+		
+		// quiet period over?
+		case Event::kAlarm:
+			Save(event->time);
+			break;
+		
+		// USB
+		default:
+			HAL::USBD::Handle(*this, *event);
+			break;
+		}
 }
 
 
@@ -147,37 +447,8 @@ void Panel::Loop()
 // event loop
 for (;;) {
 	// wait for event
-	__WFE();
-	
-	// USB power detected?
-	if (gUSBDDetected) {
-		gUSBDDetected = false;
-		
-		// enable USB on the device
-		StartUSB();
-		}
-	
-	// Endpoint 0 OUT SETUP?
-	/* read or write transfer on USB Control Endpoint 0 */
-	if (gUSBDEndpointOUT0SETUP) {
-		gUSBDEndpointOUT0SETUP = false;
-
-		USBSetup0();
-		}
-	
-	// 
-	if (gUSBDEndpointOUT1) {
-		gUSBDEndpointOUT1 = false; // *** check whether this pattern has a race condition
-		
-		USBEndpointOUT1(*this);
-		}
-	
-	// MAX key pressed?
-	if (fMAX.WasKeyPressed())
-		ProcessMAXKeyPress();
+	HAL::Wait();
 	
-	// quadrature decoder report?
-	if (fQDEC)
-		ProcessQDEC();
+	Run();
 	}
 }
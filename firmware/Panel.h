@@ -8,8 +8,12 @@
 
 #pragma once
 
+#include "Acceleration.h"
+#include "Channel.h"
 #include "MAX6954.h"
 #include "QDEC.h"
+#include "RTC.h"
+#include "SoftQDEC.h"
 #include "SPIM.h"
 
 
@@ -18,27 +22,65 @@
 
 */
 struct Panel {
+	static constexpr uint8_t kPages = 1;	// radio pages
+	static constexpr uint32_t kQuietTicks = 5 * RTC::kFrequency; // unchanged this long before the state is saved
+	static constexpr Channel::Band kBand = Channel::kCOM833;
+	static constexpr uint8_t kEncoders = 1 + SoftQDEC::kInstances; // the QDEC's, then any SoftQDECs'
+	static constexpr uint8_t kDisplayChips = 1; // MAX6954s chained on the SPIM; the first scans the keys
+	
+	enum Key : uint8_t {			// MAX key bank * 8 + bit
+		kKeyDecimals = 0,		// held, the QDEC's encoder turns the fine knob
+		kKeyFlip = 1			// swaps active and standby
+		};
+
 protected:	
-	signed		fAccumulate;
-	unsigned
-			fValue = 121500,
-			fValueStandby = 122900;
+	signed		fAccumulate[kEncoders];	// counts short of a detent, per encoder
+	uint32_t	fEventOverflows = 0;	// as last logged
+	uint32_t	fKeys = 0;		// MAX key bits of every bank, as last read
+	uint32_t	fChanged;		// RTC ticks at the last change not yet saved
+	bool		fUnsaved = false;
+	bool		fSuspended = false;	// display shut down while the USB bus is suspended
+	uint16_t	fChannel,		// Channel index in kBand
+			fChannelStandby;
 	
+	RTC		fRTC;
 	SPIM		fSPIM;
+	MAXBus		fBus;
 	MAX6954		fMAX;
 	QDEC		fQDEC;
+	Acceleration	fAcceleration;
 	
 	
 	void		UpdateOneDisplay(uint8_t base, unsigned value);
 	void		UpdateDisplay();
-	void		ProcessQDEC();
-	void		ProcessMAXKeyPress();
+	void		ProcessQDEC(uint8_t encoder, int32_t accumulator, uint32_t time);
+	void		StepStandby(Channel::Knob, signed detents);
+	void		ProcessMAXKeyPress(uint32_t time);
+	void		UpdateKeys(uint32_t debounced, uint32_t pressed, uint32_t time);
+	void		ProcessKeys(uint32_t before, uint32_t debounced, uint32_t pressed, uint32_t time);
+	void		ProcessKey(uint8_t key, bool down, uint32_t time);
+	void		Report(int16_t delta, uint32_t time);
+	void		Changed();
+	void		Save(uint32_t time);
+	void		Wakeup();
 
 public:
 			Panel();
 	
 	void		Loop();
+	void		Run();
+	void		Suspend();
+	void		Resume();
 	void		SetValue(unsigned, unsigned);
+	unsigned	Value() const { return Channel::Frequency(kBand, fChannel); }
+	unsigned	ValueStandby() const { return Channel::Frequency(kBand, fChannelStandby); }
+	uint32_t	Keys() const { return fKeys; }
+	
+	uint8_t		AccelerationCurve() const { return fAcceleration.Selected(); }
+	bool		SetAccelerationCurve(uint8_t curve);
+	QDEC::Mode	EncoderSampling() const { return fQDEC.Sampling(); }
+	bool		SetEncoderSampling(uint8_t mode);
+	bool		SetEncoder(uint8_t curve, uint8_t mode);
 	};
 
 
@@ -0,0 +1,153 @@
+/*
+
+	Persist
+	
+	Panel state kept in flash across power cycles
+	
+*/
+
+#include "HAL.h"
+#include "Log.h"
+#include "Persist.h"
+
+
+static constexpr uint32_t kErased = 0xffffffff;
+static constexpr size_t kPageWords = HAL::Flash::kPageSize / sizeof(uint32_t);
+
+unsigned Persist::gPage;
+uint32_t Persist::gGeneration;
+size_t Persist::gNext;
+std::optional<Persist::Record> Persist::gSaved;
+
+
+/*	operator==
+	Same state
+*/
+bool Persist::Record::operator==(
+	const Record	&other
+	) const
+{
+return
+	value == other.value && valueStandby == other.valueStandby &&
+	accelerationCurve == other.accelerationCurve && encoderSampling == other.encoderSampling;
+}
+
+
+/*	Records
+	Records each page holds
+*/
+size_t Persist::Records()
+{
+return (kPageWords - 1 /* generation */) / kRecordWords;
+}
+
+
+/*	Check
+	Check word for a record's first kRecordWords - 1 words
+	
+	Never kErased, so a record whose check word wasn't written never checks.
+*/
+uint32_t Persist::Check(
+	const uint32_t	*const words
+	)
+{
+// FNV-1a, a word at a time
+uint32_t check = 2166136261;
+for (size_t i = 0; i < kRecordWords - 1; i++)
+	check = (check ^ words[i]) * 16777619;
+
+return check == kErased ? 0 : check;
+}
+
+
+/*	Append
+	Write the record into the given (erased) record slot of a page
+*/
+void Persist::Append(
+	const unsigned	page,
+	const size_t	record,
+	const Record	&state
+	)
+{
+const uint32_t words[kRecordWords - 1] = {
+	state.value,
+	state.valueStandby,
+	static_cast<uint32_t>(state.accelerationCurve | state.encoderSampling << 8)
+	};
+
+const size_t base = 1 + record * kRecordWords;
+for (size_t i = 0; i < kRecordWords - 1; i++)
+	HAL::Flash::Write(page, base + i, words[i]);
+
+// the check word makes the record count
+HAL::Flash::Write(page, base + kRecordWords - 1, Check(words));
+}
+
+
+/*	Load
+	Find the most recently saved state, if any
+	
+	Also finds where the next save goes, so must be called before Save().
+*/
+std::optional<Persist::Record> Persist::Load()
+{
+// current page is the one with the later generation
+const uint32_t generation0 = HAL::Flash::Page(0)[0], generation1 = HAL::Flash::Page(1)[0];
+if (generation0 == kErased && generation1 == kErased) {
+	gGeneration = 0;
+	gSaved.reset();
+	return gSaved;
+	}
+
+gPage = generation1 != kErased && (generation0 == kErased || generation1 > generation0);
+gGeneration = gPage ? generation1 : generation0;
+
+// the last record that checks is the latest; the next save goes after the last one written at all
+const uint32_t *const words = HAL::Flash::Page(gPage);
+gSaved.reset();
+gNext = 0;
+for (size_t record = 0; record < Records(); record++) {
+	const uint32_t *const w = words + 1 + record * kRecordWords;
+	
+	if (w[kRecordWords - 1] == Check(w))
+		gSaved = Record { w[0], w[1], static_cast<uint8_t>(w[2]), static_cast<uint8_t>(w[2] >> 8) };
+	
+	for (size_t i = 0; i < kRecordWords; i++)
+		if (w[i] != kErased) {
+			gNext = record + 1;
+			break;
+			}
+	}
+
+return gSaved;
+}
+
+
+/*	Save
+	Keep the given state, unless it's what was kept last
+*/
+void Persist::Save(
+	const Record	&state
+	)
+{
+if (gSaved && *gSaved == state) return;
+
+// room left in the current page?
+if (gGeneration != 0 && gNext < Records())
+	Append(gPage, gNext++, state);
+
+// start the other page (or the first) with this record, then make it current
+else {
+	const unsigned page = gGeneration != 0 ? gPage ^ 1 : 0;
+	
+	HAL::Flash::Erase(page);
+	Append(page, 0, state);
+	HAL::Flash::Write(page, 0, ++gGeneration);
+	
+	gPage = page;
+	gNext = 1;
+	}
+
+gSaved = state;
+Log::Write(Log::kLogStateSaved, gPage, gNext - 1);
+}
@@ -0,0 +1,56 @@
+/*
+
+	Persist
+	
+	Panel state kept in flash across power cycles
+	
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+
+/*	Persist
+	Log-structured record area over two flash pages
+	
+	Each save appends a record to the current page rather than rewriting one place, so a page is only erased
+	once it fills; the two pages take turns, which spreads the erases evenly.  A record's check word is
+	written last, so a save cut short by power loss leaves a record that doesn't check, and the one before
+	it is used.  Likewise a page only becomes current once the record copied into it is written, when its
+	generation is.
+	
+	Page layout: word 0 is the page's generation (erased, 0xffffffff, when the page isn't in use), then
+	kRecords records of kRecordWords words each.
+*/
+struct Persist {
+	/*	Record
+		What's kept
+	*/
+	struct Record {
+		uint32_t	value,
+				valueStandby;
+		uint8_t		accelerationCurve,
+				encoderSampling;
+		
+		bool		operator==(const Record&) const;
+		};
+	
+	static constexpr size_t kRecordWords = 4;	// value, value standby, settings, check
+
+protected:
+	static unsigned	gPage;		// current page
+	static uint32_t	gGeneration;	// of the current page; 0 when neither page is in use
+	static size_t	gNext;		// first free record in the current page
+	static std::optional<Record> gSaved;
+	
+	static uint32_t	Check(const uint32_t *words);
+	static void	Append(unsigned page, size_t record, const Record&);
+
+public:
+	static size_t	Records();
+	static std::optional<Record> Load();
+	static void	Save(const Record&);
+	};
@@ -0,0 +1,105 @@
+/*
+
+	Profile
+	
+	Cycle counts of the event loop's hot paths
+	
+*/
+
+#include "HAL.h"
+#include "Profile.h"
+
+
+/*	gProbes
+	Statistics, per probe
+*/
+Profile::Statistics Profile::gProbes[kProbes];
+
+
+/*	Scope
+	Note the cycle count at the start of the scope
+*/
+Profile::Scope::Scope(
+	const Probe	probe
+	) :
+	fProbe(probe),
+	fStart(HAL::Cycles::Now())
+{
+}
+
+
+/*	~Scope
+	Record the cycles spent since the start of the scope
+*/
+Profile::Scope::~Scope()
+{
+// unsigned difference is right across counter wrap-around
+Record(fProbe, HAL::Cycles::Now() - fStart);
+}
+
+
+/*	Start
+	Start counting cycles
+*/
+void Profile::Start()
+{
+HAL::Cycles::Start();
+}
+
+
+/*	Record
+	Account for one pass through the probe
+*/
+void Profile::Record(
+	const Probe	probe,
+	const uint32_t	cycles
+	)
+{
+Statistics &statistics = gProbes[probe];
+
+if (cycles < statistics.minimum) statistics.minimum = cycles;
+if (cycles > statistics.maximum) statistics.maximum = cycles;
+statistics.count++;
+statistics.total += cycles;
+}
+
+
+/*	Reset
+	Forget all statistics
+*/
+void Profile::Reset()
+{
+for (Statistics &statistics: gProbes)
+	statistics = Statistics();
+}
+
+
+/*	Encode
+	Write the statistics as little-endian 32-bit words; return the number of bytes written
+	
+	Each probe is minimum, maximum, count, and the low and high halves of the total.  A probe that
+	never ran reports a minimum of 0xffffffff.
+*/
+size_t Profile::Encode(
+	uint8_t		*const buffer
+	)
+{
+uint8_t *p = buffer;
+
+// write one little-endian word
+/* Byte by byte, so the encoding doesn't depend on the host it's tested on. */
+const auto word = [&p](uint32_t value) {
+	for (unsigned i = 0; i < sizeof value; i++, value >>= 8)
+		*p++ = static_cast<uint8_t>(value);
+	};
+
+for (const Statistics &statistics: gProbes) {
+	word(statistics.minimum);
+	word(statistics.maximum);
+	word(statistics.count);
+	word(static_cast<uint32_t>(statistics.total));
+	word(static_cast<uint32_t>(statistics.total >> 32));
+	}
+
+return p - buffer;
+}
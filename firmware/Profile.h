@@ -0,0 +1,77 @@
+/*
+
+	Profile
+	
+	Cycle counts of the event loop's hot paths, and the QDEC's report latency
+	
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+
+/*	Profile
+	Per-probe cycle statistics
+	
+	Each probe is only recorded from one context, so the table needs no synchronization.  The QDEC
+	latency probes are recorded from its interrupt handler, and count RTC ticks rather than cycles.
+*/
+struct Profile {
+	enum Probe : uint8_t {
+		kUpdateDisplay,
+		kUSBSetup0,
+		kProcessQDEC,
+		kStepChannel,
+		kQDECLatency,		// first sample showing movement to its report, in normal mode
+		kQDECLatencyLow,	// the same, in low-latency mode
+		kProbes
+		};
+	
+	/*	Statistics
+		Cycles (or ticks) spent in one probe
+	*/
+	struct Statistics {
+		uint32_t	minimum = UINT32_MAX,
+				maximum = 0,
+				count = 0;
+		uint64_t	total = 0;
+		};
+	
+	static constexpr size_t kEncodedStatistics = 5 * sizeof(uint32_t);	// as Encode() writes them
+	static constexpr size_t kEncoded = kProbes * kEncodedStatistics;
+	
+	/*	Scope
+		Count the cycles until the end of the enclosing scope
+	*/
+	struct Scope {
+	protected:
+		const Probe	fProbe;
+		const uint32_t	fStart;
+	
+	public:
+				Scope(Probe);
+				~Scope();
+		};
+
+protected:
+	static Statistics gProbes[kProbes];
+
+public:
+	static void	Start();
+	static void	Record(Probe, uint32_t cycles);
+	static const Statistics &Probed(Probe probe) { return gProbes[probe]; }
+	static void	Reset();
+	static size_t	Encode(uint8_t *buffer);
+	};
+
+
+/*	PROFILE
+	Count the cycles spent in the rest of the enclosing scope against the given probe
+*/
+#ifdef INSTRUMENTATION
+	#define PROFILE(probe) const Profile::Scope profileScope(Profile::probe)
+#else
+	#define PROFILE(probe)
+#endif
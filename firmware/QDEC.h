@@ -8,7 +8,6 @@
 
 #pragma once
 
-#include <atomic>
 #include <cstdint>
 
 
@@ -17,17 +16,24 @@ extern "C" void QDEC_IRQHandler();
 
 /*	QDEC
 	Quadrature decoder
+
+	Reports are posted to the event queue with the accumulated value already read out.
 */
 struct QDEC {
+public:
+	enum Mode : uint8_t {
+		kNormal,	// 2048 us sampling, 10 samples a report; a report takes up to ~20 ms
+		kLowLatency	// 512 us sampling, every sample a report; a report takes up to 512 us
+		};
+
 protected:
-	/* verified this is lock-free on my architecture */
-	static std::atomic<bool> gReportReady;
-	
 	friend void	QDEC_IRQHandler();
 	
+	static Mode	gMode;
+
 public:
 			QDEC(uint32_t pinA, uint32_t pinB);
 	
-	explicit operator bool() const { return gReportReady.exchange(false); }
-	operator	int32_t() const;
+	Mode		Sampling() const { return gMode; }
+	void		Sampling(Mode);
 	};
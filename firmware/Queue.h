@@ -0,0 +1,125 @@
+/*
+
+	Queue
+	
+	Lock-free queue from interrupt handlers to the event loop
+	
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+
+
+/*	Queue
+	Fixed-size lock-free multiple-producer single-consumer ring
+
+	Any interrupt handler may Push(); only the event loop may Pop().  Each slot carries a sequence number
+	so that a producer can claim a slot (by advancing the head) before it has finished writing it; the
+	consumer doesn't see the slot until the producer publishes it by updating the sequence number.
+	Elements are never merged, so two of the same kind arriving before the event loop runs are both seen.
+*/
+template <typename T, unsigned qSize>
+struct Queue {
+protected:
+	static_assert(qSize > 0 && (qSize & (qSize - 1)) == 0, "queue size must be a power of two");
+	static_assert(std::atomic<uint32_t>::is_always_lock_free, "queue requires lock-free atomics");
+
+	struct Slot {
+		std::atomic<uint32_t> fSequence;
+		T		fElement;
+		};
+
+	Slot		fSlots[qSize];
+	std::atomic<uint32_t> fHead;		// next position to be claimed by a producer
+	uint32_t	fTail;			// next position to be consumed
+	std::atomic<uint32_t> fOverflows;	// elements dropped because the queue was full
+
+public:
+			Queue();
+			Queue(const Queue&) = delete;
+
+	bool		Push(const T&);
+	std::optional<T> Pop();
+	uint32_t	Overflows() const { return fOverflows.load(std::memory_order_relaxed); }
+	};
+
+
+/*	Queue
+	Construct empty queue
+*/
+template <typename T, unsigned qSize>
+Queue<T, qSize>::Queue() :
+	fHead(0),
+	fTail(0),
+	fOverflows(0)
+{
+// slot at position i is free for the producer that claims position i
+for (unsigned i = 0; i < qSize; i++)
+	fSlots[i].fSequence.store(i, std::memory_order_relaxed);
+}
+
+
+/*	Push
+	Append element; return false if the queue was full (the element is dropped)
+
+	May be called concurrently from interrupt handlers at any priority.
+*/
+template <typename T, unsigned qSize>
+bool Queue<T, qSize>::Push(
+	const T		&element
+	)
+{
+uint32_t position = fHead.load(std::memory_order_relaxed);
+Slot *slot;
+
+// claim a slot
+for (;;) {
+	slot = &fSlots[position % qSize];
+	const int32_t difference = static_cast<int32_t>(slot->fSequence.load(std::memory_order_acquire) - position);
+
+	// slot is free; try to claim it
+	if (difference == 0) {
+		if (fHead.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+		}
+
+	// slot still holds an element the consumer hasn't taken?
+	else if (difference < 0) {
+		fOverflows.fetch_add(1, std::memory_order_relaxed);
+		return false;
+		}
+
+	// another producer claimed this position first
+	else
+		position = fHead.load(std::memory_order_relaxed);
+	}
+
+// fill the slot and publish it to the consumer
+slot->fElement = element;
+slot->fSequence.store(position + 1, std::memory_order_release);
+
+return true;
+}
+
+
+/*	Pop
+	Remove the oldest published element, if any
+*/
+template <typename T, unsigned qSize>
+std::optional<T> Queue<T, qSize>::Pop()
+{
+Slot &slot = fSlots[fTail % qSize];
+
+// not yet published?
+if (slot.fSequence.load(std::memory_order_acquire) != fTail + 1) return std::nullopt;
+
+const T element = slot.fElement;
+
+// release the slot for the producer that will claim it a full lap from now
+slot.fSequence.store(fTail + qSize, std::memory_order_release);
+fTail++;
+
+return element;
+}
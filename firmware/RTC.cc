@@ -0,0 +1,54 @@
+/*
+
+	RTC
+	
+	Real-time counter interface
+	
+*/
+
+#include "Event.h"
+#include "HAL.h"
+#include "RTC.h"
+
+
+/*	RTC
+	Start the low-frequency clock and the counter
+*/
+RTC::RTC()
+{
+HAL::RTC::Start();
+}
+
+
+/*	RTC1_IRQHandler
+	This overrides a weak definition of a default interrupt handler in gcc_startup_nrf52840.S
+*/
+extern "C" void RTC1_IRQHandler()
+{
+if (HAL::RTC::Alarmed())
+	(void) gEvents.Push({ Event::kAlarm, {}, HAL::RTC::Now() });
+}
+
+
+/*	Alarm
+	Post an alarm event when the counter reaches the given value
+	
+	Replaces any alarm not yet gone off.  The value must be at least two ticks ahead.
+*/
+void RTC::Alarm(
+	uint32_t	at
+	)
+{
+HAL::RTC::Alarm(at);
+}
+
+
+/*	Now
+	Current counter value
+	
+	Safe to call from interrupt handlers.
+*/
+uint32_t RTC::Now()
+{
+return HAL::RTC::Now();
+}
@@ -0,0 +1,28 @@
+/*
+
+	RTC
+	
+	Real-time counter interface
+	
+*/
+
+#pragma once
+
+#include <cstdint>
+
+
+/*	RTC
+	Free-running 32.768 kHz time base
+*/
+struct RTC {
+	static constexpr uint32_t kFrequency = 32768;	// ticks per second
+	static constexpr uint32_t kMask = 0xffffff;	// counter is 24 bits
+	
+			RTC();
+	
+	static uint32_t	Now();
+	static void	Alarm(uint32_t at);
+	
+	// ticks from one counter value to a later one, across wrap-around
+	static constexpr uint32_t Elapsed(uint32_t from, uint32_t to) { return (to - from) & kMask; }
+	};
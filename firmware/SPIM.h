@@ -8,20 +8,25 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 
 
 extern "C" void SPIM3_IRQHandler();
+extern "C" void TIMER0_IRQHandler();
 
 
 /*	SPIM
 	SPI master
 */
 struct SPIM {
+	static constexpr size_t kSequenceMaximum = 64;	// words in one sequence
+
 protected:
 	static volatile bool gEnd;
 	
 	friend void SPIM3_IRQHandler();
+	friend void TIMER0_IRQHandler();
 	
 public:
 			SPIM(
@@ -32,4 +37,5 @@ public:
 				);
 	
 	uint16_t	operator()(uint16_t) const;
+	void		operator()(const uint16_t *out, uint16_t *in, size_t count, size_t frame = 1) const;
 	};
@@ -0,0 +1,322 @@
+/*
+
+	SimulationHAL
+	
+	Hardware abstraction simulated on Linux
+	
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "Event.h"
+#include "State.h"
+
+
+struct Panel;
+
+extern "C" void GPIOTE_IRQHandler();
+extern "C" void QDEC_IRQHandler();
+extern "C" void RTC1_IRQHandler();
+extern "C" void SPIM3_IRQHandler();
+extern "C" void TIMER0_IRQHandler();
+extern "C" void TIMER1_IRQHandler();
+extern "C" void TIMER2_IRQHandler();
+extern "C" void TIMER3_IRQHandler();
+extern "C" void TIMER4_IRQHandler();
+
+
+/*	SimulationHAL
+	Policies modelling the nRF52840 peripherals
+	
+	Stimulus functions (Turn(), Edge(), Trigger(), Advance()) set the modelled peripheral state and then call the
+	interrupt handler the way the hardware would.
+*/
+struct SimulationHAL {
+	static constexpr uint32_t Pin(unsigned port, unsigned pin) { return port << 5 | (pin & 0x1f); }
+	
+	// nothing to wait for; the simulation drives the event loop
+	static void	Wait() {}
+	
+	
+	/*	SPI
+		SPI master; transactions are handed to a model of the device on the bus
+	*/
+	struct SPI {
+		// given the bytes clocked out, fill in the bytes clocked in (default: bus reads as zero)
+		static inline std::function<void(const uint8_t *out, size_t outLength, uint8_t *in, size_t inLength)> gDevice;
+		static inline bool gEnd, gSequenceEnd;
+		
+		static void	Configure(uint32_t, uint32_t, uint32_t, uint32_t) {}
+		
+		static void	Start(const void *out, size_t outLength, void *in, size_t inLength) {
+					if (gDevice)
+						gDevice(static_cast<const uint8_t*>(out), outLength, static_cast<uint8_t*>(in), inLength);
+					else
+						memset(in, 0, inLength);
+					
+					gEnd = true;
+					SPIM3_IRQHandler();
+					}
+		
+		static bool	End() { return std::exchange(gEnd, false); }
+		
+		// each transaction of a sequence is handed to the device on its own, as chip select rises between them
+		static void	Sequence(const void *out, void *in, size_t length, size_t count) {
+					for (size_t i = 0; i < count; i++)
+						if (gDevice)
+							gDevice(static_cast<const uint8_t*>(out) + i * length, length, static_cast<uint8_t*>(in) + i * length, length);
+						else
+							memset(static_cast<uint8_t*>(in) + i * length, 0, length);
+					
+					gSequenceEnd = true;
+					TIMER0_IRQHandler();
+					}
+		
+		static bool	SequenceEnd() { return std::exchange(gSequenceEnd, false); }
+		};
+	
+	
+	/*	QDEC
+		Quadrature decoder
+	*/
+	struct QDEC {
+		static inline bool gLowLatency, gSampleInterrupt, gReport, gSample;
+		static inline int32_t gAccumulated, gSampled,
+				gACC;		// since the last report, as Step() samples
+		static inline uint32_t gSamplePeriod,	// us, as nRFHAL sets SAMPLEPER
+				gReportPeriod,		// samples, as REPORTPER
+				gSamples;		// since the last report
+		static inline uint64_t gElapsed;	// us sampled
+		
+		static void	Configure(uint32_t, uint32_t, bool lowLatency, bool sampleInterrupt) {
+					gSampleInterrupt = sampleInterrupt;
+					Sampling(lowLatency);
+					}
+		
+		// stopped and started again: ACC carries over
+		static void	Sampling(bool lowLatency) {
+					gLowLatency = lowLatency;
+					gSamplePeriod = lowLatency ? 512 : 2048;
+					gReportPeriod = lowLatency ? 1 : 10;
+					gSamples = 0;
+					}
+		
+		static bool	Report() { return std::exchange(gReport, false); }
+		static int32_t	Accumulated() { return gAccumulated; }
+		static bool	Sample() { return std::exchange(gSample, false); }
+		static int32_t	Sampled() { return gSampled; }
+		
+		// stimulus: report the given number of samples of rotation
+		static void	Turn(int32_t samples) {
+					if (gSampleInterrupt) {
+						gSampled = samples > 0 ? 1 : -1;
+						gSample = true;
+						QDEC_IRQHandler();
+						}
+					
+					gAccumulated = samples;
+					gReport = true;
+					QDEC_IRQHandler();
+					}
+		
+		// stimulus: one sampling period passes, with the encoder a step on either way or not; the RTC runs on
+		static void	Step(int32_t step) {
+					const uint64_t before = gElapsed * 32768 / 1000000;
+					gElapsed += gSamplePeriod;
+					RTC::Advance(static_cast<uint32_t>(gElapsed * 32768 / 1000000 - before));
+					
+					gSampled = step;
+					gSample = gSampleInterrupt;
+					gACC += step;
+					
+					// a report only once there is something in ACC
+					if (++gSamples >= gReportPeriod) {
+						gSamples = 0;
+						if (gACC != 0) {
+							gAccumulated = std::exchange(gACC, 0);
+							gReport = true;
+							}
+						}
+					
+					if (gSample || gReport) QDEC_IRQHandler();
+					}
+		};
+	
+	
+	/*	GPIOTE
+		Pin change events
+	*/
+	struct GPIOTE {
+		static inline bool gTriggered[8];
+		
+		static void	Configure(unsigned, uint32_t) {}
+		static bool	Triggered(unsigned channel) { return std::exchange(gTriggered[channel], false); }
+		
+		// stimulus: falling edge on the channel's pin
+		static void	Trigger(unsigned channel) {
+					gTriggered[channel] = true;
+					GPIOTE_IRQHandler();
+					}
+		};
+	
+	
+	/*	SoftQDEC
+		Quadrature decoders in GPIOTE, PPI and TIMERs; the model does what the PPI wiring does with each edge
+	*/
+	struct SoftQDEC {
+		static constexpr unsigned kInstances = 2;
+		
+		struct Counts {
+			uint32_t	forward,
+					backward;
+			};
+		
+		struct Decoder {
+			bool		pins[2],	// A, B
+					odd,		// parity PPI keeps
+					compared;
+			Counts		counted,
+					compare;
+			};
+		
+		static inline Decoder gDecoders[kInstances];
+		
+		static void	Configure(unsigned instance, uint32_t, uint32_t) { gDecoders[instance] = { { true, true }, false, false, {}, {} }; }
+		
+		static bool	Resync(unsigned instance) {
+					Decoder &d = gDecoders[instance];
+					const bool odd = d.pins[0] != d.pins[1];
+					return std::exchange(d.odd, odd) != odd;
+					}
+		
+		static unsigned	Phase(unsigned instance) {
+					static constexpr uint8_t kPhases[2][2] = { { 2, 1 }, { 3, 0 } };
+					return kPhases[gDecoders[instance].pins[0]][gDecoders[instance].pins[1]];
+					}
+		
+		static bool	Compared(unsigned instance) { return std::exchange(gDecoders[instance].compared, false); }
+		static Counts	Counted(unsigned instance) { return gDecoders[instance].counted; }
+		static void	Compare(unsigned instance, const Counts &at) { gDecoders[instance].compare = at; }
+		
+		// stimulus: an edge on pin A or B, unseen if it was too short for GPIOTE
+		static void	Edge(unsigned instance, bool pinB, bool seen = true) {
+					static void (*const kHandlers[kInstances][2])() = { { TIMER1_IRQHandler, TIMER2_IRQHandler }, { TIMER3_IRQHandler, TIMER4_IRQHandler } };
+					
+					Decoder &d = gDecoders[instance];
+					d.pins[pinB] = !d.pins[pinB];
+					if (!seen) return;
+					
+					const bool forward = d.odd == pinB;
+					d.odd = !d.odd;
+					if (++(forward ? d.counted.forward : d.counted.backward) == (forward ? d.compare.forward : d.compare.backward)) {
+						d.compared = true;
+						kHandlers[instance][!forward]();
+						}
+					}
+		};
+	
+	
+	/*	Cycles
+		Processor cycle counter
+	*/
+	struct Cycles {
+		static inline uint32_t gNow;
+		
+		static void	Start() {}
+		static uint32_t	Now() { return gNow; }
+		
+		// stimulus: spend cycles
+		static void	Advance(uint32_t cycles) { gNow += cycles; }
+		};
+	
+	
+	/*	RTC
+		Real-time counter
+	*/
+	struct RTC {
+		static inline uint32_t gNow, gAlarm;
+		static inline bool gAlarmSet, gAlarmed;
+		
+		static void	Start() {}
+		static uint32_t	Now() { return gNow & 0xffffff; }
+		
+		static void	Alarm(uint32_t at) { gAlarm = at & 0xffffff; gAlarmSet = true; }
+		static bool	Alarmed() { return std::exchange(gAlarmed, false); }
+		
+		// stimulus: let time pass, going off at the alarm on the way
+		static void	Advance(uint32_t ticks) {
+					for (; ticks > 0; ticks--) {
+						gNow++;
+						if (gAlarmSet && Now() == gAlarm) {
+							gAlarmSet = false;
+							gAlarmed = true;
+							RTC1_IRQHandler();
+							}
+						}
+					}
+		};
+	
+	
+	/*	Flash
+		Flash pages, as an array; writes only clear bits, as in the NVMC
+	*/
+	struct Flash {
+		static constexpr uint32_t kPageSize = 4096;
+		static constexpr unsigned kPages = 2;
+		static constexpr size_t kPageWords = kPageSize / sizeof(uint32_t);
+		
+		static inline std::vector<uint32_t> gWords = std::vector<uint32_t>(kPages * kPageWords, 0xffffffff);
+		static inline unsigned gErases[kPages];
+		static inline size_t gWritesLeft = SIZE_MAX;	// power fails after this many more writes
+		
+		static const uint32_t *Page(unsigned page) { return gWords.data() + page * kPageWords; }
+		
+		static void	Erase(unsigned page) {
+					if (gWritesLeft == 0) return;
+					gWritesLeft--;
+					std::fill_n(gWords.begin() + page * kPageWords, kPageWords, 0xffffffff);
+					gErases[page]++;
+					}
+		
+		static void	Write(unsigned page, size_t word, uint32_t value) {
+					if (gWritesLeft == 0) return;
+					gWritesLeft--;
+					gWords[page * kPageWords + word] &= value;
+					}
+		};
+	
+	
+	/*	USBD
+		USB device stack; records what the panel sends to the host
+		
+		A test of the USB stack itself sets the hooks to the functions in USB.cc, which then run against
+		the USBD register model.
+	*/
+	struct USBD {
+		static inline std::vector<State::Values> gReports;
+		static inline unsigned gWakeups;
+		static inline void (*gHandle)(Panel&, const Event&);
+		static inline void (*gReport)(const State::Values&);
+		static inline void (*gWakeup)();
+		
+		static void	Handle(Panel &panel, const Event &event) { if (gHandle) gHandle(panel, event); }
+		
+		static void	Report(const State::Values &values) {
+					gReports.push_back(values);
+					if (gReport) gReport(values);
+					}
+		
+		static void	Wakeup() {
+					gWakeups++;
+					if (gWakeup) gWakeup();
+					}
+		};
+	};
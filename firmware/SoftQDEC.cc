@@ -0,0 +1,107 @@
+/*
+
+	SoftQDEC
+	
+	Quadrature decoders in GPIOTE, PPI and TIMERs
+	
+*/
+
+#include "Event.h"
+#include "HAL.h"
+#include "Log.h"
+#include "RTC.h"
+#include "SoftQDEC.h"
+
+
+static_assert(SoftQDEC::kInstances <= HAL::SoftQDEC::kInstances, "not enough hardware for the decoders");
+
+
+/*	Decoder
+	What the CPU knows of a decoder
+*/
+struct Decoder {
+	int32_t		position,	// edges forward since configuring
+			reported;	// ... as of the last report
+	HAL::SoftQDEC::Counts counted;	// as of the last interrupt
+	};
+
+static Decoder gDecoders[SoftQDEC::kInstances];
+
+
+/*	TIMER1_IRQHandler, TIMER2_IRQHandler, TIMER3_IRQHandler, TIMER4_IRQHandler
+	These override weak definitions of default interrupt handlers in gcc_startup_nrf52840.S; each
+	instance's forward and backward counts
+*/
+extern "C" void TIMER1_IRQHandler() { SoftQDEC::Report(0); }
+extern "C" void TIMER2_IRQHandler() { SoftQDEC::Report(0); }
+extern "C" void TIMER3_IRQHandler() { SoftQDEC::Report(1); }
+extern "C" void TIMER4_IRQHandler() { SoftQDEC::Report(1); }
+
+
+/*	Report
+	Take in the edges counted since the last interrupt, and post them once the knob is in a detent
+	
+	Once GPIOTE misses an edge, every edge after it is counted the wrong way, so the count runs two edges
+	further off with each; being interrupted at every edge catches it at the first, while it can still be
+	put right.  That is four interrupts a detent, still only one report.
+*/
+void SoftQDEC::Report(
+	unsigned	instance
+	)
+{
+if (!HAL::SoftQDEC::Compared(instance)) return;
+
+Decoder &decoder = gDecoders[instance];
+HAL::SoftQDEC::Counts counted = HAL::SoftQDEC::Counted(instance);
+int32_t moved = 0;
+
+// an edge went by unseen?
+/* Then the edge after it was counted the wrong way; the pins say how far into a detent the knob really is,
+   so the count is turned around and put right to the nearest position that agrees. */
+bool resynced = HAL::SoftQDEC::Resync(instance);
+if (resynced) Log::Write(Log::kLogEncoderResync, 1 + instance);
+const unsigned phase = HAL::SoftQDEC::Phase(instance);
+
+for (;;) {
+	// differences wrap around with the counts
+	moved += static_cast<int32_t>(counted.forward - decoder.counted.forward) - static_cast<int32_t>(counted.backward - decoder.counted.backward);
+	decoder.counted = counted;
+	
+	if (resynced) {
+		moved = -moved;
+		const int32_t off = (phase - static_cast<uint32_t>(decoder.position + moved)) % kEdges;
+		moved += off > kEdges / 2 ? off - kEdges : off;
+		resynced = false;
+		}
+	
+	HAL::SoftQDEC::Compare(instance, { counted.forward + 1, counted.backward + 1 });
+	
+	// counted on while the compare values were set, maybe past them?
+	const HAL::SoftQDEC::Counts again = HAL::SoftQDEC::Counted(instance);
+	if (again.forward == counted.forward && again.backward == counted.backward) break;
+	counted = again;
+	}
+
+decoder.position += moved;
+if (decoder.position % kEdges == 0 && decoder.position != decoder.reported) {
+	(void) gEvents.Push({ Event::kQDECReport, { .accumulator = decoder.position - decoder.reported }, RTC::Now(), static_cast<uint8_t>(1 + instance) });
+	decoder.reported = decoder.position;
+	}
+}
+
+
+/*	SoftQDEC
+	Configure a decoder; the knob should be resting in a detent
+*/
+SoftQDEC::SoftQDEC(
+	uint8_t		instance,
+	uint32_t	pinA,
+	uint32_t	pinB
+	) :
+	fInstance(instance)
+{
+gDecoders[instance] = {};
+
+HAL::SoftQDEC::Configure(instance, pinA, pinB);
+HAL::SoftQDEC::Compare(instance, { 1, 1 });
+}
@@ -0,0 +1,50 @@
+/*
+
+	SoftQDEC
+	
+	Quadrature decoders in GPIOTE, PPI and TIMERs, for the encoders beyond the one the QDEC decodes
+	
+*/
+
+#pragma once
+
+#include <cstdint>
+
+#include "QDEC.h"
+
+
+extern "C" void TIMER1_IRQHandler();
+extern "C" void TIMER2_IRQHandler();
+extern "C" void TIMER3_IRQHandler();
+extern "C" void TIMER4_IRQHandler();
+
+
+/*	SoftQDEC
+	Quadrature decoder without the QDEC
+	
+	Every edge is counted in hardware as it happens, so there is no sampling period to choose.  The CPU is
+	interrupted at every edge to keep the count in step with the pins; reports are posted to the event
+	queue as the QDEC's are, with the encoder they came from, once the knob is in a detent.
+*/
+struct SoftQDEC {
+public:
+	static constexpr unsigned kInstances = 2;	// as many as there are TIMERs and PPI groups for
+	static constexpr int32_t kEdges = 4;		// per detent
+
+protected:
+	friend void	TIMER1_IRQHandler();
+	friend void	TIMER2_IRQHandler();
+	friend void	TIMER3_IRQHandler();
+	friend void	TIMER4_IRQHandler();
+	
+	const uint8_t	fInstance;
+	
+	static void	Report(unsigned instance);
+
+public:
+			SoftQDEC(uint8_t instance, uint32_t pinA, uint32_t pinB);
+	
+	uint8_t		Encoder() const { return 1 + fInstance; }
+	QDEC::Mode	Sampling() const { return QDEC::kLowLatency; }
+	void		Sampling(QDEC::Mode) {}
+	};
@@ -0,0 +1,49 @@
+/*
+
+	State
+	
+	Panel state Input report, shared by the firmware and the host
+	
+	One report carries the whole panel in a single 64-byte packet, which a full-speed interrupt endpoint can
+	deliver every 1 ms frame: the values of each radio page, the keys down, the encoder detents turned since
+	the previous state report, and when the state last changed.  Multi-byte fields are little-endian at fixed
+	offsets, and unused bytes are zero.  kLayout changes whenever a field moves, so the host can tell whether
+	it knows how to read the report.
+	
+*/
+
+#pragma once
+
+#include <cstdint>
+
+
+namespace State {
+	/*	Offset
+		Where each field starts, counting the report ID as byte 0
+	*/
+	enum Offset : uint8_t {
+		kOffsetLayout = 1,	// uint8_t: kLayout
+		kOffsetPages = 2,	// uint8_t: radio pages at kOffsetValues
+		kOffsetSequence = 4,	// uint16_t: state reports sent since reset, wrapping
+		kOffsetDelta = 6,	// int16_t: encoder detents since the previous state report
+		kOffsetTime = 8,	// uint32_t: RTC ticks when the state last changed
+		kOffsetKeys = 12,	// uint32_t: MAX key bits, bank A in the low byte
+		kOffsetValues = 16	// uint32_t active and standby value, per page
+		};
+	
+	constexpr uint8_t kLayout = 2;
+	constexpr uint16_t kReportLength = 64;	// including the ID; also the endpoint's maximum packet size
+	constexpr uint8_t kPagesMaximum = (kReportLength - kOffsetValues) / (2 * sizeof(uint32_t));
+	
+	
+	/*	Values
+		What the panel reports of itself
+	*/
+	struct Values {
+		uint32_t	time;		// RTC ticks
+		uint32_t	value,
+				valueStandby;
+		int16_t		delta;		// detents turned in this change
+		uint32_t	keys;
+		};
+	}
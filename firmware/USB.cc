@@ -15,6 +15,7 @@
 #include <inttypes.h>
 
 #include <algorithm>
+#include <cstring>
 
 #include <nrf_clock.h>
 #include <nrf_gpio.h>
@@ -22,7 +23,13 @@
 #include <nrf_usbd.h>
 #include <nrf52_erratas.h>
 
+#include "Capabilities.h"
+#include "Diagnostics.h"
+#include "Event.h"
+#include "Log.h"
 #include "Panel.h"
+#include "Profile.h"
+#include "State.h"
 #include "USB.h"
 
 
@@ -32,12 +39,6 @@ using namespace USB;
 #define PIN_LED_BLUE NRF_GPIO_PIN_MAP(1, 10)
 
 
-/*	gUSBDDetected
-	USB power detected (edge)
-*/
-volatile bool gUSBDDetected;
-
-
 /*	gUSBPowerReady
 	USB power ready (level)
 */
@@ -54,7 +55,7 @@ extern "C" void POWER_CLOCK_IRQHandler()
 if (nrf_power_event_check(NRF_POWER_EVENT_USBDETECTED)) {
 	nrf_power_event_clear(NRF_POWER_EVENT_USBDETECTED);
 
-	gUSBDDetected = true;
+	(void) gEvents.Push({ Event::kUSBDetected, {} });
 	}
 
 if (nrf_power_event_check(NRF_POWER_EVENT_USBREMOVED)) {
@@ -93,16 +94,114 @@ nrf_power_int_enable(
 }
 
 
-/*	gUSBDEndpointOUT0SETUP
+/*	DMAChannel
+	EasyDMA transfers, one per endpoint and direction; when several are waiting, the first here goes first
+	
+	Endpoint 0 comes first, since the host times out its control transfers.
+*/
+enum DMAChannel : uint8_t {
+	kDMAIN0,
+	kDMAOUT0,
+	kDMAIN1,
+	kDMAOUT1,
+	kDMAIN2,
+	kDMAOUT2,
+	kDMAChannels
+	};
+
+static constexpr uint8_t kDMAEndpoints[kDMAChannels] = {
+	NRF_USBD_EPIN(0), NRF_USBD_EPOUT(0), NRF_USBD_EPIN(1), NRF_USBD_EPOUT(1), NRF_USBD_EPIN(2), NRF_USBD_EPOUT(2)
+	};
+static constexpr nrf_usbd_task_t kDMAStart[kDMAChannels] = {
+	NRF_USBD_TASK_STARTEPIN0, NRF_USBD_TASK_STARTEPOUT0, NRF_USBD_TASK_STARTEPIN1,
+	NRF_USBD_TASK_STARTEPOUT1, NRF_USBD_TASK_STARTEPIN2, NRF_USBD_TASK_STARTEPOUT2
+	};
+static constexpr nrf_usbd_event_t kDMAEnd[kDMAChannels] = {
+	NRF_USBD_EVENT_ENDEPIN0, NRF_USBD_EVENT_ENDEPOUT0, NRF_USBD_EVENT_ENDEPIN1,
+	NRF_USBD_EVENT_ENDEPOUT1, NRF_USBD_EVENT_ENDEPIN2, NRF_USBD_EVENT_ENDEPOUT2
+	};
+
+
+/*	gDMA
+	EasyDMA arbitration
+	
+	[nRFPS §6.35.5] Only one EasyDMA transfer may be in progress at a time, on any endpoint.  A transfer
+	started while another is in progress waits for that one's ENDEPIN or ENDEPOUT, on which USBD_IRQHandler
+	starts it.  The event loop only changes this with the USBD interrupt disabled.
+*/
+static struct DMA {
+	volatile bool	fBusy;
+	volatile uint8_t fWaiting;	// DMAChannel bits
+	uintptr_t	fAddress[kDMAChannels];
+	uint16_t	fLength[kDMAChannels];
+	} gDMA;
+
+
+/*	DMATrigger
+	Start a transfer; the DMA is free
+*/
+static void DMATrigger(
+	const DMAChannel channel
+	)
+{
+gDMA.fBusy = true;
+nrf_usbd_ep_easydma_set(kDMAEndpoints[channel], gDMA.fAddress[channel], gDMA.fLength[channel]);
+nrf_usbd_task_trigger(kDMAStart[channel]);
+}
 
+
+/*	DMAStart
+	Move a packet between RAM and an endpoint's buffer, now or once the DMA is free
+	
+	The RAM must stay as it is until the channel's ENDEP event.
 */
-volatile bool gUSBDEndpointOUT0SETUP;
+static void DMAStart(
+	const DMAChannel channel,
+	const void	*const data,
+	const uint16_t	length
+	)
+{
+NVIC_DisableIRQ(USBD_IRQn);
+
+gDMA.fAddress[channel] = reinterpret_cast<uintptr_t>(data);
+gDMA.fLength[channel] = length;
+
+if (gDMA.fBusy)
+	gDMA.fWaiting |= 1 << channel;
+else
+	DMATrigger(channel);
+
+NVIC_EnableIRQ(USBD_IRQn);
+}
 
 
-/*	gUSBDEndpointOUT1
+/*	DMACancel
+	Drop a transfer that is still waiting for the DMA
+*/
+static void DMACancel(
+	const DMAChannel channel
+	)
+{
+NVIC_DisableIRQ(USBD_IRQn);
+gDMA.fWaiting &= ~(1 << channel);
+NVIC_EnableIRQ(USBD_IRQn);
+}
 
+
+/*	DMAEnd
+	The transfer in progress ended: start the next one waiting, if any
+	
+	Only called from USBD_IRQHandler.
 */
-volatile bool gUSBDEndpointOUT1;
+static void DMAEnd()
+{
+gDMA.fBusy = false;
+
+if (const uint8_t waiting = gDMA.fWaiting) {
+	gDMA.fWaiting = waiting & (waiting - 1);
+	DMATrigger(static_cast<DMAChannel>(__builtin_ctz(waiting)));
+	}
+}
 
 
 /*	USBD_IRQHandler
@@ -111,31 +210,79 @@ volatile bool gUSBDEndpointOUT1;
 */
 extern "C" void USBD_IRQHandler()
 {
+// suspend, resume, or wakeup?
+/* READY is left for StartUSB() to wait on. */
 if (nrf_usbd_event_check(NRF_USBD_EVENT_USBEVENT)) {
 	nrf_usbd_event_clear(NRF_USBD_EVENT_USBEVENT);
+	
+	const uint32_t cause = nrf_usbd_eventcause_get() &
+		(NRF_USBD_EVENTCAUSE_SUSPEND_MASK | NRF_USBD_EVENTCAUSE_RESUME_MASK | NRF_USBD_EVENTCAUSE_WUREQ_MASK);
+	nrf_usbd_eventcause_clear(cause);
+	
+	if (cause & NRF_USBD_EVENTCAUSE_SUSPEND_MASK)
+		(void) gEvents.Push({ Event::kUSBSuspend, {} });
+	
+	if (cause & NRF_USBD_EVENTCAUSE_RESUME_MASK)
+		(void) gEvents.Push({ Event::kUSBResume, {}, RTC::Now() });
+	
+	if (cause & NRF_USBD_EVENTCAUSE_WUREQ_MASK)
+		(void) gEvents.Push({ Event::kUSBWakeupAllowed, {} });
+	}
+
+// bus reset?
+if (nrf_usbd_event_check(NRF_USBD_EVENT_USBRESET)) {
+	nrf_usbd_event_clear(NRF_USBD_EVENT_USBRESET);
+
+	(void) gEvents.Push({ Event::kUSBReset, {} });
+	}
+
+// start of frame?
+/* Only enabled while something is waiting on the frame count */
+if (nrf_usbd_event_check(NRF_USBD_EVENT_SOF)) {
+	nrf_usbd_event_clear(NRF_USBD_EVENT_SOF);
+
+	(void) gEvents.Push({ Event::kUSBFrame, { .frame = nrf_usbd_framecntr_get() } });
 	}
 
 // Endpoint 0 SETUP?
 if (nrf_usbd_event_check(NRF_USBD_EVENT_EP0SETUP)) {
 	nrf_usbd_event_clear(NRF_USBD_EVENT_EP0SETUP);
 
-	gUSBDEndpointOUT0SETUP = true;
+	(void) gEvents.Push({ Event::kUSBSetup, {} });
+	}
+
+// Endpoint 0 DATA stage packet acknowledged (IN) or received (OUT)?
+if (nrf_usbd_event_check(NRF_USBD_EVENT_EP0DATADONE)) {
+	nrf_usbd_event_clear(NRF_USBD_EVENT_EP0DATADONE);
+
+	(void) gEvents.Push({ Event::kUSBEndpoint0DataDone, {} });
 	}
 
+// EasyDMA transfer done?
+/* Only one is ever in progress, so the next can start right away. */
+for (unsigned channel = 0; channel < kDMAChannels; channel++)
+	if (nrf_usbd_event_check(kDMAEnd[channel])) {
+		nrf_usbd_event_clear(kDMAEnd[channel]);
+		
+		DMAEnd();
+		
+		// OUT packet now in RAM?
+		if (channel == kDMAOUT0)
+			(void) gEvents.Push({ Event::kUSBEndpoint0OUTEnd, {} });
+		else if (channel == kDMAOUT1 || channel == kDMAOUT2)
+			(void) gEvents.Push({ Event::kUSBDataOUTEnd, { .endpoint = static_cast<uint8_t>(channel == kDMAOUT1 ? 1 : 2) } });
+		}
+
 // USB Interrupt?
 if (nrf_usbd_event_check(NRF_USBD_EVENT_DATAEP)) {
 	nrf_usbd_event_clear(NRF_USBD_EVENT_DATAEP);
 	
 	// which endpoint?
+	/* The event loop dispatches on the endpoint bits; capture them here so they can't be merged with a later transfer. */
 	const uint32_t datastatus = nrf_usbd_epdatastatus_get();
 	nrf_usbd_epdatastatus_clear(datastatus);
-	if (datastatus & NRF_USBD_EPDATASTATUS_EPOUT1_MASK)
-		gUSBDEndpointOUT1 = true;
-	
-	if (datastatus & NRF_USBD_EPDATASTATUS_EPIN1_MASK);
+	(void) gEvents.Push({ Event::kUSBData, { .datastatus = datastatus } });
 	}
-
-// *** detect suspend/resume and limit power
 }
 
 
@@ -206,8 +353,16 @@ NVIC_SetPriority(USBD_IRQn, 7 /* priority */);
 NVIC_ClearPendingIRQ(USBD_IRQn);
 NVIC_EnableIRQ(USBD_IRQn);
 nrf_usbd_int_enable(
+	NRF_USBD_INT_USBRESET_MASK |
 	NRF_USBD_INT_USBEVENT_MASK |
 	NRF_USBD_INT_EP0SETUP_MASK |
+	NRF_USBD_INT_EP0DATADONE_MASK |
+	NRF_USBD_INT_ENDEPIN0_MASK |
+	NRF_USBD_INT_ENDEPOUT0_MASK |
+	NRF_USBD_INT_ENDEPIN1_MASK |
+	NRF_USBD_INT_ENDEPOUT1_MASK |
+	NRF_USBD_INT_ENDEPIN2_MASK |
+	NRF_USBD_INT_ENDEPOUT2_MASK |
 	NRF_USBD_INT_DATAEP_MASK
 	);
 }
@@ -220,9 +375,7 @@ void StartUSB()
 {
 const bool
 	erratum171 = nrf52_errata_171(),
-	erratum187 = nrf52_errata_187(),
-	erratum199 = nrf52_errata_199(),
-	erratum223 = nrf52_errata_223();
+	erratum187 = nrf52_errata_187();
 
 if (erratum187) usbd_errata_187_211_begin();
 if (erratum171) usbd_errata_171_begin();
@@ -258,20 +411,385 @@ nrf_usbd_pullup_enable();
 }
 
 
+/*	StartHFCLK
+	Start the high-frequency crystal, which USB needs, and wait for it
+*/
+static void StartHFCLK()
+{
+nrf_clock_event_clear(NRF_CLOCK_EVENT_HFCLKSTARTED);
+nrf_clock_task_trigger(NRF_CLOCK_TASK_HFCLKSTART);
+while (!nrf_clock_event_check(NRF_CLOCK_EVENT_HFCLKSTARTED));
+nrf_clock_event_clear(NRF_CLOCK_EVENT_HFCLKSTARTED);
+}
+
+
+/*	gBusPower
+	Suspend state
+	
+	[USB §9.1.1.6] After 3 ms of bus idle the device is suspended and may draw only 2.5 mA; so the display
+	is blanked, the crystal stopped, and the USBD put in low power, leaving the CPU to sleep in Wait().
+	Any resume signalling undoes that.  Turning the knob or pressing a key while suspended signals remote
+	wakeup, if the host allowed it [nRFPS §6.35.8]; the display only lights, and state reports are only
+	sent, once the bus has resumed.
+*/
+static struct BusPower {
+	bool		fSuspended,
+			fRemoteWakeup,	// host enabled DEVICE_REMOTE_WAKEUP
+			fWaking;	// remote wakeup requested, waiting for the USBD to allow it
+	uint32_t	fWakeStart;	// RTC ticks at the input that started waking
+	} gBusPower;
+
+
+/*	USBSuspend
+	Host suspended the bus
+*/
+static void USBSuspend(
+	Panel		&panel
+	)
+{
+if (gBusPower.fSuspended) return;
+gBusPower.fSuspended = true;
+
+Log::Write(Log::kLogUSBSuspend);
+
+panel.Suspend();
+nrf_usbd_lowpower_enable();
+nrf_clock_task_trigger(NRF_CLOCK_TASK_HFCLKSTOP);
+}
+
+
+/*	USBResume
+	Bus is active again, since the given time
+*/
+static void EndpointIN1Resume();
+
+static void USBResume(
+	Panel		&panel,
+	const uint32_t	time
+	)
+{
+if (!gBusPower.fSuspended) return;
+
+// a remote wakeup already has the clock running
+if (!gBusPower.fWaking) {
+	nrf_usbd_lowpower_disable();
+	StartHFCLK();
+	}
+
+panel.Resume();
+
+// time from what woke us to being ready
+Log::Write(Log::kLogUSBResume, RTC::Elapsed(gBusPower.fWaking ? gBusPower.fWakeStart : time, RTC::Now()));
+
+gBusPower.fSuspended = false;
+gBusPower.fWaking = false;
+
+// send what changed while suspended
+EndpointIN1Resume();
+}
+
+
+/*	USBWakeup
+	Panel input while suspended: ask the host to resume, if it allowed that
+	
+	Leaving low power makes the USBD post USBWUALLOWED, which then drives the resume signalling.
+*/
+void USBWakeup()
+{
+if (!gBusPower.fSuspended || gBusPower.fWaking || !gBusPower.fRemoteWakeup) return;
+
+gBusPower.fWaking = true;
+gBusPower.fWakeStart = RTC::Now();
+
+StartHFCLK();
+nrf_usbd_lowpower_disable();
+}
+
+
+/*	USBWakeupAllowed
+	USBD is out of low power: signal resume to the host
+*/
+static void USBWakeupAllowed(
+	Panel		&panel
+	)
+{
+if (!gBusPower.fWaking) return;
+
+nrf_usbd_dpdmvalue_set(NRF_USBD_DPDMVALUE_RESUME);
+nrf_usbd_task_trigger(NRF_USBD_TASK_DRIVEDPDM);
+
+// [USB §7.1.7.7] the host takes over the resume signalling, and the bus is active when it ends
+USBResume(panel, gBusPower.fWakeStart);
+}
+
+
+/*	ControlTransfer
+	Control transfer on Endpoint 0 in progress
+	
+	[USB §8.5.3] SETUP stage, optional DATA stage in packets of up to maxPacketSize0, then STATUS stage.
+	[nRFPS §6.35.9] Each DATA stage packet is acknowledged by EP0DATADONE; the hardware handles the SETUP
+	and STATUS handshakes.  Every step is driven by an event from USBD_IRQHandler, so the event loop never
+	waits on the host.
+*/
+static struct ControlTransfer {
+	enum State {
+		kIdle,
+		kDataIN,		// sending fBuffer[fOffset, fLength) to the host
+		kDataOUT		// receiving fBuffer[fOffset, fLength) from the host
+		};
+	
+	static constexpr uint16_t kMaxPacketSize = 64;	// must match gDeviceDescriptor
+	static constexpr uint16_t kTimeoutFrames = 500;	// abandon the DATA stage after this many 1 ms frames
+	
+	State		fState;
+	uint16_t	fOffset,
+			fLength,
+			fPacket;	// size of the packet in flight
+	bool		fZeroLengthPacket; // IN data is shorter than requested and ends on a packet boundary
+	uint16_t	fStartFrame;
+	bool		(*fReceived)(Panel&, const uint8_t *data, uint16_t length);
+	
+	// EasyDMA can only access RAM, so everything sent or received goes through here
+	alignas(4) uint8_t fBuffer[256];
+	} gControl;
+
+
+/*	FrameUser
+	Reasons to count frames
+	
+	The start of frame interrupt fires every millisecond, so it's only enabled while something needs it.
+*/
+enum FrameUser : uint8_t {
+	kFrameControlTransfer = 1 << 0,	// DATA stage timeout
+	kFrameIdle = 1 << 1		// Endpoint 1 IN idle rate
+	};
+
+static uint8_t gFrameUsers;
+
+
+/*	FrameInterrupt
+	Start or stop counting frames for the given user
+*/
+static void FrameInterrupt(
+	const FrameUser	user,
+	const bool	enable
+	)
+{
+const uint8_t users = enable ? gFrameUsers | user : gFrameUsers & ~user;
+
+// first user, or last?
+if (users && !gFrameUsers)
+	nrf_usbd_int_enable(NRF_USBD_INT_SOF_MASK);
+else if (!users && gFrameUsers)
+	nrf_usbd_int_disable(NRF_USBD_INT_SOF_MASK);
+
+gFrameUsers = users;
+}
+
+
+/*	ControlTransferTimer
+	Count frames while a DATA stage is in progress
+*/
+static void ControlTransferTimer(
+	const bool	enable
+	)
+{
+if (enable) gControl.fStartFrame = nrf_usbd_framecntr_get();
+
+FrameInterrupt(kFrameControlTransfer, enable);
+}
+
+
+/*	ControlTransferEnd
+	Return the control endpoint to idle
+*/
+static void ControlTransferEnd()
+{
+gControl.fState = ControlTransfer::kIdle;
+ControlTransferTimer(false);
+
+// a packet of an abandoned transfer still waiting for the DMA is dropped
+DMACancel(kDMAIN0);
+DMACancel(kDMAOUT0);
+}
+
+
+/*	SendPacket
+	Start the next IN packet of the DATA stage
+*/
+static void SendPacket()
+{
+gControl.fPacket = std::min<uint16_t>(gControl.fLength - gControl.fOffset, ControlTransfer::kMaxPacketSize);
+DMAStart(kDMAIN0, gControl.fBuffer + gControl.fOffset, gControl.fPacket);
+}
+
+
 /*	Send
-	Send USB data
+	Start the IN DATA stage of the current control transfer
+	
+	Returns immediately; the remaining packets and the STATUS stage follow from Endpoint 0 events.
 */
 static void Send(
 	const void	*const data,
 	uint16_t	length
 	)
 {
-nrf_usbd_ep_easydma_set(NRF_USBD_EPIN(0), reinterpret_cast<uintptr_t>(data), length);
-nrf_usbd_task_trigger(NRF_USBD_TASK_STARTEPIN0);
-while (!nrf_usbd_event_get_and_clear(NRF_USBD_EVENT_STARTED));
-while (!nrf_usbd_event_get_and_clear(NRF_USBD_EVENT_ENDEPIN0));
-while (!nrf_usbd_event_get_and_clear(NRF_USBD_EVENT_EP0DATADONE)); // ***** completely possible for it to get stuck here
-nrf_usbd_task_trigger(NRF_USBD_TASK_EP0STATUS);
+const uint16_t requested = nrf_usbd_setup_wlength_get();
+
+// never send more than the host asked for
+length = std::min<uint16_t>(std::min<uint16_t>(length, requested), sizeof gControl.fBuffer);
+memcpy(gControl.fBuffer, data, length);
+
+gControl.fState = ControlTransfer::kDataIN;
+gControl.fOffset = 0;
+gControl.fLength = length;
+gControl.fZeroLengthPacket = length != 0 && length < requested && length % ControlTransfer::kMaxPacketSize == 0;
+ControlTransferTimer(true);
+
+SendPacket();
+}
+
+
+/*	Receive
+	Start the OUT DATA stage of the current control transfer
+	
+	Calls 'received' with the complete data once all packets have arrived; the transfer is acknowledged if it
+	returns true and stalled otherwise.
+*/
+static bool Receive(
+	bool		(*const received)(Panel&, const uint8_t *data, uint16_t length)
+	)
+{
+const uint16_t length = nrf_usbd_setup_wlength_get();
+
+// can't hold it?
+if (length > sizeof gControl.fBuffer) return false;
+
+gControl.fState = ControlTransfer::kDataOUT;
+gControl.fOffset = 0;
+gControl.fLength = length;
+gControl.fReceived = received;
+ControlTransferTimer(true);
+
+// allow the host to send the first packet
+nrf_usbd_task_trigger(NRF_USBD_TASK_EP0RCVOUT);
+
+return true;
+}
+
+
+/*	USBEndpoint0DataDone
+	A DATA stage packet on Endpoint 0 was acknowledged (IN) or has arrived in the USBD (OUT)
+*/
+void USBEndpoint0DataDone()
+{
+switch (gControl.fState) {
+	case ControlTransfer::kDataIN:
+		gControl.fOffset += gControl.fPacket;
+		
+		// more data, or a terminating zero-length packet?
+		if (gControl.fOffset < gControl.fLength)
+			SendPacket();
+		
+		else if (gControl.fZeroLengthPacket) {
+			gControl.fZeroLengthPacket = false;
+			SendPacket();
+			}
+		
+		else {
+			ControlTransferEnd();
+			nrf_usbd_task_trigger(NRF_USBD_TASK_EP0STATUS);
+			}
+		break;
+	
+	case ControlTransfer::kDataOUT:
+		// move the packet into RAM
+		gControl.fPacket = std::min<uint16_t>(nrf_usbd_epout_size_get(NRF_USBD_EPOUT(0)), gControl.fLength - gControl.fOffset);
+		DMAStart(kDMAOUT0, gControl.fBuffer + gControl.fOffset, gControl.fPacket);
+		break;
+	
+	default:
+		break;
+	}
+}
+
+
+/*	USBEndpoint0OUTEnd
+	An OUT DATA stage packet on Endpoint 0 has been moved into RAM
+*/
+void USBEndpoint0OUTEnd(
+	Panel		&panel
+	)
+{
+if (gControl.fState != ControlTransfer::kDataOUT) return;
+
+gControl.fOffset += gControl.fPacket;
+
+// more to come?
+/* A short packet also ends the DATA stage [USB §8.5.3.2] */
+if (gControl.fOffset < gControl.fLength && gControl.fPacket == ControlTransfer::kMaxPacketSize)
+	nrf_usbd_task_trigger(NRF_USBD_TASK_EP0RCVOUT);
+
+else {
+	ControlTransferEnd();
+	nrf_usbd_task_trigger(
+		(*gControl.fReceived)(panel, gControl.fBuffer, gControl.fOffset) ?
+			NRF_USBD_TASK_EP0STATUS :
+			NRF_USBD_TASK_EP0STALL
+		);
+	}
+}
+
+
+/*	USBFrame
+	Start of frame
+*/
+static void EndpointIN1Frame(uint16_t);
+
+void USBFrame(
+	const uint16_t	frame
+	)
+{
+// time to repeat the panel state?
+EndpointIN1Frame(frame);
+
+// DATA stage taking too long?
+/* The frame counter is 11 bits */
+if (gControl.fState != ControlTransfer::kIdle && ((frame - gControl.fStartFrame) & 0x7ff) > ControlTransfer::kTimeoutFrames) {
+	Log::Write(Log::kLogControlTimeout, gControl.fOffset, gControl.fLength);
+	ControlTransferEnd();
+	nrf_usbd_task_trigger(NRF_USBD_TASK_EP0STALL);
+	}
+}
+
+
+/*	USBReset
+	Bus reset
+*/
+static void EndpointIN1Configure(bool);
+static void EndpointIN1IdleRate(uint8_t);
+static uint8_t EndpointIN1IdleRate();
+static void EndpointIN1Polled(const Panel&, uint8_t*);
+static void DiagnosticsConfigure(bool);
+
+void USBReset(
+	Panel		&panel
+	)
+{
+Log::Write(Log::kLogUSBReset);
+
+// abandon any control transfer
+ControlTransferEnd();
+
+// interrupt and bulk endpoints are disabled until the host configures the device again
+EndpointIN1Configure(false);
+DiagnosticsConfigure(false);
+for (const DMAChannel channel : { kDMAIN1, kDMAOUT1, kDMAIN2, kDMAOUT2 })
+	DMACancel(channel);
+
+// a reset ends suspend, and the host has to enable remote wakeup again
+USBResume(panel, RTC::Now());
+gBusPower.fRemoteWakeup = false;
 }
 
 
@@ -280,10 +798,35 @@ nrf_usbd_task_trigger(NRF_USBD_TASK_EP0STATUS);
 */
 void Descriptor::Send() const
 {
-::Send(this, std::min<uint16_t>(length, nrf_usbd_setup_wlength_get()));
+::Send(this, length);
 }
 
 
+/*	ReportID
+	HID report IDs
+	
+	Once the descriptor declares any report ID every report carries one, as its first byte.
+*/
+enum ReportID : uint8_t {
+	kReportPanel = 1,	// Input and Output: displayed values
+	kReportSettings,	// Feature: panel settings
+	kReportProfile,		// Feature (read-only): cycle counts
+	kReportLog,		// Feature (read-only): log records
+	kReportState,		// Input: whole panel state, as State.h
+	kReportCapabilities	// Feature (read-only): what this firmware can do, as Capabilities.h
+	};
+
+
+/*	kLogReportRecords
+	Log records per log Feature report
+	
+	The report is the ID, the 16-bit count of dropped records, the number of records that follow, and
+	the records; unused record space is zero.
+*/
+static constexpr size_t kLogReportRecords = 3;
+static constexpr size_t kLogReportLength = 1 + 2 + 1 + kLogReportRecords * Log::kEncodedRecord;
+
+
 /*	gReportDescriptor
 	HID report descriptor for the panel
 */
@@ -299,6 +842,7 @@ static constexpr struct __attribute__((packed)) {
 	HIDReportDescriptorItem<TagMain, uint8_t> beginCollectionApplication { HIDReportDescriptorItemPrefix::kCollection, 0x01 /* application */ };
 	HIDReportDescriptorItem<TagLocal, uint8_t> usageCollection { HIDReportDescriptorItemPrefix::kUsageLocal, 0x20 };
 	HIDReportDescriptorItem<TagMain, uint8_t> beginCollectionPhysical { HIDReportDescriptorItemPrefix::kCollection, 0x00 /* physical */ };
+	HIDReportDescriptorItem<TagGlobal, uint8_t> reportIDPanel { HIDReportDescriptorItemPrefix::kReportID, kReportPanel };
 	HIDReportDescriptorItem<TagLocal, uint8_t> usageInput { HIDReportDescriptorItemPrefix::kUsageLocal, 0x21 };
 	HIDReportDescriptorItem<TagGlobal, uint8_t> logicalMinimumInput { HIDReportDescriptorItemPrefix::kLogicalMinimum, 0 };
 	HIDReportDescriptorItem<TagGlobal, uint32_t> logicalMaximumInput { HIDReportDescriptorItemPrefix::kLogicalMaximum, 999999 };
@@ -311,6 +855,44 @@ static constexpr struct __attribute__((packed)) {
 	HIDReportDescriptorItem<TagGlobal, uint8_t> reportCountOutput { HIDReportDescriptorItemPrefix::kReportCount, 2 /* displays */ };
 	HIDReportDescriptorItem<TagGlobal, uint8_t> reportSizeOutput { HIDReportDescriptorItemPrefix::kReportSize, 20 /* bits */ };
 	HIDReportDescriptorItem<TagMain, uint8_t> output { HIDReportDescriptorItemPrefix::kOutput, 0b10100010 };
+	HIDReportDescriptorItem<TagGlobal, uint8_t> reportIDSettings { HIDReportDescriptorItemPrefix::kReportID, kReportSettings };
+	HIDReportDescriptorItem<TagLocal, uint8_t> usageFeature { HIDReportDescriptorItemPrefix::kUsageLocal, 0x23 };
+	HIDReportDescriptorItem<TagGlobal, uint8_t> logicalMinimumFeature { HIDReportDescriptorItemPrefix::kLogicalMinimum, 0 };
+	HIDReportDescriptorItem<TagGlobal, uint8_t> logicalMaximumFeature { HIDReportDescriptorItemPrefix::kLogicalMaximum, Acceleration::kCurves.size() - 1 };
+	HIDReportDescriptorItem<TagGlobal, uint8_t> reportCountFeature { HIDReportDescriptorItemPrefix::kReportCount, 1 /* acceleration curve */ };
+	HIDReportDescriptorItem<TagGlobal, uint8_t> reportSizeFeature { HIDReportDescriptorItemPrefix::kReportSize, 8 /* bits */ };
+	HIDReportDescriptorItem<TagMain, uint8_t> feature { HIDReportDescriptorItemPrefix::kFeature, 0b10100010 };
+	HIDReportDescriptorItem<TagLocal, uint8_t> usageFeatureSampling { HIDReportDescriptorItemPrefix::kUsageLocal, 0x24 };
+	HIDReportDescriptorItem<TagGlobal, uint8_t> logicalMaximumFeatureSampling { HIDReportDescriptorItemPrefix::kLogicalMaximum, QDEC::kLowLatency };
+	HIDReportDescriptorItem<TagMain, uint8_t> featureSampling { HIDReportDescriptorItemPrefix::kFeature, 0b10100010 };
+	HIDReportDescriptorItem<TagLocal, uint8_t> usageFeatureIdle { HIDReportDescriptorItemPrefix::kUsageLocal, 0x27 };
+	HIDReportDescriptorItem<TagGlobal, uint16_t> logicalMaximumFeatureIdle { HIDReportDescriptorItemPrefix::kLogicalMaximum, 0xff /* 4 ms units */ };
+	HIDReportDescriptorItem<TagMain, uint8_t> featureIdle { HIDReportDescriptorItemPrefix::kFeature, 0b10100010 };
+	HIDReportDescriptorItem<TagGlobal, uint8_t> reportIDProfile { HIDReportDescriptorItemPrefix::kReportID, kReportProfile };
+	HIDReportDescriptorItem<TagLocal, uint8_t> usageFeatureProfile { HIDReportDescriptorItemPrefix::kUsageLocal, 0x25 };
+	HIDReportDescriptorItem<TagGlobal, uint8_t> logicalMinimumFeatureProfile { HIDReportDescriptorItemPrefix::kLogicalMinimum, 0 };
+	HIDReportDescriptorItem<TagGlobal, uint32_t> logicalMaximumFeatureProfile { HIDReportDescriptorItemPrefix::kLogicalMaximum, 0x7fffffff };
+	HIDReportDescriptorItem<TagGlobal, uint8_t> reportCountFeatureProfile { HIDReportDescriptorItemPrefix::kReportCount, Profile::kEncoded / sizeof(uint32_t) };
+	HIDReportDescriptorItem<TagGlobal, uint8_t> reportSizeFeatureProfile { HIDReportDescriptorItemPrefix::kReportSize, 32 /* bits */ };
+	HIDReportDescriptorItem<TagMain, uint8_t> featureProfile { HIDReportDescriptorItemPrefix::kFeature, 0b10100011 /* constant */ };
+	HIDReportDescriptorItem<TagGlobal, uint8_t> reportIDLog { HIDReportDescriptorItemPrefix::kReportID, kReportLog };
+	HIDReportDescriptorItem<TagLocal, uint8_t> usageFeatureLog { HIDReportDescriptorItemPrefix::kUsageLocal, 0x26 };
+	HIDReportDescriptorItem<TagGlobal, uint8_t> logicalMinimumFeatureLog { HIDReportDescriptorItemPrefix::kLogicalMinimum, 0 };
+	HIDReportDescriptorItem<TagGlobal, uint16_t> logicalMaximumFeatureLog { HIDReportDescriptorItemPrefix::kLogicalMaximum, 0xff };
+	HIDReportDescriptorItem<TagGlobal, uint8_t> reportCountFeatureLog { HIDReportDescriptorItemPrefix::kReportCount, kLogReportLength - 1 };
+	HIDReportDescriptorItem<TagGlobal, uint8_t> reportSizeFeatureLog { HIDReportDescriptorItemPrefix::kReportSize, 8 /* bits */ };
+	HIDReportDescriptorItem<TagMain, uint8_t> featureLog { HIDReportDescriptorItemPrefix::kFeature, 0b10100011 /* constant */ };
+	HIDReportDescriptorItem<TagGlobal, uint8_t> reportIDState { HIDReportDescriptorItemPrefix::kReportID, kReportState };
+	HIDReportDescriptorItem<TagLocal, uint8_t> usageInputState { HIDReportDescriptorItemPrefix::kUsageLocal, 0x28 };
+	HIDReportDescriptorItem<TagGlobal, uint8_t> logicalMinimumInputState { HIDReportDescriptorItemPrefix::kLogicalMinimum, 0 };
+	HIDReportDescriptorItem<TagGlobal, uint16_t> logicalMaximumInputState { HIDReportDescriptorItemPrefix::kLogicalMaximum, 0xff };
+	HIDReportDescriptorItem<TagGlobal, uint8_t> reportCountInputState { HIDReportDescriptorItemPrefix::kReportCount, State::kReportLength - 1 };
+	HIDReportDescriptorItem<TagGlobal, uint8_t> reportSizeInputState { HIDReportDescriptorItemPrefix::kReportSize, 8 /* bits */ };
+	HIDReportDescriptorItem<TagMain, uint8_t> inputState { HIDReportDescriptorItemPrefix::kInput, 0b10100010 };
+	HIDReportDescriptorItem<TagGlobal, uint8_t> reportIDCapabilities { HIDReportDescriptorItemPrefix::kReportID, kReportCapabilities };
+	HIDReportDescriptorItem<TagLocal, uint8_t> usageFeatureCapabilities { HIDReportDescriptorItemPrefix::kUsageLocal, 0x29 };
+	HIDReportDescriptorItem<TagGlobal, uint8_t> reportCountFeatureCapabilities { HIDReportDescriptorItemPrefix::kReportCount, Capabilities::kReportLength - 1 };
+	HIDReportDescriptorItem<TagMain, uint8_t> featureCapabilities { HIDReportDescriptorItemPrefix::kFeature, 0b10100011 /* constant */ };
 	HIDReportDescriptorItem<TagMain, void> endCollectionPhysical { HIDReportDescriptorItemPrefix::kCollectionEnd };
 	HIDReportDescriptorItem<TagMain, void> endCollectionApplication { HIDReportDescriptorItemPrefix::kCollectionEnd };
 	} gReportDescriptor;
@@ -366,13 +948,15 @@ static constexpr struct __attribute__((packed)) {
 	USB::InterfaceDescriptor interface;
 	USB::HIDClassDescriptor<1> hid;
 	USB::EndpointDescriptor endpoints[2];
+	USB::InterfaceDescriptor diagnostics;
+	USB::EndpointDescriptor diagnosticsEndpoints[2];
 	} gConfigurationDescriptor = {
 	/* configuration */ {
 		sizeof gConfigurationDescriptor,
-		1, // number of interfaces
+		2, // number of interfaces
 		1, // configuration value
 		0, // no string descriptor
-		false, // no remote wake-up
+		true, // remote wake-up
 		false, // not self-powered
 		40 / 2 // maximum power (in 2mA units)
 		},
@@ -399,8 +983,8 @@ static constexpr struct __attribute__((packed)) {
 			USB::EndpointDescriptor::kOUT,
 			USB::EndpointDescriptor::kInterrupt,
 			USB::EndpointDescriptor::kNoSynchronization, USB::EndpointDescriptor::kData, // not an isochronous endpoint
-			2 * 4, /* maximum packet size [nRFPS §6.35.10] multiple of 4 *** */
-			10 /* polling interval *** */
+			State::kReportLength, /* maximum packet size [nRFPS §6.35.10] multiple of 4; full-speed interrupt maximum */
+			1 /* polling interval, in 1 ms frames */
 			},
 
 		/* [1] */ {
@@ -408,8 +992,38 @@ static constexpr struct __attribute__((packed)) {
 			USB::EndpointDescriptor::kIN,
 			USB::EndpointDescriptor::kInterrupt,
 			USB::EndpointDescriptor::kNoSynchronization, USB::EndpointDescriptor::kData, // not an isochronous endpoint
-			2 * 4, /* maximum packet size [nRFPS §6.35.10] multiple of 4 *** */
-			10 /* polling interval *** */
+			State::kReportLength, /* maximum packet size [nRFPS §6.35.10] multiple of 4; full-speed interrupt maximum */
+			1 /* polling interval, in 1 ms frames */
+			}
+		},
+	
+	/* diagnostics interface */ {
+		Diagnostics::kInterface, // index
+		0, // alternate setting
+		2, // number of endpoints
+		USB::InterfaceClass::kVendor,
+		0x00, // no subclass
+		0x00, // no protocol
+		0 // no string descriptor
+		},
+	
+	/* diagnostics endpoints */ {
+		/* [0] */ {
+			Diagnostics::kEndpoint,
+			USB::EndpointDescriptor::kOUT,
+			USB::EndpointDescriptor::kBulk,
+			USB::EndpointDescriptor::kNoSynchronization, USB::EndpointDescriptor::kData, // not an isochronous endpoint
+			Diagnostics::kPacketSize,
+			0 /* bulk endpoints aren't polled */
+			},
+		
+		/* [1] */ {
+			Diagnostics::kEndpoint,
+			USB::EndpointDescriptor::kIN,
+			USB::EndpointDescriptor::kBulk,
+			USB::EndpointDescriptor::kNoSynchronization, USB::EndpointDescriptor::kData, // not an isochronous endpoint
+			Diagnostics::kPacketSize,
+			0 /* bulk endpoints aren't polled */
 			}
 		}
 	};
@@ -445,8 +1059,7 @@ static bool USBGetDeviceDescriptor(
 	const uint8_t
 	)
 {
-const auto dd = gDeviceDescriptor;
-dd.Send();
+gDeviceDescriptor.Send();
 
 return true;
 }
@@ -462,8 +1075,7 @@ static bool USBGetConfigurationDescriptor(
 bool handled = false;
 
 if (index == 0) {
-	const auto cd = gConfigurationDescriptor;
-	::Send(&cd, std::min<unsigned>(sizeof cd, nrf_usbd_setup_wlength_get()));
+	::Send(&gConfigurationDescriptor, sizeof gConfigurationDescriptor);
 	
 	handled = true;
 	}
@@ -482,9 +1094,9 @@ static bool USBGetStringDescriptor(
 bool handled = false;
 
 switch (index) {
-	case 0:		{ const auto sd = gStringDescriptor0; sd.Send(); handled = true; break; }
-	case 1:		{ const auto sm = gStringManufacturer; sm.Send(); handled = true; break; }
-	case 2:		{ const auto sp = gStringProduct; sp.Send(); handled = true; break; }
+	case 0:		gStringDescriptor0.Send(); handled = true; break;
+	case 1:		gStringManufacturer.Send(); handled = true; break;
+	case 2:		gStringProduct.Send(); handled = true; break;
 	}
 
 return handled;
@@ -521,6 +1133,7 @@ switch (type) {
 		f = USBStallMe;
 		/* This seems to be sent in error by the USBTreeView utility as a _device_ instead of a _class_ request. */
 		break;
+	default: break;
 	}
 
 return f ? (*f)(index) : false;
@@ -546,12 +1159,35 @@ nrf_usbd_ep_enable(NRF_USBD_EPOUT(1));
 // prepare OUT buffer (host to device)
 nrf_usbd_epout_clear(NRF_USBD_EPOUT(1));
 
+// send whatever state changed before the host got this far
+EndpointIN1Configure(true);
+
+// enable bulk Endpoint 2 IN and OUT
+DiagnosticsConfigure(true);
+
+return true;
+}
+
+
+/*	USBDeviceFeature
+	Set or clear a device feature; only remote wakeup is one
+*/
+static bool USBDeviceFeature(
+	const uint16_t	feature,
+	const bool	set
+	)
+{
+if (feature != static_cast<uint16_t>(FeatureSelector::kDeviceRemoteWakeup)) return false;
+
+gBusPower.fRemoteWakeup = set;
+
+nrf_usbd_task_trigger(NRF_USBD_TASK_EP0STATUS);
 return true;
 }
 
 
 static void USBEndpointClearFeature(
-	const uint16_t	value
+	const uint16_t
 	)
 {
 // nothing to do
@@ -566,9 +1202,7 @@ static void USBHIDGetReportDescriptor(
 	uint8_t
 	)
 {
-const auto rd = gReportDescriptor;
-
-::Send(&rd, std::min<unsigned>(sizeof rd, nrf_usbd_setup_wlength_get()));
+::Send(&gReportDescriptor, sizeof gReportDescriptor);
 }
 
 
@@ -585,6 +1219,7 @@ void (*f)(uint8_t index) = nullptr;
 // dispatch on descriptor type
 switch (type) {
 	case DescriptorType::kHIDReport: f = USBHIDGetReportDescriptor;	break;
+	default: break;
 	}
 
 if (f) (*f)(index);
@@ -625,6 +1260,7 @@ bool (*f)(DescriptorType, uint8_t index) = nullptr;
 switch (recipient) {
 	case RequestType::kDevice: f = USBDeviceGetDescriptor; break;
 	case RequestType::kInterface: f = USBHIDGetDescriptor; break;
+	default: break;
 	}
 
 return f ? (*f)(value.type, value.index) : false;
@@ -638,12 +1274,11 @@ static bool USBSetConfiguration(
 	const RequestType::Recipient recipient
 	)
 {
-bool handled = false;
-
 bool (*f)() = nullptr;
 
 switch (recipient) {
 	case RequestType::kDevice: f = USBDeviceSetConfiguration; break;
+	default: break;
 	}
 
 return f ? (*f)() : false;
@@ -662,17 +1297,53 @@ bool handled = false;
 const uint16_t feature = nrf_usbd_setup_wvalue_get();
 
 switch (recipient) {
+	case RequestType::kDevice: handled = USBDeviceFeature(feature, false); break;
 	case RequestType::kEndpoint: USBEndpointClearFeature(feature); handled = true; break;
+	default: break;
 	}
 
 return handled;
 }
 
 
+/*	USBSetFeature
+	[USB §9.4.9]
+*/
+static bool USBSetFeature(
+	const RequestType::Recipient recipient
+	)
+{
+const uint16_t feature = nrf_usbd_setup_wvalue_get();
+
+switch (recipient) {
+	case RequestType::kDevice: return USBDeviceFeature(feature, true);
+	default: return false;
+	}
+}
+
+
+/*	USBGetStatus
+	[USB §9.4.5] only the device has any status bits: self-powered and remote wakeup
+*/
+static bool USBGetStatus(
+	const RequestType::Recipient recipient
+	)
+{
+const uint8_t status[2] = {
+	static_cast<uint8_t>(recipient == RequestType::kDevice && gBusPower.fRemoteWakeup ? 1 << 1 : 0),
+	0
+	};
+
+Send(status, sizeof status);
+return true;
+}
+
+
 /*	USBStandard
 	[USB §9.3]
 */
 static bool USBStandard(
+	Panel&,
 	const RequestType::Direction direction,
 	const RequestType::Recipient recipient
 	)
@@ -681,45 +1352,286 @@ bool (*f)(const RequestType::Recipient) = nullptr;
 
 // dispatch on request
 if (direction == RequestType::Direction::kHostToDevice)
-	switch (const SetupRequest request = static_cast<SetupRequest>(nrf_usbd_setup_brequest_get())) {
+	switch (static_cast<SetupRequest>(nrf_usbd_setup_brequest_get())) {
 		case SetupRequest::kSetAddress: f = USBSetAddress; break;
 		case SetupRequest::kSetConfiguration: f = USBSetConfiguration; break;
 		case SetupRequest::kClearFeature: f = USBClearFeature; break;
+		case SetupRequest::kSetFeature: f = USBSetFeature; break;
+		default: break;
 		}
 
 else
-	switch (const SetupRequest request = static_cast<SetupRequest>(nrf_usbd_setup_brequest_get())) {
+	switch (static_cast<SetupRequest>(nrf_usbd_setup_brequest_get())) {
 		case SetupRequest::kGetDescriptor: f = USBGetDescriptor; break;
+		case SetupRequest::kGetStatus: f = USBGetStatus; break;
+		default: break;
 		}
 
 return f ? (*f)(recipient) : false;
 }
 
 
-/*	USBHIDSetIdle
+/*	Report
+	Input and Output report
+	
+	Word-aligned for EasyDMA.
+*/
+union alignas(4) Report {
+	char		i[6];
+	struct __attribute__((packed)) {
+		uint8_t		reportID;	// kReportPanel
+		unsigned long long
+				v0 : 20,
+				v1 : 20;
+		};
+	};
 
+#if 0
+union {
+	char		i[3];
+	struct {
+		unsigned	digit0 : 4,
+				digit1 : 4,
+				digit2 : 4,
+				digit3 : 4,
+				digit4 : 4,
+				digit5 : 4;
+		};
+	} reportOut;
+#endif
+
+
+/*	USBHIDSetIdle
+	[DCDHID §7.2.4]
 */
 static bool USBHIDSetIdle(
+	Panel&,
 	const RequestType::Recipient recipient
 	)
 {
-bool handled = false;
+const union __attribute__((packed)) {
+	uint16_t	i;
+	struct {
+		uint8_t		reportID,	// low byte; 0 is all reports
+				duration;	// 4 ms units; 0 is only when the state changes
+		};
+	} value = { nrf_usbd_setup_wvalue_get() };
+
+if (recipient != RequestType::kInterface) return false;
+
+// Endpoint 1 IN only sends the state report
+if (value.reportID != 0 && value.reportID != kReportState) return false;
+
+EndpointIN1IdleRate(value.duration);
+
+nrf_usbd_task_trigger(NRF_USBD_TASK_EP0STATUS);
+return true;
+}
+
+
+/*	USBHIDGetIdle
+	[DCDHID §7.2.3]
+*/
+static bool USBHIDGetIdle(
+	Panel&,
+	const RequestType::Recipient recipient
+	)
+{
+const uint8_t reportID = nrf_usbd_setup_wvalue_get();
+
+if (recipient != RequestType::kInterface) return false;
+if (reportID != 0 && reportID != kReportState) return false;
+
+const uint8_t duration = EndpointIN1IdleRate();
+Send(&duration, sizeof duration);
+return true;
+}
+
+
+/*	FeatureReport
+	Panel settings
+*/
+struct __attribute__((packed)) FeatureReport {
+	uint8_t		reportID;		// kReportSettings
+	uint8_t		accelerationCurve;
+	uint8_t		encoderSampling;	// QDEC::Mode
+	uint8_t		idleRate;		// [DCDHID §7.2.4] 4 ms units; 0 sends only changes
+	};
+
+
+/*	USBHIDReportReceived
+	Output report arrived through the control pipe
+*/
+static bool USBHIDReportReceived(
+	Panel		&panel,
+	const uint8_t	*const data,
+	const uint16_t	length
+	)
+{
+// short of the two 20-bit values?
+if (length < 6 || data[0] != kReportPanel) return false;
+
+Report report {};
+memcpy(&report, data, std::min<size_t>(length, sizeof report));
+
+panel.SetValue(report.v0, report.v1);
+
+return true;
+}
+
 
-union __attribute__((packed)) {
+/*	USBHIDFeatureReceived
+	Feature report arrived through the control pipe
+*/
+static bool USBHIDFeatureReceived(
+	Panel		&panel,
+	const uint8_t	*const data,
+	const uint16_t	length
+	)
+{
+if (length < sizeof(FeatureReport) || data[0] != kReportSettings) return false;
+
+FeatureReport report;
+memcpy(&report, data, sizeof report);
+
+// reject settings we don't have, before applying any
+if (!panel.SetEncoder(report.accelerationCurve, report.encoderSampling)) return false;
+
+// [USBHID] hosts send SET_IDLE 0 as they start, so this is how an application sets a rate
+EndpointIN1IdleRate(report.idleRate);
+return true;
+}
+
+
+/*	USBHIDSetReport
+	[DCDHID §7.2.2]
+*/
+static bool USBHIDSetReport(
+	Panel&,
+	const RequestType::Recipient recipient
+	)
+{
+const union __attribute__((packed)) {
 	uint16_t	i;
 	struct {
-		uint8_t		duration, reportID /* ***** order? */;
+		uint8_t		reportID;
+		uint8_t		reportType;
 		};
 	} value = { nrf_usbd_setup_wvalue_get() };
 
-switch (recipient) {
-	case RequestType::kClass:
-		nrf_usbd_task_trigger(NRF_USBD_TASK_EP0STATUS);
-		handled = true;
-		break;
+if (recipient != RequestType::kInterface) return false;
+
+// [DCDHID §7.2.1] report type 2 is Output, 3 is Feature
+switch (value.reportType) {
+	case 2:		return Receive(USBHIDReportReceived);
+	case 3:		return Receive(USBHIDFeatureReceived);
+	default:	return false;
 	}
+}
 
-return handled;
+
+/*	USBHIDGetReport
+	[DCDHID §7.2.1]
+*/
+static bool USBHIDGetReport(
+	Panel		&panel,
+	const RequestType::Recipient recipient
+	)
+{
+const union __attribute__((packed)) {
+	uint16_t	i;
+	struct {
+		uint8_t		reportID;
+		uint8_t		reportType;
+		};
+	} value = { nrf_usbd_setup_wvalue_get() };
+
+if (recipient != RequestType::kInterface) return false;
+
+// [DCDHID §7.2.1] report type 1 is Input, 3 is Feature
+switch (value.reportType << 8 | value.reportID) {
+	// displayed values?
+	/* Lets the host start from the panel's state without waiting for it to change. */
+	case 1 << 8 | kReportPanel: {
+		Report report {};
+		report.reportID = kReportPanel;
+		report.v0 = panel.Value();
+		report.v1 = panel.ValueStandby();
+		
+		Send(&report, 6 /* without padding */);
+		return true;
+		}
+	
+	// whole state?
+	case 1 << 8 | kReportState: {
+		uint8_t report[State::kReportLength];
+		EndpointIN1Polled(panel, report);
+		
+		Send(report, sizeof report);
+		return true;
+		}
+	
+	// settings?
+	case 3 << 8 | kReportSettings: {
+		const FeatureReport report = { kReportSettings, panel.AccelerationCurve(), panel.EncoderSampling(), EndpointIN1IdleRate() };
+		
+		Send(&report, sizeof report);
+		return true;
+		}
+	
+	// cycle counts?
+	case 3 << 8 | kReportProfile: {
+		uint8_t report[1 + Profile::kEncoded];
+		report[0] = kReportProfile;
+		(void) Profile::Encode(report + 1);
+		
+		Send(report, sizeof report);
+		return true;
+		}
+	
+	// what we can do?
+	case 3 << 8 | kReportCapabilities: {
+		constexpr uint16_t features =
+			Capabilities::kFeatureStateReport |
+			Capabilities::kFeatureSync |
+			Capabilities::kFeatureIdleRate |
+			Capabilities::kFeatureLowLatency |
+			#ifdef INSTRUMENTATION
+			Capabilities::kFeatureProfile |
+			#endif
+			Capabilities::kFeatureLog |
+			Capabilities::kFeatureDiagnostics;
+		
+		uint8_t report[Capabilities::kReportLength] = { kReportCapabilities };
+		report[Capabilities::kOffsetProtocol] = Capabilities::kProtocol;
+		report[Capabilities::kOffsetStateLayout] = State::kLayout;
+		report[Capabilities::kOffsetPages] = Panel::kPages;
+		report[Capabilities::kOffsetInterval] = gConfigurationDescriptor.endpoints[1].interval;
+		report[Capabilities::kOffsetCurves] = Acceleration::kCurves.size();
+		report[Capabilities::kOffsetFeatures + 0] = static_cast<uint8_t>(features);
+		report[Capabilities::kOffsetFeatures + 1] = static_cast<uint8_t>(features >> 8);
+		
+		Send(report, sizeof report);
+		return true;
+		}
+	
+	// log records?
+	/* Taking records out of the log here is safe: control requests are handled in the event loop. */
+	case 3 << 8 | kReportLog: {
+		uint8_t report[kLogReportLength] = { kReportLog };
+		uint16_t dropped;
+		const size_t length = Log::Encode(report + 4, sizeof report - 4, dropped);
+		report[1] = static_cast<uint8_t>(dropped);
+		report[2] = static_cast<uint8_t>(dropped >> 8);
+		report[3] = length / Log::kEncodedRecord;
+		
+		Send(report, sizeof report);
+		return true;
+		}
+	
+	default:
+		return false;
+	}
 }
 
 
@@ -727,107 +1639,551 @@ return handled;
 
 */
 static bool USBClass(
+	Panel		&panel,
 	const RequestType::Direction direction,
 	const RequestType::Recipient recipient
 	)
 {
-bool (*f)(const RequestType::Recipient) = nullptr;
+bool (*f)(Panel&, const RequestType::Recipient) = nullptr;
+
+// class requests are all HID; not for the diagnostics interface
+if (recipient == RequestType::kInterface && nrf_usbd_setup_windex_get() != 0 /* HID interface */) return false;
 
 // dispatch on request
 if (direction == RequestType::Direction::kHostToDevice)
-	switch (const ClassSetupRequest request = static_cast<ClassSetupRequest>(nrf_usbd_setup_brequest_get())) {
+	switch (static_cast<ClassSetupRequest>(nrf_usbd_setup_brequest_get())) {
 		case ClassSetupRequest::kSetIdle:
 			f = USBHIDSetIdle;
 			break;
+		
+		case ClassSetupRequest::kSetReport:
+			f = USBHIDSetReport;
+			break;
+		
+		default:
+			break;
 		}
 
 else
-	;
+	switch (static_cast<ClassSetupRequest>(nrf_usbd_setup_brequest_get())) {
+		case ClassSetupRequest::kGetReport:
+			f = USBHIDGetReport;
+			break;
+		
+		case ClassSetupRequest::kGetIdle:
+			f = USBHIDGetIdle;
+			break;
+		
+		default:
+			break;
+		}
 
-return f ? (*f)(recipient) : false;
+return f ? (*f)(panel, recipient) : false;
 }
 
 
 /*	USBSetup0
 	Setup stage in Endpoint 0
 */
-void USBSetup0()
+void USBSetup0(
+	Panel		&panel
+	)
 {
+PROFILE(kUSBSetup0);
+
+// a new SETUP abandons whatever transfer was in progress [USB §8.5.3]
+ControlTransferEnd();
+
 const RequestType requestType { nrf_usbd_setup_bmrequesttype_get() };
 
 // dispatch on request type
-bool (*f)(RequestType::Direction, RequestType::Recipient) = nullptr;
+bool (*f)(Panel&, RequestType::Direction, RequestType::Recipient) = nullptr;
 
 switch (requestType.type) {
 	case RequestType::kStandard:	f = USBStandard; break;
 	case RequestType::kClass:	f = USBClass; break;
+	default: break;
 	}
 
-const bool handled = f ? (*f)(requestType.direction, requestType.recipient) : false;
+const bool handled = f ? (*f)(panel, requestType.direction, requestType.recipient) : false;
 
 if (!handled) {
+	Log::Write(Log::kLogSetupNotHandled, requestType.i, nrf_usbd_setup_brequest_get());
 	nrf_usbd_task_trigger(NRF_USBD_TASK_EP0STALL);
 	nrf_gpio_pin_set(PIN_LED_RED);
 	}
 }
 
 
-union Report {
-	char		i[5];
-	struct {
-		unsigned long long
-				v0 : 20,
-				v1 : 20;
-		};
-	};
-
-#if 0
-union {
-	char		i[3];
-	struct {
-		unsigned	digit0 : 4,
-				digit1 : 4,
-				digit2 : 4,
-				digit3 : 4,
-				digit4 : 4,
-				digit5 : 4;
-		};
-	} reportOut;
-#endif
+/*	gEndpointOUT1
+	Output report arriving on the interrupt OUT endpoint
+*/
+static struct EndpointOUT1 {
+	uint16_t	fLength;	// bytes being moved into fBuffer
+	
+	// static, since EasyDMA writes it after USBEndpointOUT1() returns
+	alignas(4) uint8_t fBuffer[State::kReportLength];
+	} gEndpointOUT1;
 
 
 /*	USBEndpointOUT1
+	Output report arrived in the USBD: move it into RAM
+	
+	Moving it out also lets the USBD accept the next one; an empty one has nothing to move.
+*/
+void USBEndpointOUT1()
+{
+gEndpointOUT1.fLength = std::min<uint16_t>(nrf_usbd_epout_size_get(NRF_USBD_EPOUT(1)), sizeof gEndpointOUT1.fBuffer);
+
+if (gEndpointOUT1.fLength == 0)
+	nrf_usbd_epout_clear(NRF_USBD_EPOUT(1));
+else
+	DMAStart(kDMAOUT1, gEndpointOUT1.fBuffer, gEndpointOUT1.fLength);
+}
 
+
+/*	USBEndpointOUT1End
+	Output report is in RAM: act on it as if it came through the control pipe
 */
-void USBEndpointOUT1(
+void USBEndpointOUT1End(
 	Panel		&panel
 	)
 {
-// prepare buffer to receive OUT DATA
-Report reportOut;
-nrf_usbd_ep_easydma_set(NRF_USBD_EPOUT(1), reinterpret_cast<uintptr_t>(&reportOut), sizeof reportOut);
-nrf_usbd_task_trigger(NRF_USBD_TASK_STARTEPOUT1);
-while (!nrf_usbd_event_get_and_clear(NRF_USBD_EVENT_STARTED));
-while (!nrf_usbd_event_get_and_clear(NRF_USBD_EVENT_ENDEPOUT1));
+// an interrupt OUT can't be stalled, so an unknown report is just noted
+if (!USBHIDReportReceived(panel, gEndpointOUT1.fBuffer, gEndpointOUT1.fLength))
+	Log::Write(Log::kLogOutputReportIgnored, gEndpointOUT1.fBuffer[0], gEndpointOUT1.fLength);
+}
+
+
+/*	gEndpointIN1
+	Double-buffered Endpoint 1 IN state reports
+	
+	One buffer is armed for the host to collect while the other is filled from the newest state when it's
+	armed in turn.  Since each report is the complete panel state, a newer state simply replaces an older one
+	that hasn't been armed yet; only the encoder detents add up, so none are lost, and intermediate states the
+	host would never have seen anyway are not sent.
+	
+	With a nonzero idle rate the state is also repeated once that long has gone by without a report, so the
+	host's copy is never staler than the idle rate; with zero, a state is only sent when it changes.
+*/
+static struct EndpointIN1 {
+	alignas(4) uint8_t fBuffers[2][State::kReportLength]; // static, since EasyDMA reads it after USBEndpointIN1() returns
+	State::Values	fState;		// newest state
+	int32_t		fDelta;		// detents turned since the last report was armed
+	uint16_t	fSequence;	// reports armed
+	uint8_t		fIdle,		// index of the buffer not armed
+			fIdleRate;	// [DCDHID §7.2.4] 4 ms units
+	uint16_t	fArmedFrame;	// frame in which the last report was armed
+	bool		fConfigured,	// host has enabled the endpoint
+			fArmed,		// other buffer is waiting for the host to collect it
+			fPending,	// idle buffer holds state that hasn't been armed
+			fHasState;	// fState is valid
+	} gEndpointIN1;
+
+
+/*	EndpointIN1State
+	Encode a state, with so many detents turned, as a state report
+*/
+static void EndpointIN1State(
+	uint8_t		*const report,
+	const State::Values &state,
+	const int32_t	detents
+	)
+{
+// write a little-endian value
+/* Byte by byte, so the layout doesn't depend on struct packing. */
+const auto put = [report](State::Offset offset, uint32_t value, unsigned n) {
+	for (unsigned i = 0; i < n; i++, value >>= 8)
+		report[offset + i] = static_cast<uint8_t>(value);
+	};
 
-panel.SetValue(reportOut.v0, reportOut.v1);
+// detents beyond what 16 bits hold are clamped, not wrapped
+const int32_t delta = std::clamp<int32_t>(detents, INT16_MIN, INT16_MAX);
+
+memset(report, 0, State::kReportLength);
+report[0] = kReportState;
+put(State::kOffsetLayout, State::kLayout, 1);
+put(State::kOffsetKeys, state.keys, 4);
+put(State::kOffsetPages, Panel::kPages, 1);
+put(State::kOffsetSequence, gEndpointIN1.fSequence, 2);
+put(State::kOffsetDelta, static_cast<uint16_t>(delta), 2);
+put(State::kOffsetTime, state.time, 4);
+put(State::kOffsetValues, state.value, 4);
+put(static_cast<State::Offset>(State::kOffsetValues + 4), state.valueStandby, 4);
+}
+
+
+/*	EndpointIN1Polled
+	Encode the panel as it is now as a state report, for GET_REPORT
+	
+	The panel's values and keys are read rather than the newest state, which is only there once something
+	changed, and isn't updated by values the host sets.  The report carries no detents: those turned since
+	the last report armed stay pending for the next, so the host doesn't count them twice.  The time is that
+	of the newest state, or 0 if nothing changed since power-up.
+*/
+static void EndpointIN1Polled(
+	const Panel	&panel,
+	uint8_t		*const report
+	)
+{
+const State::Values state = {
+	gEndpointIN1.fHasState ? gEndpointIN1.fState.time : 0,
+	panel.Value(),
+	panel.ValueStandby(),
+	0,
+	panel.Keys()
+	};
+
+EndpointIN1State(report, state, 0);
+}
+
+
+/*	EndpointIN1Arm
+	Fill the idle buffer from the newest state and hand it to the USBD
+*/
+static void EndpointIN1Arm()
+{
+uint8_t *const report = gEndpointIN1.fBuffers[gEndpointIN1.fIdle];
+gEndpointIN1.fSequence++;
+EndpointIN1State(report, gEndpointIN1.fState, gEndpointIN1.fDelta);
+gEndpointIN1.fDelta = 0;
+
+DMAStart(kDMAIN1, report, State::kReportLength);
+
+gEndpointIN1.fIdle ^= 1;
+gEndpointIN1.fArmed = true;
+gEndpointIN1.fPending = false;
+gEndpointIN1.fArmedFrame = nrf_usbd_framecntr_get();
+}
+
+
+/*	EndpointIN1Configure
+	Host enabled (or bus reset disabled) the interrupt endpoint
+*/
+static void EndpointIN1Configure(
+	const bool	configured
+	)
+{
+gEndpointIN1.fConfigured = configured;
+gEndpointIN1.fArmed = false;
+
+// [DCDHID §7.2.4] idle rate doesn't survive a reset
+if (!configured) EndpointIN1IdleRate(0);
+
+if (configured && gEndpointIN1.fPending) EndpointIN1Arm();
+}
+
+
+/*	EndpointIN1Resume
+	Bus resumed: arm the state that changed while it was suspended
+*/
+static void EndpointIN1Resume()
+{
+if (gEndpointIN1.fConfigured && !gEndpointIN1.fArmed && gEndpointIN1.fPending) EndpointIN1Arm();
+}
+
+
+/*	EndpointIN1IdleRate
+	Repeat the state after the given number of 4 ms periods without a report; 0 never repeats
+*/
+static void EndpointIN1IdleRate(
+	const uint8_t	duration
+	)
+{
+gEndpointIN1.fIdleRate = duration;
+gEndpointIN1.fArmedFrame = nrf_usbd_framecntr_get();
+
+FrameInterrupt(kFrameIdle, duration != 0);
+}
+
+
+/*	EndpointIN1IdleRate
+	Current idle rate
+*/
+static uint8_t EndpointIN1IdleRate()
+{
+return gEndpointIN1.fIdleRate;
+}
+
+
+/*	EndpointIN1Frame
+	Repeat the state if the idle rate has gone by without a report
+*/
+static void EndpointIN1Frame(
+	const uint16_t	frame
+	)
+{
+// nothing to repeat, or a report is already on its way?
+if (!gEndpointIN1.fIdleRate || !gEndpointIN1.fConfigured || !gEndpointIN1.fHasState || gEndpointIN1.fArmed || gEndpointIN1.fPending) return;
+
+// the frame counter is 11 bits, which is more than the longest idle rate of 1020 ms
+if (((frame - gEndpointIN1.fArmedFrame) & 0x7ff) < gEndpointIN1.fIdleRate * 4u) return;
+
+EndpointIN1Arm();
 }
 
 
 /*	USBEndpointIN1
-	Send the given values as the current state
+	Send the given state
+	
+	Doesn't wait for the host; the state is sent as soon as the endpoint is free, and the bus isn't suspended.
 */
 void USBEndpointIN1(
-	unsigned	value0,
-	unsigned	value1
+	const State::Values &values
 	)
 {
-Report report;
-report.v0 = value0;
-report.v1 = value1;
+State::Values &state = gEndpointIN1.fState;
+
+// same as what the host has or is about to get?
+if (
+	gEndpointIN1.fHasState && values.delta == 0 &&
+	values.value == state.value && values.valueStandby == state.valueStandby && values.keys == state.keys
+	) return;
+
+// replace the newest state; the next report armed carries it
+state = values;
+gEndpointIN1.fDelta += values.delta;
+gEndpointIN1.fHasState = true;
+gEndpointIN1.fPending = true;
+
+// EasyDMA doesn't run with the USBD in low power
+if (gEndpointIN1.fConfigured && !gEndpointIN1.fArmed && !gBusPower.fSuspended) EndpointIN1Arm();
+}
+
+
+/*	USBEndpointIN1Done
+	Host collected the armed report
+*/
+void USBEndpointIN1Done()
+{
+gEndpointIN1.fArmed = false;
+
+// newer state waiting?
+if (gEndpointIN1.fPending) EndpointIN1Arm();
+}
+
+
+/*	gDiagnostics
+	Vendor bulk interface state
+	
+	A response goes out one packet at a time; each acknowledged packet (EPIN2 in EPDATASTATUS) starts the next.
+*/
+static struct DiagnosticsTransfer {
+	bool		fSending,	// response in progress
+			fZeroLengthPacket; // response ends on a packet boundary, so must be ended by an empty packet
+	uint16_t	fOffset,
+			fLength,
+			fReceived;	// bytes of command being moved into fCommand
+	
+	// EasyDMA can only access RAM
+	alignas(4) uint8_t fCommand[Diagnostics::kPacketSize];
+	alignas(4) uint8_t fResponse[Diagnostics::kResponseLength];
+	} gDiagnostics;
+
 
-nrf_usbd_ep_easydma_set(NRF_USBD_EPIN(1), reinterpret_cast<uintptr_t>(&report), sizeof report);
-nrf_usbd_task_trigger(NRF_USBD_TASK_STARTEPIN1);
-while (!nrf_usbd_event_get_and_clear(NRF_USBD_EVENT_STARTED));
-while (!nrf_usbd_event_get_and_clear(NRF_USBD_EVENT_ENDEPIN1));
+/*	DiagnosticsConfigure
+	Host enabled (or bus reset disabled) the bulk endpoints
+*/
+static void DiagnosticsConfigure(
+	const bool	configured
+	)
+{
+gDiagnostics.fSending = false;
+
+if (configured) {
+	nrf_usbd_ep_enable(NRF_USBD_EPIN(Diagnostics::kEndpoint));
+	nrf_usbd_ep_enable(NRF_USBD_EPOUT(Diagnostics::kEndpoint));
+	
+	// accept the first command
+	nrf_usbd_epout_clear(NRF_USBD_EPOUT(Diagnostics::kEndpoint));
+	}
+}
+
+
+/*	DiagnosticsSendPacket
+	Start the next packet of the response
+*/
+static void DiagnosticsSendPacket()
+{
+const uint16_t packet = std::min<uint16_t>(gDiagnostics.fLength - gDiagnostics.fOffset, Diagnostics::kPacketSize);
+
+// a short (or empty) packet ends the response
+if (packet < Diagnostics::kPacketSize) gDiagnostics.fZeroLengthPacket = false;
+
+DMAStart(kDMAIN2, gDiagnostics.fResponse + gDiagnostics.fOffset, packet);
+
+gDiagnostics.fOffset += packet;
+}
+
+
+/*	DiagnosticsRespond
+	Put together the response to a command; return its length, or 0 if the command isn't known
+*/
+static uint16_t DiagnosticsRespond(
+	const Diagnostics::Command command
+	)
+{
+uint8_t *const response = gDiagnostics.fResponse;
+uint8_t *const items = response + Diagnostics::kHeaderLength;
+const size_t space = sizeof gDiagnostics.fResponse - Diagnostics::kHeaderLength;
+
+uint8_t count;
+uint16_t value;
+size_t length;
+
+switch (command) {
+	case Diagnostics::kLog:
+		length = Log::Encode(items, space, value);
+		count = length / Log::kEncodedRecord;
+		break;
+	
+	case Diagnostics::kProfile:
+		length = Profile::Encode(items);
+		count = Profile::kProbes;
+		value = 0;
+		break;
+	
+	default:
+		return 0;
+	}
+
+response[0] = command;
+response[1] = static_cast<uint8_t>(value);
+response[2] = static_cast<uint8_t>(value >> 8);
+response[3] = count;
+
+return Diagnostics::kHeaderLength + length;
+}
+
+
+/*	DiagnosticsReceived
+	Command arrived in the USBD on the bulk OUT endpoint: move it into RAM
+	
+	Moving it out also lets the USBD accept the next OUT packet; an empty one has nothing to move.
+*/
+static void DiagnosticsReceived()
+{
+gDiagnostics.fReceived = std::min<uint16_t>(nrf_usbd_epout_size_get(NRF_USBD_EPOUT(Diagnostics::kEndpoint)), sizeof gDiagnostics.fCommand);
+
+if (gDiagnostics.fReceived == 0)
+	nrf_usbd_epout_clear(NRF_USBD_EPOUT(Diagnostics::kEndpoint));
+else
+	DMAStart(kDMAOUT2, gDiagnostics.fCommand, gDiagnostics.fReceived);
+}
+
+
+/*	DiagnosticsCommand
+	Command is in RAM: start the response
+*/
+static void DiagnosticsCommand()
+{
+// still sending the previous response?
+if (gDiagnostics.fSending) return;
+
+gDiagnostics.fLength = DiagnosticsRespond(static_cast<Diagnostics::Command>(gDiagnostics.fCommand[0]));
+if (gDiagnostics.fLength == 0) {
+	Log::Write(Log::kLogDiagnosticsCommand, gDiagnostics.fCommand[0]);
+	return;
+	}
+
+gDiagnostics.fOffset = 0;
+gDiagnostics.fZeroLengthPacket = gDiagnostics.fLength % Diagnostics::kPacketSize == 0;
+gDiagnostics.fSending = true;
+DiagnosticsSendPacket();
+}
+
+
+/*	DiagnosticsSent
+	Host collected a packet of the response
+*/
+static void DiagnosticsSent()
+{
+if (!gDiagnostics.fSending) return;
+
+// more to send, or the empty packet that ends the response?
+if (gDiagnostics.fOffset < gDiagnostics.fLength || gDiagnostics.fZeroLengthPacket)
+	DiagnosticsSendPacket();
+
+else
+	gDiagnostics.fSending = false;
+}
+
+
+/*	USBEvent
+	Handle a USB event in the event loop
+*/
+void USBEvent(
+	Panel		&panel,
+	const Event	&event
+	)
+{
+switch (event.type) {
+	// USB power detected?
+	case Event::kUSBDetected:
+		// enable USB on the device
+		StartUSB();
+		break;
+	
+	// USB bus reset?
+	case Event::kUSBReset:
+		USBReset(panel);
+		break;
+	
+	// USB bus suspended or resumed?
+	case Event::kUSBSuspend:
+		USBSuspend(panel);
+		break;
+	
+	case Event::kUSBResume:
+		USBResume(panel, event.time);
+		break;
+	
+	case Event::kUSBWakeupAllowed:
+		USBWakeupAllowed(panel);
+		break;
+	
+	// USB start of frame?
+	case Event::kUSBFrame:
+		USBFrame(event.frame);
+		break;
+	
+	// Endpoint 0 OUT SETUP?
+	/* read or write transfer on USB Control Endpoint 0 */
+	case Event::kUSBSetup:
+		USBSetup0(panel);
+		break;
+	
+	// Endpoint 0 DATA stage progress?
+	case Event::kUSBEndpoint0DataDone:
+		USBEndpoint0DataDone();
+		break;
+	
+	case Event::kUSBEndpoint0OUTEnd:
+		USBEndpoint0OUTEnd(panel);
+		break;
+	
+	// data transfer on another endpoint?
+	case Event::kUSBData:
+		if (event.datastatus & NRF_USBD_EPDATASTATUS_EPOUT1_MASK)
+			USBEndpointOUT1();
+		
+		if (event.datastatus & NRF_USBD_EPDATASTATUS_EPIN1_MASK)
+			USBEndpointIN1Done();
+		
+		if (event.datastatus & NRF_USBD_EPDATASTATUS_EPOUT2_MASK)
+			DiagnosticsReceived();
+		
+		if (event.datastatus & NRF_USBD_EPDATASTATUS_EPIN2_MASK)
+			DiagnosticsSent();
+		break;
+	
+	// OUT data on another endpoint in RAM?
+	case Event::kUSBDataOUTEnd:
+		if (event.endpoint == 1) USBEndpointOUT1End(panel);
+		if (event.endpoint == Diagnostics::kEndpoint) DiagnosticsCommand();
+		break;
+	
+	default:
+		break;
+	}
 }
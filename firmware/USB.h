@@ -11,15 +11,18 @@
 #include <array>
 
 
-extern volatile bool gUSBDDetected;
-extern volatile bool gUSBDEndpointOUT0SETUP;
-extern volatile bool gUSBDEndpointOUT1;
-
-
-extern void USBEndpointOUT1(Panel&);
-extern void USBEndpointIN1(unsigned value0, unsigned value1);
+extern void USBEndpointOUT1();
+extern void USBEndpointOUT1End(Panel&);
+extern void USBEndpointIN1(const State::Values&);
+extern void USBEndpointIN1Done();
 extern void StartUSB();
-extern void USBSetup0();
+extern void USBReset(Panel&);
+extern void USBFrame(uint16_t frame);
+extern void USBSetup0(Panel&);
+extern void USBEndpoint0DataDone();
+extern void USBEndpoint0OUTEnd(Panel&);
+extern void USBWakeup();
+extern void USBEvent(Panel&, const Event&);
 
 
 
@@ -62,6 +65,17 @@ namespace USB {
 		kSyncFrame
 		};
 	
+	
+	/*	FeatureSelector
+		Standard features
+		[USB Table 9-6]
+	*/
+	enum class FeatureSelector : uint16_t {
+		kEndpointHalt,
+		kDeviceRemoteWakeup,
+		kTestMode
+		};
+	
 
 	/*	ClassSetupRequest
 	
@@ -438,27 +452,27 @@ namespace USB {
 					TagMain		tag,
 					unsigned	size2
 					) :
-					tag(tag),
+					size2(logb(size2)),
 					type(kMain),
-					size2(logb(size2))
+					tag(tag)
 					{}
 	
 		constexpr	HIDReportDescriptorItemPrefix(
 					TagGlobal	tag,
 					unsigned	size2
 					) :
-					tag(tag),
+					size2(logb(size2)),
 					type(kGlobal),
-					size2(logb(size2))
+					tag(tag)
 					{}
 	
 		constexpr	HIDReportDescriptorItemPrefix(
 					TagLocal	tag,
 					unsigned	size2
 					) :
-					tag(tag),
+					size2(logb(size2)),
 					type(kLocal),
-					size2(logb(size2))
+					tag(tag)
 					{}
 		};
 	static_assert(sizeof(HIDReportDescriptorItemPrefix) == 1, "unexpected size of USB HID report descriptor item prefix");
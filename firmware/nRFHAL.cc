@@ -0,0 +1,401 @@
+/*
+
+	nRFHAL
+	
+	Hardware abstraction for the nRF52840
+	
+*/
+
+#include "nRFHAL.h"
+
+
+/*	SPI::Configure
+	SPI Master configuration
+*/
+void nRFHAL::SPI::Configure(
+	uint32_t	pinCS,
+	uint32_t	pinClock,
+	uint32_t	pinMOSI,
+	uint32_t	pinMISO
+	)
+{
+// disable CPU interrupt and task interrupts
+NVIC_DisableIRQ(SPIM3_IRQn);
+nrf_spim_int_disable(NRF_SPIM3, ~0);
+
+// configure GPIO pin for SPI clock
+nrf_gpio_pin_clear(pinClock); // clock is active high, so drive low
+nrf_gpio_cfg_output(pinClock);
+
+// configure GPIO pin for SPI data out
+nrf_gpio_cfg_output(pinMOSI);
+
+// configure GPIO pin for SPI data in
+// "DOUT on the MAX6954 is never high impedance"
+nrf_gpio_cfg_input(pinMISO, NRF_GPIO_PIN_NOPULL);
+
+// configure GPIO pin for CS (chip select)
+nrf_gpio_pin_set(pinCS); // set high 
+nrf_gpio_cfg_output(pinCS);
+
+// configure SPI
+nrf_spim_pins_set(NRF_SPIM3, pinClock, pinMOSI, pinMISO);
+nrf_spim_frequency_set(NRF_SPIM3, NRF_SPIM_FREQ_1M);
+
+/* SPI mode 0 (clock active low, sample on rising edge); data MSB first */
+nrf_spim_configure(NRF_SPIM3, NRF_SPIM_MODE_0, NRF_SPIM_BIT_ORDER_MSB_FIRST);
+
+// configure hardware CS (only in SPIM instance 3)
+/* Nordic: The value is specified in number of 64 MHz clock cycles (15.625 ns).
+   Maxim: tCSW = 19.5 ns*/
+nrf_spim_csn_configure(NRF_SPIM3, pinCS, NRF_SPIM_CSN_POL_LOW, 2 /* duration */);
+
+nrf_spim_tx_list_disable(NRF_SPIM3);
+nrf_spim_rx_list_disable(NRF_SPIM3);
+
+/* "PSEL can only be configured while SPIM is disabled" */
+/* "Pins used by SPIM must be configured in GPIO before SPIM is enabled" */
+nrf_spim_enable(NRF_SPIM3);
+
+// sequences: END starts the next transaction while the group is enabled, and counts in TIMER0; one before
+// the last, TIMER0 disables the group
+NVIC_DisableIRQ(TIMER0_IRQn);
+nrf_timer_task_trigger(NRF_TIMER0, NRF_TIMER_TASK_STOP);
+nrf_timer_mode_set(NRF_TIMER0, NRF_TIMER_MODE_COUNTER);
+nrf_timer_bit_width_set(NRF_TIMER0, NRF_TIMER_BIT_WIDTH_32);
+nrf_timer_task_trigger(NRF_TIMER0, NRF_TIMER_TASK_START);
+
+const uint32_t end = nrf_spim_event_address_get(NRF_SPIM3, NRF_SPIM_EVENT_END);
+const nrf_ppi_channel_t count = static_cast<nrf_ppi_channel_t>(kSequenceChannel + 1), stop = static_cast<nrf_ppi_channel_t>(kSequenceChannel + 2);
+nrf_ppi_channel_endpoint_setup(NRF_PPI, kSequenceChannel, end, nrf_spim_task_address_get(NRF_SPIM3, NRF_SPIM_TASK_START));
+nrf_ppi_channel_endpoint_setup(NRF_PPI, count, end, nrf_timer_task_address_get(NRF_TIMER0, NRF_TIMER_TASK_COUNT));
+nrf_ppi_channel_endpoint_setup(NRF_PPI, stop, nrf_timer_event_address_get(NRF_TIMER0, NRF_TIMER_EVENT_COMPARE0), nrf_ppi_task_group_disable_address_get(NRF_PPI, kSequenceGroup));
+nrf_ppi_group_disable(NRF_PPI, kSequenceGroup);
+nrf_ppi_channels_include_in_group(NRF_PPI, 1u << kSequenceChannel, kSequenceGroup);
+nrf_ppi_channels_enable(NRF_PPI, 1u << count | 1u << stop);
+
+// enable CPU interrupts and task interrupts; a sequence interrupts only when its last transaction ends
+NVIC_SetPriority(SPIM3_IRQn, 7 /* priority */);
+NVIC_ClearPendingIRQ(SPIM3_IRQn);
+NVIC_EnableIRQ(SPIM3_IRQn);
+nrf_spim_int_enable(NRF_SPIM3, NRF_SPIM_INT_END_MASK);
+
+NVIC_SetPriority(TIMER0_IRQn, 7 /* priority */);
+NVIC_ClearPendingIRQ(TIMER0_IRQn);
+NVIC_EnableIRQ(TIMER0_IRQn);
+nrf_timer_int_enable(NRF_TIMER0, NRF_TIMER_INT_COMPARE1_MASK);
+}
+
+
+/*	SPI::Sequence
+	Start a sequence of transactions, each 'length' bytes out and in, from consecutive buffers
+*/
+void nRFHAL::SPI::Sequence(
+	const void	*out,
+	void		*in,
+	size_t		length,
+	size_t		count
+	)
+{
+// interrupt only at the end of the last
+nrf_spim_int_disable(NRF_SPIM3, NRF_SPIM_INT_END_MASK);
+nrf_timer_task_trigger(NRF_TIMER0, NRF_TIMER_TASK_CLEAR);
+nrf_timer_cc_set(NRF_TIMER0, NRF_TIMER_CC_CHANNEL0, count - 1);
+nrf_timer_cc_set(NRF_TIMER0, NRF_TIMER_CC_CHANNEL1, count);
+nrf_timer_event_clear(NRF_TIMER0, NRF_TIMER_EVENT_COMPARE0);
+nrf_timer_event_clear(NRF_TIMER0, NRF_TIMER_EVENT_COMPARE1);
+
+// each transaction's buffers follow the last's
+nrf_spim_tx_list_enable(NRF_SPIM3);
+nrf_spim_rx_list_enable(NRF_SPIM3);
+nrf_spim_tx_buffer_set(NRF_SPIM3, static_cast<const uint8_t*>(out), length);
+nrf_spim_rx_buffer_set(NRF_SPIM3, static_cast<uint8_t*>(in), length);
+
+if (count > 1) nrf_ppi_group_enable(NRF_PPI, kSequenceGroup);
+nrf_spim_event_clear(NRF_SPIM3, NRF_SPIM_EVENT_END);
+nrf_spim_task_trigger(NRF_SPIM3, NRF_SPIM_TASK_START);
+}
+
+
+/*	SPI::SequenceEnd
+	Interrupt handler: sequence ended?  If so, back to single transactions
+*/
+bool nRFHAL::SPI::SequenceEnd()
+{
+if (!nrf_timer_event_check(NRF_TIMER0, NRF_TIMER_EVENT_COMPARE1)) return false;
+nrf_timer_event_clear(NRF_TIMER0, NRF_TIMER_EVENT_COMPARE1);
+
+nrf_spim_tx_list_disable(NRF_SPIM3);
+nrf_spim_rx_list_disable(NRF_SPIM3);
+nrf_spim_event_clear(NRF_SPIM3, NRF_SPIM_EVENT_END);
+nrf_spim_int_enable(NRF_SPIM3, NRF_SPIM_INT_END_MASK);
+return true;
+}
+
+
+/*	SamplePeriod
+	QDEC sampling period for the given mode
+*/
+static nrf_qdec_sampleper_t SamplePeriod(
+	const bool	lowLatency
+	)
+{
+/* Say maximum detectable rotation speed is 1 full circle rotation per second.
+   We have 24 detents per full circle; need to be able to sample the 90 degree phase changes,
+   so 96 (say 100) samples per second, i.e. 10000 us period.  Realistically we rotate the knob
+   much faster than that; also I'm not sure whether the debouncer requires a faster rate.
+   Empirically determined 2048us to be adequate. */
+/* Low-latency mode samples four times as often, at the cost of four times the sampling current. */
+return lowLatency ? NRF_QDEC_SAMPLEPER_512us : NRF_QDEC_SAMPLEPER_2048us;
+}
+
+
+/*	ReportPeriod
+	QDEC samples per report for the given mode
+*/
+static nrf_qdec_reportper_t ReportPeriod(
+	const bool	lowLatency
+	)
+{
+/* With 10 samples per report, 2048us leaves up to ~20 ms between a detent and its report.  Low-latency
+   mode reports every sample that moved, the nRF52840's shortest period (REPORTPER 8 is 1 sample), so a
+   report follows within 512us; REPORTRDY only fires with something in ACC, so a knob at rest costs
+   nothing. */
+return lowLatency ? static_cast<nrf_qdec_reportper_t>(QDEC_REPORTPER_REPORTPER_1Smpl) : NRF_QDEC_REPORTPER_10;
+}
+
+
+/*	QDEC::Configure
+	Configure quadrature decoder
+*/
+void nRFHAL::QDEC::Configure(
+	uint32_t	pinA,
+	uint32_t	pinB,
+	bool		lowLatency,
+	bool		sampleInterrupt
+	)
+{
+// disable CPU interrupt and task interrupts
+NVIC_DisableIRQ(QDEC_IRQn);
+nrf_qdec_int_disable(~0);
+
+// configure GPIO pins
+/* "pins used by the QDEC must be configured in the GPIO before enabling the QDEC" */
+nrf_gpio_cfg(pinA, NRF_GPIO_PIN_DIR_INPUT, NRF_GPIO_PIN_INPUT_CONNECT, NRF_GPIO_PIN_PULLUP, NRF_GPIO_PIN_S0S1, NRF_GPIO_PIN_SENSE_HIGH);
+nrf_gpio_cfg(pinB, NRF_GPIO_PIN_DIR_INPUT, NRF_GPIO_PIN_INPUT_CONNECT, NRF_GPIO_PIN_PULLUP, NRF_GPIO_PIN_S0S1, NRF_GPIO_PIN_SENSE_HIGH);
+
+// assign GPIO pins to decoder
+nrf_qdec_pio_assign(pinA, pinB, NRF_QDEC_LED_NOT_CONNECTED /* LED not needed for mechanical encoder */);
+
+// set sampling period
+nrf_qdec_sampleper_set(SamplePeriod(lowLatency));
+
+// enable debouncer
+nrf_qdec_dbfen_enable();
+
+// set number of samples before a report event is considered
+nrf_qdec_reportper_set(ReportPeriod(lowLatency));
+
+// latch ACC into ACCREAD (and clear ACC) in hardware on every report
+nrf_qdec_shorts_enable(NRF_QDEC_SHORT_REPORTRDY_READCLRACC_MASK);
+
+nrf_qdec_enable();
+
+// enable CPU interrupt and task interrupt
+NVIC_SetPriority(QDEC_IRQn, 7 /* priority */);
+NVIC_ClearPendingIRQ(QDEC_IRQn);
+NVIC_EnableIRQ(QDEC_IRQn);
+nrf_qdec_int_enable(NRF_QDEC_INT_REPORTRDY_MASK | (sampleInterrupt ? NRF_QDEC_INT_SAMPLERDY_MASK : 0));
+
+// start the rotary encoder QDEC decoder
+nrf_qdec_task_trigger(NRF_QDEC_TASK_START);
+}
+
+
+/*	QDEC::Sampling
+	Change sampling and report periods
+*/
+void nRFHAL::QDEC::Sampling(
+	bool		lowLatency
+	)
+{
+// periods may only be changed while the decoder is stopped
+/* Any partial count in ACC is kept; it carries over into the first report in the new mode. */
+nrf_qdec_task_trigger(NRF_QDEC_TASK_STOP);
+nrf_qdec_sampleper_set(SamplePeriod(lowLatency));
+nrf_qdec_reportper_set(ReportPeriod(lowLatency));
+nrf_qdec_task_trigger(NRF_QDEC_TASK_START);
+}
+
+
+/*	GPIOTE::Configure
+	Interrupt on a falling edge of the given (pulled-up) input pin
+*/
+void nRFHAL::GPIOTE::Configure(
+	unsigned	channel,
+	uint32_t	pin
+	)
+{
+// disable CPU interrupt and task interrupts
+NVIC_DisableIRQ(GPIOTE_IRQn);
+nrf_gpiote_int_disable(~0 /* NRF_SPIM_ALL_INTS_MASK */);
+
+// configure GPIO pin for input
+/* Seems redundant [nRF52840 6.10.3] but needed for the pull-up */
+nrf_gpio_cfg(pin, NRF_GPIO_PIN_DIR_INPUT, NRF_GPIO_PIN_INPUT_CONNECT, NRF_GPIO_PIN_PULLUP, NRF_GPIO_PIN_S0S1 /* dummy */, NRF_GPIO_PIN_NOSENSE);
+
+// configure GPIOTE channel as an event on a transition of this pin
+nrf_gpiote_event_configure(channel, pin, NRF_GPIOTE_POLARITY_HITOLO);
+nrf_gpiote_event_enable(channel);
+
+// enable CPU interrupt and task interrupt
+NVIC_SetPriority(GPIOTE_IRQn, 7 /* priority */);
+NVIC_ClearPendingIRQ(GPIOTE_IRQn);
+NVIC_EnableIRQ(GPIOTE_IRQn);
+nrf_gpiote_int_enable(NRF_GPIOTE_INT_IN0_MASK << channel);
+}
+
+
+/*	SoftQDEC::Configure
+	Decode an encoder on two (pulled-up) input pins in PPI, counting in TIMERs
+*/
+void nRFHAL::SoftQDEC::Configure(
+	unsigned	instance,
+	uint32_t	pinA,
+	uint32_t	pinB
+	)
+{
+static constexpr IRQn_Type kIRQs[kInstances][2] = { { TIMER1_IRQn, TIMER2_IRQn }, { TIMER3_IRQn, TIMER4_IRQn } };
+
+gPins[instance][0] = pinA;
+gPins[instance][1] = pinB;
+
+// count forward and backward edges, 32 bits so they never overflow in practice
+for (unsigned direction = 0; direction < 2; direction++) {
+	NRF_TIMER_Type *const timer = kTimers[instance][direction];
+	
+	NVIC_DisableIRQ(kIRQs[instance][direction]);
+	nrf_timer_int_disable(timer, ~0);
+	nrf_timer_task_trigger(timer, NRF_TIMER_TASK_STOP);
+	nrf_timer_mode_set(timer, NRF_TIMER_MODE_COUNTER);
+	nrf_timer_bit_width_set(timer, NRF_TIMER_BIT_WIDTH_32);
+	nrf_timer_task_trigger(timer, NRF_TIMER_TASK_CLEAR);
+	nrf_timer_event_clear(timer, NRF_TIMER_EVENT_COMPARE0);
+	nrf_timer_task_trigger(timer, NRF_TIMER_TASK_START);
+	}
+
+// event on every edge of either pin
+uint32_t events[2];
+for (unsigned pin = 0; pin < 2; pin++) {
+	const unsigned channel = 1 + instance * 2 + pin;
+	
+	nrf_gpio_cfg(gPins[instance][pin], NRF_GPIO_PIN_DIR_INPUT, NRF_GPIO_PIN_INPUT_CONNECT, NRF_GPIO_PIN_PULLUP, NRF_GPIO_PIN_S0S1, NRF_GPIO_PIN_NOSENSE);
+	nrf_gpiote_event_configure(channel, gPins[instance][pin], NRF_GPIOTE_POLARITY_TOGGLE);
+	nrf_gpiote_event_enable(channel);
+	events[pin] = nrf_gpiote_event_addr_get(static_cast<nrf_gpiote_events_t>(NRF_GPIOTE_EVENTS_IN_0 + channel * sizeof(uint32_t)));
+	}
+
+// from each parity, an edge on either pin counts one way and switches to the other parity
+/* A PPI channel has only two tasks, so a second channel on the same event disables the group it's in. */
+for (unsigned odd = 0; odd < 2; odd++)
+	for (unsigned pin = 0; pin < 2; pin++) {
+		const bool forward = odd == pin;
+		const nrf_ppi_channel_t count = Channel(instance, odd * 4 + pin * 2), leave = Channel(instance, odd * 4 + pin * 2 + 1);
+		
+		nrf_ppi_channel_endpoint_setup(NRF_PPI, count, events[pin], nrf_timer_task_address_get(kTimers[instance][!forward], NRF_TIMER_TASK_COUNT));
+		nrf_ppi_fork_endpoint_setup(NRF_PPI, count, nrf_ppi_task_group_enable_address_get(NRF_PPI, Group(instance, !odd)));
+		nrf_ppi_channel_endpoint_setup(NRF_PPI, leave, events[pin], nrf_ppi_task_group_disable_address_get(NRF_PPI, Group(instance, odd)));
+		nrf_ppi_channels_include_in_group(NRF_PPI, 1u << count | 1u << leave, Group(instance, odd));
+		}
+
+// start from the parity the pins have now
+nrf_ppi_group_disable(NRF_PPI, Group(instance, false));
+nrf_ppi_group_disable(NRF_PPI, Group(instance, true));
+(void) Resync(instance);
+
+// enable CPU interrupts and task interrupts
+for (unsigned direction = 0; direction < 2; direction++) {
+	NVIC_SetPriority(kIRQs[instance][direction], 7 /* priority */);
+	NVIC_ClearPendingIRQ(kIRQs[instance][direction]);
+	NVIC_EnableIRQ(kIRQs[instance][direction]);
+	nrf_timer_int_enable(kTimers[instance][direction], NRF_TIMER_INT_COMPARE0_MASK);
+	}
+}
+
+
+/*	SoftQDEC::Resync
+	Make the parity PPI keeps match the pins; return whether it didn't
+	
+	An edge too short for GPIOTE to see leaves the parity wrong, and every edge after it counting the wrong
+	way.
+*/
+bool nRFHAL::SoftQDEC::Resync(
+	unsigned	instance
+	)
+{
+const bool odd = nrf_gpio_pin_read(gPins[instance][0]) != nrf_gpio_pin_read(gPins[instance][1]);
+
+// the first channel of each parity's group says which is enabled
+if (nrf_ppi_channel_enable_get(NRF_PPI, Channel(instance, odd * 4)) == NRF_PPI_CHANNEL_ENABLED) return false;
+
+nrf_ppi_group_disable(NRF_PPI, Group(instance, !odd));
+nrf_ppi_group_enable(NRF_PPI, Group(instance, odd));
+return true;
+}
+
+
+/*	RTC::Start
+	Start the low-frequency clock and the counter
+*/
+void nRFHAL::RTC::Start()
+{
+// start low-frequency clock
+/* The internal RC oscillator is good enough for timing knob movements. */
+nrf_clock_task_trigger(NRF_CLOCK_TASK_LFCLKSTART);
+while (!nrf_clock_event_check(NRF_CLOCK_EVENT_LFCLKSTARTED));
+nrf_clock_event_clear(NRF_CLOCK_EVENT_LFCLKSTARTED);
+
+// count every LFCLK cycle
+/* "PRESCALER can only be written when the RTC is stopped" */
+nrf_rtc_task_trigger(NRF_RTC1, NRF_RTC_TASK_STOP);
+nrf_rtc_prescaler_set(NRF_RTC1, 0);
+nrf_rtc_task_trigger(NRF_RTC1, NRF_RTC_TASK_CLEAR);
+nrf_rtc_task_trigger(NRF_RTC1, NRF_RTC_TASK_START);
+
+// enable CPU interrupt, for Alarm()
+NVIC_SetPriority(RTC1_IRQn, 7 /* priority */);
+NVIC_ClearPendingIRQ(RTC1_IRQn);
+NVIC_EnableIRQ(RTC1_IRQn);
+}
+
+
+/*	Flash::Erase
+	Erase a page to all ones
+*/
+void nRFHAL::Flash::Erase(
+	unsigned	page
+	)
+{
+nrf_nvmc_mode_set(NRF_NVMC, NRF_NVMC_MODE_ERASE);
+nrf_nvmc_page_erase_start(NRF_NVMC, kBase + page * kPageSize);
+while (!nrf_nvmc_ready_check(NRF_NVMC));
+nrf_nvmc_mode_set(NRF_NVMC, NRF_NVMC_MODE_READONLY);
+}
+
+
+/*	Flash::Write
+	Write one word of a page
+	
+	Writing can only clear bits; the word must have been erased since it was last written.
+*/
+void nRFHAL::Flash::Write(
+	unsigned	page,
+	size_t		word,
+	uint32_t	value
+	)
+{
+nrf_nvmc_mode_set(NRF_NVMC, NRF_NVMC_MODE_WRITE);
+nrf_nvmc_word_write(kBase + page * kPageSize + word * sizeof(uint32_t), value);
+while (!nrf_nvmc_ready_check(NRF_NVMC));
+nrf_nvmc_mode_set(NRF_NVMC, NRF_NVMC_MODE_READONLY);
+}
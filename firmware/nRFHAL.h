@@ -0,0 +1,254 @@
+/*
+
+	nRFHAL
+	
+	Hardware abstraction for the nRF52840
+	
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <nrf_clock.h>
+#include <nrf_gpio.h>
+#include <nrf_gpiote.h>
+#include <nrf_nvmc.h>
+#include <nrf_ppi.h>
+#include <nrf_qdec.h>
+#include <nrf_rtc.h>
+#include <nrf_spim.h>
+#include <nrf_timer.h>
+
+#include "Event.h"
+#include "State.h"
+
+
+struct Panel;
+
+extern void USBEvent(Panel&, const Event&);
+extern void USBEndpointIN1(const State::Values&);
+extern void USBWakeup();
+
+
+/*	nRFHAL
+	Policies for the nRF52840 peripherals
+*/
+struct nRFHAL {
+	static constexpr uint32_t Pin(unsigned port, unsigned pin) { return NRF_GPIO_PIN_MAP(port, pin); }
+	
+	// sleep until an interrupt or event
+	static void	Wait() { __WFE(); }
+	
+	
+	/*	SPI
+		SPI master (SPIM3, the only instance with hardware chip select)
+		
+		A sequence is several transactions of the same length, each with chip select raised after it, from
+		consecutive buffers (EasyDMA array lists).  PPI starts each on the END of the one before, and TIMER0
+		counts them: it takes PPI channels 16 to 18 and channel group 4, after SoftQDEC's.
+	*/
+	struct SPI {
+		static constexpr nrf_ppi_channel_t kSequenceChannel = static_cast<nrf_ppi_channel_t>(16);
+		static constexpr nrf_ppi_channel_group_t kSequenceGroup = static_cast<nrf_ppi_channel_group_t>(4);
+		
+		static void	Configure(uint32_t pinCS, uint32_t pinClock, uint32_t pinMOSI, uint32_t pinMISO);
+		static void	Sequence(const void *out, void *in, size_t length, size_t count);
+		static bool	SequenceEnd();
+		
+		static void	Start(const void *out, size_t outLength, void *in, size_t inLength) {
+					nrf_spim_tx_buffer_set(NRF_SPIM3, static_cast<const uint8_t*>(out), outLength);
+					nrf_spim_rx_buffer_set(NRF_SPIM3, static_cast<uint8_t*>(in), inLength);
+					nrf_spim_event_clear(NRF_SPIM3, NRF_SPIM_EVENT_END);
+					nrf_spim_task_trigger(NRF_SPIM3, NRF_SPIM_TASK_START);
+					}
+		
+		// interrupt handler: transaction ended?
+		static bool	End() {
+					if (!nrf_spim_event_check(NRF_SPIM3, NRF_SPIM_EVENT_END)) return false;
+					
+					// must clear the event, or the interrupt keeps recurring
+					nrf_spim_event_clear(NRF_SPIM3, NRF_SPIM_EVENT_END);
+					return true;
+					}
+		};
+	
+	
+	/*	QDEC
+		Quadrature decoder
+	*/
+	struct QDEC {
+		static void	Configure(uint32_t pinA, uint32_t pinB, bool lowLatency, bool sampleInterrupt);
+		static void	Sampling(bool lowLatency);
+		
+		// interrupt handler: report ready?
+		static bool	Report() {
+					if (!nrf_qdec_event_check(NRF_QDEC_EVENT_REPORTRDY)) return false;
+					nrf_qdec_event_clear(NRF_QDEC_EVENT_REPORTRDY);
+					return true;
+					}
+		
+		// value latched into ACCREAD at the last report
+		static int32_t	Accumulated() { return nrf_qdec_accread_get(); }
+		
+		// interrupt handler: sample ready?
+		static bool	Sample() {
+					if (!nrf_qdec_event_check(NRF_QDEC_EVENT_SAMPLERDY)) return false;
+					nrf_qdec_event_clear(NRF_QDEC_EVENT_SAMPLERDY);
+					return true;
+					}
+		
+		static int32_t	Sampled() { return nrf_qdec_sample_get(); }
+		};
+	
+	
+	/*	GPIOTE
+		Pin change events
+	*/
+	struct GPIOTE {
+		static void	Configure(unsigned channel, uint32_t pin);
+		
+		// interrupt handler: event on the channel?
+		static bool	Triggered(unsigned channel) {
+					if (!nrf_gpiote_in_event_get(channel)) return false;
+					
+					// must clear the event, or the interrupt keeps recurring
+					nrf_gpiote_event_clear(static_cast<nrf_gpiote_events_t>(NRF_GPIOTE_EVENTS_IN_0 + channel * sizeof(uint32_t)));
+					return true;
+					}
+		};
+	
+	
+	/*	SoftQDEC
+		Quadrature decoders made of GPIOTE, PPI and TIMERs, for encoders beyond the one QDEC
+		
+		Whether an edge turns forwards depends only on which pin it is on, and on whether the pins differed
+		before it (A xor B, the parity): an edge on A is forwards from even parity, one on B from odd.  So PPI
+		keeps the parity as which of two channel groups is enabled, and each GPIOTE event (on every edge)
+		counts in the forward or backward TIMER and switches groups.  The CPU only hears of it when a count
+		reaches its compare value.
+		
+		Each instance takes two GPIOTE channels (from 1), eight PPI channels and two channel groups (from 0),
+		and two TIMERs (from TIMER1).
+	*/
+	struct SoftQDEC {
+		static constexpr unsigned kInstances = 2;
+		
+		struct Counts {
+			uint32_t	forward,
+					backward;
+			};
+		
+		static inline NRF_TIMER_Type *const kTimers[kInstances][2] = { { NRF_TIMER1, NRF_TIMER2 }, { NRF_TIMER3, NRF_TIMER4 } };
+		static inline uint32_t gPins[kInstances][2];
+		
+		static nrf_ppi_channel_group_t Group(unsigned instance, bool odd) { return static_cast<nrf_ppi_channel_group_t>(instance * 2 + odd); }
+		static nrf_ppi_channel_t Channel(unsigned instance, unsigned channel) { return static_cast<nrf_ppi_channel_t>(instance * 8 + channel); }
+		
+		static void	Configure(unsigned instance, uint32_t pinA, uint32_t pinB);
+		static bool	Resync(unsigned instance);
+		
+		// edges forward of the detent the pins say the knob is at or past (pins high at the detent)
+		static unsigned	Phase(unsigned instance) {
+					static constexpr uint8_t kPhases[2][2] = { { 2, 1 }, { 3, 0 } }; // by A, B
+					return kPhases[nrf_gpio_pin_read(gPins[instance][0])][nrf_gpio_pin_read(gPins[instance][1])];
+					}
+		
+		// interrupt handler: either count reached its compare value?
+		static bool	Compared(unsigned instance) {
+					bool compared = false;
+					for (NRF_TIMER_Type *timer : kTimers[instance])
+						if (nrf_timer_event_check(timer, NRF_TIMER_EVENT_COMPARE0)) {
+							nrf_timer_event_clear(timer, NRF_TIMER_EVENT_COMPARE0);
+							compared = true;
+							}
+					return compared;
+					}
+		
+		static Counts	Counted(unsigned instance) {
+					for (NRF_TIMER_Type *timer : kTimers[instance])
+						nrf_timer_task_trigger(timer, NRF_TIMER_TASK_CAPTURE1);
+					return {
+						nrf_timer_cc_get(kTimers[instance][0], NRF_TIMER_CC_CHANNEL1),
+						nrf_timer_cc_get(kTimers[instance][1], NRF_TIMER_CC_CHANNEL1)
+						};
+					}
+		
+		// interrupt when either count reaches the given value
+		static void	Compare(unsigned instance, const Counts &at) {
+					nrf_timer_cc_set(kTimers[instance][0], NRF_TIMER_CC_CHANNEL0, at.forward);
+					nrf_timer_cc_set(kTimers[instance][1], NRF_TIMER_CC_CHANNEL0, at.backward);
+					}
+		};
+	
+	
+	/*	Cycles
+		Processor cycle counter
+	*/
+	struct Cycles {
+		static void	Start() {
+					// DWT only counts with trace enabled
+					CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+					DWT->CYCCNT = 0;
+					DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+					}
+		
+		static uint32_t	Now() { return DWT->CYCCNT; }
+		};
+	
+	
+	/*	RTC
+		Real-time counter
+	*/
+	struct RTC {
+		static void	Start();
+		static uint32_t	Now() { return nrf_rtc_counter_get(NRF_RTC1); }
+		
+		// interrupt once when the counter reaches the given value
+		static void	Alarm(uint32_t at) {
+					nrf_rtc_event_clear(NRF_RTC1, NRF_RTC_EVENT_COMPARE_0);
+					nrf_rtc_cc_set(NRF_RTC1, 0, at & NRF_RTC_COUNTER_MAX);
+					nrf_rtc_int_enable(NRF_RTC1, NRF_RTC_INT_COMPARE0_MASK);
+					}
+		
+		// interrupt handler: alarm went off?
+		static bool	Alarmed() {
+					if (!nrf_rtc_event_check(NRF_RTC1, NRF_RTC_EVENT_COMPARE_0)) return false;
+					nrf_rtc_event_clear(NRF_RTC1, NRF_RTC_EVENT_COMPARE_0);
+					nrf_rtc_int_disable(NRF_RTC1, NRF_RTC_INT_COMPARE0_MASK);
+					return true;
+					}
+		};
+	
+	
+	/*	Flash
+		Non-volatile memory controller, for the pages set aside at the top of flash
+		
+		The CPU stalls while the NVMC writes (41 us a word) or erases (85 ms a page); interrupts wait.
+	*/
+	struct Flash {
+		static constexpr uint32_t kPageSize = 4096;	// bytes; the unit of erasing
+		static constexpr unsigned kPages = 2;
+		static constexpr uint32_t kBase = 0x100000 - kPages * kPageSize; // linker script must keep the image below
+		
+		static const uint32_t *Page(unsigned page) { return reinterpret_cast<const uint32_t*>(kBase + page * kPageSize); }
+		static void	Erase(unsigned page);
+		static void	Write(unsigned page, size_t word, uint32_t value);
+		};
+	
+	
+	/*	USBD
+		USB device stack
+	*/
+	struct USBD {
+		// handle USB events in the event loop
+		static void	Handle(Panel &panel, const Event &event) { USBEvent(panel, event); }
+		
+		// send the panel state to the host
+		static void	Report(const State::Values &values) { USBEndpointIN1(values); }
+		
+		// signal remote wakeup, if suspended and the host allows it
+		static void	Wakeup() { USBWakeup(); }
+		};
+	};
@@ -0,0 +1,169 @@
+/*
+	bridge
+
+	Datagram format for carrying panels between machines over UDP
+*/
+
+#include <chrono>
+
+#include "bridge.h"
+
+
+/*	Layout
+	Datagram: a header, then each panel
+
+	Multi-byte fields are little-endian.  Values take 3 bytes, since the panel's are 20 bits.
+*/
+namespace Layout {
+	constexpr uint16_t kMagic = 0x5850;	// 'XP'
+	constexpr uint8_t kVersion = 3;
+
+	enum Header : uint8_t {
+		kOffsetMagic = 0,	// uint16_t
+		kOffsetVersion = 2,	// uint8_t
+		kOffsetKind = 3,	// uint8_t
+		kOffsetCount = 4,	// uint8_t: panels that follow
+		kOffsetSequence = 5,	// uint32_t
+		kOffsetSent = 9,	// uint32_t
+		kOffsetEcho = 13,	// uint32_t
+		kHeaderLength = 17
+		};
+
+	enum Entry : uint8_t {
+		kOffsetIndex = 0,	// uint8_t
+		kOffsetFlags = 1,	// uint8_t: kFlagConnected
+		kOffsetChange = 2,	// uint16_t
+		kOffsetPages = 4,	// uint8_t
+		kOffsetDelta = 5,	// int16_t
+		kOffsetTime = 7,	// uint32_t
+		kOffsetKeys = 11,	// uint32_t
+		kOffsetValues = 15,	// 3-byte active and standby value, per page
+		kValueLength = 3
+		};
+
+	constexpr uint8_t kFlagConnected = 1 << 0;
+	}
+
+
+/*	BridgeClock
+	Microseconds on a monotonic clock, wrapping
+*/
+uint32_t BridgeClock()
+{
+return static_cast<uint32_t>(
+	std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count()
+	);
+}
+
+
+/*	BridgeNewer
+	Whether a sequence number comes after another, allowing for wrapping
+*/
+bool BridgeNewer(
+	const uint32_t	sequence,
+	const uint32_t	than
+	)
+{
+return static_cast<int32_t>(sequence - than) > 0;
+}
+
+
+/*	EncodeBridgeDatagram
+	Lay out a datagram in the buffer; return its length
+*/
+size_t EncodeBridgeDatagram(
+	const BridgeDatagram &datagram,
+	unsigned char	*const buffer,
+	const size_t	length
+	)
+{
+using namespace Layout;
+
+// write a little-endian value
+const auto put = [buffer](size_t offset, uint32_t v, unsigned n) {
+	for (unsigned i = 0; i < n; i++, v >>= 8)
+		buffer[offset + i] = static_cast<unsigned char>(v);
+	};
+
+size_t at = kHeaderLength;
+for (const BridgePanel &panel : datagram.panels) {
+	const unsigned pages = panel.pages < State::kPagesMaximum ? panel.pages : State::kPagesMaximum;
+	if (at + kOffsetValues + pages * 2 * kValueLength > length) throw "too many panels for one datagram";
+
+	put(at + kOffsetIndex, panel.index, 1);
+	put(at + kOffsetFlags, panel.connected ? kFlagConnected : 0, 1);
+	put(at + kOffsetChange, panel.change, 2);
+	put(at + kOffsetPages, pages, 1);
+	put(at + kOffsetDelta, static_cast<uint16_t>(panel.delta), 2);
+	put(at + kOffsetTime, panel.time, 4);
+	put(at + kOffsetKeys, panel.keys, 4);
+	at += kOffsetValues;
+
+	for (unsigned page = 0; page < pages; page++)
+		for (unsigned i = 0; i < 2; i++, at += kValueLength)
+			put(at, panel.values[page][i], kValueLength);
+	}
+
+put(kOffsetMagic, kMagic, 2);
+put(kOffsetVersion, kVersion, 1);
+put(kOffsetKind, datagram.kind, 1);
+put(kOffsetCount, static_cast<uint8_t>(datagram.panels.size()), 1);
+put(kOffsetSequence, datagram.sequence, 4);
+put(kOffsetSent, datagram.sent, 4);
+put(kOffsetEcho, datagram.echo, 4);
+
+return at;
+}
+
+
+/*	DecodeBridgeDatagram
+	Extract what a datagram carries
+*/
+BridgeDatagram DecodeBridgeDatagram(
+	const unsigned char *const buffer,
+	const size_t	length
+	)
+{
+using namespace Layout;
+
+// read a little-endian value
+const auto get = [buffer](size_t offset, unsigned n) {
+	uint32_t v = 0;
+	for (unsigned i = n; i-- > 0;)
+		v = v << 8 | buffer[offset + i];
+	return v;
+	};
+
+if (length < kHeaderLength || get(kOffsetMagic, 2) != kMagic) throw "not a bridge datagram";
+if (buffer[kOffsetVersion] != kVersion) throw "unknown bridge datagram version";
+
+BridgeDatagram datagram;
+datagram.kind = static_cast<BridgeDatagram::Kind>(buffer[kOffsetKind]);
+datagram.sequence = get(kOffsetSequence, 4);
+datagram.sent = get(kOffsetSent, 4);
+datagram.echo = get(kOffsetEcho, 4);
+
+size_t at = kHeaderLength;
+for (unsigned n = buffer[kOffsetCount]; n > 0; n--) {
+	if (at + kOffsetValues > length) throw "bridge datagram too short";
+
+	BridgePanel panel = {};
+	panel.index = buffer[at + kOffsetIndex];
+	panel.connected = buffer[at + kOffsetFlags] & kFlagConnected;
+	panel.change = static_cast<uint16_t>(get(at + kOffsetChange, 2));
+	panel.pages = buffer[at + kOffsetPages];
+	panel.delta = static_cast<int16_t>(get(at + kOffsetDelta, 2));
+	panel.time = get(at + kOffsetTime, 4);
+	panel.keys = get(at + kOffsetKeys, 4);
+	at += kOffsetValues;
+
+	if (panel.pages > State::kPagesMaximum || at + panel.pages * 2 * kValueLength > length) throw "bridge datagram too short";
+	for (unsigned page = 0; page < panel.pages; page++)
+		for (unsigned i = 0; i < 2; i++, at += kValueLength)
+			panel.values[page][i] = get(at, kValueLength);
+
+	datagram.panels.push_back(panel);
+	}
+
+return datagram;
+}
@@ -0,0 +1,72 @@
+/*
+	bridge
+
+	Datagram format for carrying panels between machines over UDP
+
+	The panel may be plugged into a different machine than the one running X-Plane.  There, forward.cc sends
+	each panel's latest state to the plugin's RemotePanel (remote.h), and takes back the values X-Plane wants
+	shown.  Every datagram carries the whole state of each panel it mentions, so a lost one costs nothing
+	but time; a sequence number lets the receiver drop any that arrive after a newer one.
+
+	Trust: the bridge is for a network where every machine is trusted, such as a home LAN.  Datagrams are
+	neither authenticated nor encrypted, and the plugin listens on every interface, since the forwarder is
+	by definition elsewhere.  What it does guard against is a second sender: it takes the panel from the
+	first forwarder it hears, ignoring any other address and port, until that one has been silent for
+	kBridgeSilence (so a forwarder that restarted, on a new port, is taken back).  Anyone who can send
+	datagrams from the forwarder's address, or who gets in first, can still show values on and read the
+	panel; don't forward the port to an untrusted network.
+
+	Portable, so it can be checked away from Windows.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "../firmware/State.h"
+
+
+constexpr unsigned short kBridgePort = 49150;		// UDP port the plugin listens on
+constexpr size_t kBridgeDatagramMaximum = 512;		// fits any network's MTU
+constexpr uint32_t kBridgeSilence = 3000000;		// us without a state datagram before another forwarder is heard
+
+
+/*	BridgePanel
+	One panel's state, or the values to show on it
+*/
+struct BridgePanel {
+	uint8_t		index;		// which of the sender's panels
+	bool		connected;	// sender has the panel open
+	uint16_t	change;		// counts changes to the panel; unchanged in a repeated state
+	uint32_t	keys;		// MAX key bits, bank A in the low byte
+	int16_t		delta;		// encoder detents in the last state report
+	uint32_t	time;		// firmware RTC ticks when the state last changed
+	uint8_t		pages;
+	uint32_t	values[State::kPagesMaximum][2]; // active and standby value (20 bits), per radio page
+	};
+
+
+/*	BridgeDatagram
+	What one datagram carries
+*/
+struct BridgeDatagram {
+	enum Kind : uint8_t {
+		kState = 1,		// forwarder to plugin: the panels' state
+		kSet			// plugin to forwarder: values to show
+		};
+
+	Kind		kind;
+	uint32_t	sequence;	// datagrams of this kind sent, wrapping
+	uint32_t	sent;		// BridgeClock() at the sender; means nothing on the other machine's clock
+	uint32_t	echo;		// kState: 'sent' of the newest set datagram taken in (0 before any), so the
+					// plugin can time the round trip on its own clock
+	std::vector<BridgePanel> panels;
+	};
+
+
+extern uint32_t BridgeClock();
+extern bool BridgeNewer(uint32_t sequence, uint32_t than);
+extern size_t EncodeBridgeDatagram(const BridgeDatagram&, unsigned char *buffer, size_t length);
+extern BridgeDatagram DecodeBridgeDatagram(const unsigned char *datagram, size_t length);
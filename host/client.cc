@@ -8,6 +8,7 @@
 
 #include <assert.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "hid.h"
 
@@ -22,6 +23,73 @@ int main(
 {
 Panel panel;
 
+// show what the firmware can do instead?
+if (argc > 1 && strcmp(argv[1], "capabilities") == 0) {
+	const PanelCapabilities &capabilities = panel.FirmwareCapabilities();
+	printf("firmware %04x, protocol %u\n", panel.FirmwareVersion(), capabilities.protocol);
+	printf("%u pages, %u acceleration curves, reports every %u ms\n", capabilities.pages, capabilities.curves, capabilities.interval);
+	printf("features %04x, %s reports\n", capabilities.features, panel.StateReports() ? "state" : "value");
+	return 0;
+	}
+
+// show the firmware's cycle counts instead?
+if (argc > 1 && strcmp(argv[1], "profile") == 0) {
+	static const char *const gProbeNames[] = { "UpdateDisplay", "USBSetup0", "ProcessQDEC", "StepChannel", "QDECLatency", "QDECLatencyLow" };
+	
+	const std::vector<ProbeStatistics> probes = panel.Profile();
+	for (size_t i = 0; i < probes.size(); i++)
+		if (probes[i].count)
+			printf("%-16s %10lu %10lu %10lu %10llu\n",
+				i < sizeof gProbeNames / sizeof *gProbeNames ? gProbeNames[i] : "?",
+				probes[i].minimum, probes[i].maximum, probes[i].count, probes[i].total / probes[i].count);
+	
+	return 0;
+	}
+
+// show the firmware's log as it comes in instead?
+if (argc > 1 && strcmp(argv[1], "log") == 0) {
+	for (unsigned shownDropped = 0;;) {
+		unsigned dropped;
+		const std::vector<LogRecord> records = panel.Log(dropped);
+		
+		if (dropped != shownDropped) {
+			printf("(%u records dropped)\n", dropped - shownDropped);
+			shownDropped = dropped;
+			}
+		
+		for (const LogRecord &record: records)
+			printf("%10.3f %s\n", record.time / 32768.0, FormatLogRecord(record).c_str());
+		
+		// drained?
+		if (records.empty()) Sleep(100 /* ms */);
+		}
+	}
+
+// measure how fast state reports come in instead?
+/* Turn the knob: each second shows the reports read and the reports the panel sent (from its sequence numbers);
+   any difference was lost on the way. */
+if (argc > 1 && strcmp(argv[1], "rate") == 0) {
+	if (!panel.StateReports()) {
+		fprintf(stderr, "panel firmware doesn't send state reports\n");
+		return 1;
+		}
+	
+	for (;;) {
+		const DWORD start = GetTickCount();
+		const unsigned long read = panel.ReportsRead();
+		const unsigned short sequence = panel.ReadState().sequence;
+		
+		while (GetTickCount() - start < 1000 /* ms */) {
+			(void) panel.Set(panel.Value0(), panel.Value1());
+			Sleep(0);
+			}
+		
+		printf("%6lu read %6u sent\n",
+			panel.ReportsRead() - read,
+			static_cast<unsigned short>(panel.ReadState().sequence - sequence));
+		}
+	}
+
 // loop forever, showing incrementing values
 for (unsigned value = 121500;; value += 1001) {
 	const bool changed = panel.Set(value, value + 110110);
@@ -0,0 +1,114 @@
+/*
+	discovery
+
+	Finding and opening the panel in the background
+
+	Portable, so it can be checked away from Windows.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+
+/*	Discovery
+	Find and open the panel in the background
+
+	Enumerating and opening USB devices takes a while; X-Plane shouldn't wait for it while loading, nor
+	should the panel have to be plugged in before X-Plane starts.  P is the connection to the panel (hid.h):
+	constructing one opens it and Sync() finds out what it's displaying, either throwing if it isn't there.
+*/
+template <typename P>
+struct Discovery {
+	static constexpr std::chrono::seconds kRetry{1};	// between looking for the panel
+
+protected:
+	std::mutex	fMutex;
+	std::condition_variable fWake;
+	bool		fStop;
+	std::unique_ptr<P> fFound;
+	std::thread	fThread;	// last, so it starts with everything else set up
+
+	void		Search();
+
+public:
+			Discovery();
+			~Discovery();
+
+	std::unique_ptr<P> Take();
+	};
+
+
+/*	Discovery
+	Start looking for the panel
+*/
+template <typename P>
+Discovery<P>::Discovery() :
+	fStop(false),
+	fThread(&Discovery::Search, this)
+{
+}
+
+
+/*	~Discovery
+	Stop looking, and wait for the thread to finish
+*/
+template <typename P>
+Discovery<P>::~Discovery()
+{
+	{
+	const std::lock_guard<std::mutex> lock(fMutex);
+	fStop = true;
+	}
+fWake.notify_all();
+fThread.join();
+}
+
+
+/*	Search
+	Background thread: try to open the panel until it is there, or we're stopped
+*/
+template <typename P>
+void Discovery<P>::Search()
+{
+std::unique_lock<std::mutex> lock(fMutex);
+
+while (!fStop) {
+	// look without holding the lock, so Take() and stopping don't wait on USB
+	lock.unlock();
+	std::unique_ptr<P> panel;
+	try {
+		// open the connection to the USB device, and find out what it's displaying
+		panel = std::make_unique<P>();
+		panel->Sync();
+		}
+
+	catch (...) {
+		panel.reset();
+		}
+	lock.lock();
+
+	if (panel) {
+		fFound = std::move(panel);
+		break;
+		}
+
+	fWake.wait_for(lock, kRetry, [this] { return fStop; });
+	}
+}
+
+
+/*	Take
+	The panel, if it has been found since; never waits
+*/
+template <typename P>
+std::unique_ptr<P> Discovery<P>::Take()
+{
+const std::unique_lock<std::mutex> lock(fMutex, std::try_to_lock);
+
+return lock ? std::move(fFound) : nullptr;
+}
@@ -0,0 +1,183 @@
+/*
+	forward
+
+	Bridge forwarder for Linux: carries the panel between the panel server on this machine and the plugin
+	on another (see bridge.h)
+
+	Checks the server's shared state every millisecond, the panel's own report interval, and sends it on
+	whenever it changed, and once a second regardless so a plugin that started late or lost a datagram
+	catches up.  Only the latest values the plugin asked for are passed to the server.  Prints the datagram
+	rates every ten seconds.
+
+	usage: forward host [port]
+*/
+
+#include <errno.h>
+#include <netdb.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <optional>
+#include <string>
+
+#include "bridge.h"
+#include "shared.h"
+
+
+static volatile sig_atomic_t gStop;
+
+
+/*	Stop
+	Signal handler: leave the loop
+*/
+static void Stop(
+	int
+	)
+{
+gStop = true;
+}
+
+
+/*	Connect
+	UDP socket sending to the plugin's machine, and receiving only from it
+*/
+static int Connect(
+	const char	*host,
+	const char	*port
+	)
+{
+addrinfo hints = {};
+hints.ai_family = AF_INET;
+hints.ai_socktype = SOCK_DGRAM;
+addrinfo *found;
+if (const int error = getaddrinfo(host, port, &hints, &found)) throw gai_strerror(error);
+
+const int s = socket(found->ai_family, found->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, found->ai_protocol);
+const bool connected = s >= 0 && connect(s, found->ai_addr, found->ai_addrlen) == 0;
+const int error = errno;
+freeaddrinfo(found);
+
+if (!connected) throw error;
+
+return s;
+}
+
+
+/*	Forward
+	Forward until interrupted
+*/
+static void Forward(
+	const int	s
+	)
+{
+static constexpr uint32_t kRepeat = 1000000;	// us between datagrams of an unchanged panel
+static constexpr uint32_t kStatistics = 10000000; // us between printing rates
+
+const SharedPanelReader reader;
+SharedPanelWriter writer;
+
+uint32_t sequence = 0, lastUpdates = 0, lastSent = 0, lastStatistics = BridgeClock();
+bool sentAny = false, haveSet = false, echoing = false;
+uint32_t setSequence = 0, echo = 0;
+unsigned long sent = 0, received = 0, stale = 0;
+
+while (!gStop) {
+	pollfd polled = { s, POLLIN, 0 };
+	(void) poll(&polled, 1, 1 /* ms */);
+
+	// what the plugin asks for; only the latest matters
+	std::optional<BridgePanel> wanted;
+	unsigned char buffer[kBridgeDatagramMaximum];
+	for (ssize_t length; (length = recv(s, buffer, sizeof buffer, 0)) >= 0;)
+		try {
+			const BridgeDatagram datagram = DecodeBridgeDatagram(buffer, length);
+			if (datagram.kind != BridgeDatagram::kSet) continue;
+			received++;
+
+			// overtaken by a newer one?
+			if (haveSet && !BridgeNewer(datagram.sequence, setSequence)) {
+				stale++;
+				continue;
+				}
+			haveSet = true;
+			setSequence = datagram.sequence;
+			echo = datagram.sent;
+			echoing = true;
+
+			for (const BridgePanel &panel : datagram.panels)
+				if (panel.index == 0 && panel.pages > 0) wanted = panel;
+			}
+
+		catch (const char*) {}
+
+	if (wanted) writer.Set(wanted->values[0][0], wanted->values[0][1]);
+
+	// send the panel on if it changed, or hasn't been sent for a while; or at once, to echo a set
+	const SharedState state = reader.Read();
+	const uint32_t now = BridgeClock();
+	if (!sentAny || echoing || state.updates != lastUpdates || now - lastSent >= kRepeat) {
+		BridgePanel panel = { 0, state.connected, static_cast<uint16_t>(state.updates), state.keys, state.delta, state.time, state.pages, {} };
+		memcpy(panel.values, state.values, sizeof panel.values);
+
+		BridgeDatagram datagram = { BridgeDatagram::kState, ++sequence, now, echo, { panel } };
+		const size_t length = EncodeBridgeDatagram(datagram, buffer, sizeof buffer);
+
+		// nobody listening yet is no reason to stop
+		(void) send(s, buffer, length, MSG_NOSIGNAL);
+
+		sent++;
+		sentAny = true;
+		echoing = false;
+		lastUpdates = state.updates;
+		lastSent = now;
+		}
+
+	if (now - lastStatistics >= kStatistics) {
+		const double seconds = (now - lastStatistics) / 1e6;
+		fprintf(stderr, "%.1f state datagrams/s sent, %.1f set datagrams/s received, %lu stale\n", sent / seconds, received / seconds, stale);
+		sent = received = stale = 0;
+		lastStatistics = now;
+		}
+	}
+}
+
+
+/*	main
+	Command line
+*/
+int main(
+	int		argc,
+	const char	*argv[]
+	)
+{
+if (argc < 2) {
+	fprintf(stderr, "usage: %s host [port]\n", argv[0]);
+	return 2;
+	}
+
+signal(SIGINT, Stop);
+signal(SIGTERM, Stop);
+
+try {
+	const int s = Connect(argv[1], argc > 2 ? argv[2] : std::to_string(kBridgePort).c_str());
+	Forward(s);
+	close(s);
+	}
+
+catch (const char *error) {
+	fprintf(stderr, "%s\n", error);
+	return 1;
+	}
+
+catch (int error) {
+	fprintf(stderr, "%s\n", strerror(error));
+	return 1;
+	}
+
+return 0;
+}
@@ -107,7 +107,10 @@ return attributes.VersionNumber;
 */
 Panel::Panel() :
 	fHandle(OpenDevice()),
-	fFirmwareVersion(OurFirmwareVersion(fHandle))
+	fFirmwareVersion(OurFirmwareVersion(fHandle)),
+	fCapabilities(),
+	fStateReports(false),
+	fReportsRead(0)
 {
 // get HID driver 'preparsed data'
 if (!HidD_GetPreparsedData(fHandle, &fPreparsed)) throw GetLastError();
@@ -116,6 +119,43 @@ if (!HidD_GetPreparsedData(fHandle, &fPreparsed)) throw GetLastError();
 HIDP_CAPS capabilities;
 if (HidP_GetCaps(fPreparsed, &capabilities) != HIDP_STATUS_SUCCESS) throw "can't get device capabilities";
 // if (capabilities.OutputReportByteLength != sizeof(Report)) throw "unexpected panel HID report size";
+
+// report buffers must be the size of the longest report of their type
+fInputReportLength = capabilities.InputReportByteLength;
+fFeatureReportLength = capabilities.FeatureReportByteLength;
+
+// find out what the firmware can do
+/* Its report descriptor tells us whether it has the capabilities report at all; firmware from before it
+   existed only sends its two values, which is what fCapabilities being all zero means. */
+if (HasFeatureReport(0x29 /* capabilities */)) {
+	std::vector<unsigned char> buffer(fFeatureReportLength);
+	buffer[0] = kReportCapabilities;
+	if (!HidD_GetFeature(fHandle, buffer.data(), static_cast<ULONG>(buffer.size()))) throw GetLastError();
+	
+	fCapabilities = DecodeCapabilitiesReport(buffer.data(), buffer.size());
+	}
+
+// pick the Input report layout
+/* Firmware that has the state report sends nothing else on its interrupt endpoint, so one in a layout we
+   don't know is refused here rather than misread later. */
+if (fCapabilities.features & Capabilities::kFeatureStateReport) {
+	if (fCapabilities.stateLayout != State::kLayout) throw "panel firmware uses a state report layout we don't know";
+	fStateReports = true;
+	}
+}
+
+
+/*	HasFeatureReport
+	Whether the panel's report descriptor has a Feature report with the given (vendor page) usage
+*/
+bool Panel::HasFeatureReport(
+	unsigned short	usage
+	) const
+{
+HIDP_VALUE_CAPS capabilities;
+USHORT capabilitiesN = 1;
+
+return HidP_GetSpecificValueCaps(HidP_Feature, 0xffa0 /* usage page */, 0, usage, &capabilities, &capabilitiesN, fPreparsed) == HIDP_STATUS_SUCCESS;
 }
 
 
@@ -128,6 +168,107 @@ Panel::~Panel()
 }
 
 
+/*	Configure
+	Select the panel's encoder acceleration curve (0 turns acceleration off) and sampling mode
+	
+	With a nonzero idle rate (in 4 ms units) the panel also repeats its state when it hasn't sent it for that
+	long, which bounds how stale our copy can get at the cost of some bus traffic.
+*/
+void Panel::Configure(
+	unsigned char	accelerationCurve,
+	bool		lowLatency,
+	unsigned char	idleRate
+	)
+{
+const FeatureReport report = { kReportSettings, accelerationCurve, lowLatency, idleRate };
+
+const unsigned char *const bytes = reinterpret_cast<const unsigned char*>(&report);
+std::vector<unsigned char> buffer(bytes, bytes + sizeof report);
+if (buffer.size() < fFeatureReportLength) buffer.resize(fFeatureReportLength);
+if (!HidD_SetFeature(fHandle, buffer.data(), static_cast<ULONG>(buffer.size()))) throw GetLastError();
+}
+
+
+/*	Profile
+	Get the firmware's cycle counts, per probe
+	
+	Only firmware built with INSTRUMENTATION counts; otherwise every probe reports a count of zero.
+*/
+std::vector<ProbeStatistics> Panel::Profile()
+{
+std::vector<unsigned char> buffer(fFeatureReportLength);
+buffer[0] = kReportProfile;
+if (!HidD_GetFeature(fHandle, buffer.data(), static_cast<ULONG>(buffer.size()))) throw GetLastError();
+
+// skip the report ID
+return DecodeProfile(buffer.data() + 1, buffer.size() - 1);
+}
+
+
+/*	Log
+	Collect the records the firmware logged since the last call; also returns its count of dropped records
+	
+	Each call collects at most a few records; call until none are returned.
+*/
+std::vector<LogRecord> Panel::Log(
+	unsigned	&dropped
+	)
+{
+std::vector<unsigned char> buffer(fFeatureReportLength);
+buffer[0] = kReportLog;
+if (!HidD_GetFeature(fHandle, buffer.data(), static_cast<ULONG>(buffer.size()))) throw GetLastError();
+
+return DecodeLogReport(buffer.data(), buffer.size(), dropped);
+}
+
+
+/*	Sync
+	Read the values the panel is displaying now
+	
+	One control transfer, rather than waiting for the panel to send its values when they next change.
+	Afterwards Value0() and Value1() are the panel's values, and Set() only writes values that differ.
+	Firmware that can't answer is left to send its values when they change, as before.
+*/
+void Panel::Sync()
+{
+if (!(fCapabilities.features & Capabilities::kFeatureSync)) return;
+
+std::vector<unsigned char> buffer(fInputReportLength > sizeof fRead->fBuffer ? fInputReportLength : sizeof fRead->fBuffer);
+buffer[0] = fStateReports ? kReportState : kReportPanel;
+if (!HidD_GetInputReport(fHandle, buffer.data(), static_cast<ULONG>(buffer.size()))) throw GetLastError();
+
+Read(buffer.data());
+fWroteValue0 = fReadValue0;
+fWroteValue1 = fReadValue1;
+}
+
+
+/*	Read
+	Take in an Input report the panel sent
+*/
+void Panel::Read(
+	const unsigned char *const report
+	)
+{
+switch (report[0]) {
+	case kReportPanel:
+		fReadValue0 = reinterpret_cast<const Report*>(report)->value0;
+		fReadValue1 = reinterpret_cast<const Report*>(report)->value1;
+		break;
+	
+	case kReportState:
+		fState = DecodeStateReport(report, State::kReportLength);
+		if (!fState.pages.empty()) {
+			fReadValue0 = fState.pages[0].first;
+			fReadValue1 = fState.pages[0].second;
+			}
+		break;
+	}
+
+fReportsRead++;
+}
+
+
 /*	Set
 	Apply values to display
 	
@@ -154,7 +295,7 @@ do {
 		fRead->fOverlapped.hEvent = nullptr; // use file handle as synchronization object
 		
 		// make asynchronous read request
-		if (!ReadFile(fHandle, &fRead->fReport, sizeof fRead->fReport, nullptr, &fRead->fOverlapped))
+		if (!ReadFile(fHandle, fRead->fBuffer, fInputReportLength < sizeof fRead->fBuffer ? fInputReportLength : sizeof fRead->fBuffer, nullptr, &fRead->fOverlapped))
 			// call should only 'fail' because it is now pending
 			switch (const DWORD error = GetLastError()) {
 				case ERROR_IO_PENDING: break;
@@ -173,8 +314,7 @@ do {
 		GetOverlappedResult(fHandle, &fRead->fOverlapped, &read, false /* wait */)
 		) {
 		// extract read value
-		fReadValue0 = fRead->fReport.value0;
-		fReadValue1 = fRead->fReport.value1;
+		Read(fRead->fBuffer);
 		readUpdatedValue = true;
 		
 		// request no longer pending
@@ -217,7 +357,7 @@ if (value0 != fWroteValue0 || value1 != fWroteValue1)
 	if (!fWrite) {
 		// prepare an asynchronous write request
 		fWrite.emplace();
-		fWrite->fReport.reportID = 0;
+		fWrite->fReport.reportID = kReportPanel;
 		fWrite->fReport.value0 = value0;
 		fWrite->fReport.value1 = value1;
 		fWrite->fOverlapped.Offset = fWrite->fOverlapped.OffsetHigh = 0;
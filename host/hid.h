@@ -13,6 +13,13 @@
 
 #include <memory>
 #include <optional>
+#include <vector>
+
+#include "log.h"
+#include "profile.h"
+#include "report.h"
+#include "../firmware/Capabilities.h"
+#include "../firmware/State.h"
 
 
 /*	Panel
@@ -20,6 +27,19 @@
 */
 struct Panel {
 protected:
+	/*	ReportID
+		USB HID report IDs (as in the firmware report descriptor)
+	*/
+	enum ReportID : char {
+		kReportPanel = 1,
+		kReportSettings,
+		kReportProfile,
+		kReportLog,
+		kReportState,
+		kReportCapabilities
+		};
+	
+	
 	/*	Report
 		USB HID Report
 	*/
@@ -30,15 +50,31 @@ protected:
 				value0 : 20,
 				value1 : 20;
 		};
+	
+	
+	/*	FeatureReport
+		USB HID Feature Report (panel settings)
+	*/
+	struct FeatureReport {
+		char		reportID;
+		unsigned char	accelerationCurve;
+		unsigned char	encoderSampling;
+		unsigned char	idleRate;
+		};
 	#pragma pack(pop)
 	
 	
 	/*	IO
 		USB HID I/O request
+		
+		Reads must have room for the longest Input report the panel has.
 	*/
 	struct IO {
 		OVERLAPPED	fOverlapped;
-		Report		fReport;
+		union {
+			Report		fReport;
+			unsigned char	fBuffer[State::kReportLength];
+			};
 		};
 	
 	
@@ -72,6 +108,15 @@ protected:
 	const Handle	fHandle;
 	PHIDP_PREPARSED_DATA fPreparsed;
 	const unsigned short fFirmwareVersion;
+	unsigned short	fInputReportLength,
+			fFeatureReportLength;
+	PanelCapabilities fCapabilities;
+	bool		fStateReports;		// panel sends state reports rather than just its values
+	PanelState	fState;
+	unsigned long	fReportsRead;
+	
+	bool		HasFeatureReport(unsigned short usage) const;
+	void		Read(const unsigned char *report);
 
 public:
 			Panel();
@@ -80,8 +125,16 @@ public:
 	operator	HANDLE() { return fHandle; }
 	
 	unsigned short	FirmwareVersion() const { return fFirmwareVersion; }
+	const PanelCapabilities &FirmwareCapabilities() const { return fCapabilities; }
 	
+	void		Sync();
 	bool		Set(unsigned valueMain, unsigned valueStandby);
+	void		Configure(unsigned char accelerationCurve, bool lowLatency, unsigned char idleRate);
+	std::vector<ProbeStatistics> Profile();
+	std::vector<LogRecord> Log(unsigned &dropped);
 	unsigned	Value0() const { return fReadValue0; }
 	unsigned	Value1() const { return fReadValue1; }
+	bool		StateReports() const { return fStateReports; }
+	const PanelState &ReadState() const { return fState; }
+	unsigned long	ReportsRead() const { return fReportsRead; }
 	};
@@ -0,0 +1,83 @@
+/*
+	log
+	
+	Decoder for the panel firmware's binary log
+*/
+
+#include <stdio.h>
+
+#include "log.h"
+
+
+/*	gFormats
+	Message formats, in the order the firmware numbers them
+*/
+static const char *const gFormats[] = {
+	#define LOG_FORMAT(identifier, format) format,
+	#include "../firmware/LogFormats.h"
+	#undef LOG_FORMAT
+	};
+
+
+/*	DecodeLogReport
+	Extract the records from a log Feature report; also returns the firmware's count of dropped records
+	
+	The report is the ID, the 16-bit count of dropped records, the number of records that follow, and the
+	records; all little-endian.
+*/
+std::vector<LogRecord> DecodeLogReport(
+	const unsigned char *const report,
+	const size_t	length,
+	unsigned	&dropped
+	)
+{
+std::vector<LogRecord> records;
+
+// too short for the header?
+if (length < 4) throw "log report too short";
+
+// read a little-endian value
+const auto value = [report](size_t offset, unsigned n) {
+	unsigned long v = 0;
+	for (unsigned i = n; i-- > 0;)
+		v = v << 8 | report[offset + i];
+	return v;
+	};
+
+dropped = value(1, 2);
+
+// each record is time, format, argument count, padding, two arguments
+const size_t kRecordLength = 4 + 2 + 1 + 1 + 4 + 4;
+for (size_t record = 0, offset = 4; record < report[3] && offset + kRecordLength <= length; record++, offset += kRecordLength)
+	records.push_back({
+		value(offset + 0, 4),
+		static_cast<unsigned short>(value(offset + 4, 2)),
+		static_cast<unsigned char>(value(offset + 6, 1)),
+		{ value(offset + 8, 4), value(offset + 12, 4) }
+		});
+
+return records;
+}
+
+
+/*	FormatLogRecord
+	Expand a record into text
+*/
+std::string FormatLogRecord(
+	const LogRecord	&record
+	)
+{
+char text[256];
+
+// firmware newer than this decoder?
+if (record.format >= sizeof gFormats / sizeof *gFormats)
+	snprintf(text, sizeof text, "unknown message %u (%lu, %lu)", record.format, record.arguments[0], record.arguments[1]);
+
+else
+	/* Formats expect 32-bit unsigned arguments; unused ones are ignored. */
+	snprintf(text, sizeof text, gFormats[record.format],
+		static_cast<unsigned>(record.arguments[0]),
+		static_cast<unsigned>(record.arguments[1]));
+
+return text;
+}
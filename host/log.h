@@ -0,0 +1,28 @@
+/*
+	log
+	
+	Decoder for the panel firmware's binary log
+	
+	Portable, so it can be checked away from Windows.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+
+/*	LogRecord
+	One message logged by the firmware
+*/
+struct LogRecord {
+	unsigned long	time;		// firmware RTC ticks (32768 per second, 24 bits)
+	unsigned short	format;		// index into firmware/LogFormats.h
+	unsigned char	argumentsN;
+	unsigned long	arguments[2];
+	};
+
+
+extern std::vector<LogRecord> DecodeLogReport(const unsigned char *report, size_t length, unsigned &dropped);
+extern std::string FormatLogRecord(const LogRecord&);
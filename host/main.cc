@@ -9,11 +9,16 @@
 #include <XPLMGraphics.h>
 #include <XPLMProcessing.h>
 
+#include <memory>
 #include <optional>
 
 #include <string.h>
 
+#include "bridge.h"
+#include "discovery.h"
 #include "hid.h"
+#include "remote.h"
+#include "telemetry.h"
 #include "xplane.h"
 
 
@@ -58,9 +63,33 @@ public:
 	};
 
 
+/*	TelemetryDataRefs
+	Datarefs publishing the connection statistics
+*/
+struct TelemetryDataRefs {
+protected:
+	XPlaneDataRef<int> fConnection,
+			fReports,
+			fStale;
+	XPlaneDataRef<float> fReportRate,
+			fRoundTrip;
+
+public:
+			TelemetryDataRefs(const Telemetry&);
+	};
 
-// USB HID interface
-static std::optional<Panel> gPanel;
+
+
+// USB HID interface, once it's found
+static std::unique_ptr<Panel> gPanel;
+static std::optional<Discovery<Panel>> gDiscovery;
+
+// or the panel on another machine, through the UDP bridge
+static std::optional<RemotePanel> gRemotePanel;
+
+// how the connection is doing, for other plugins
+static Telemetry gTelemetry;
+static std::optional<TelemetryDataRefs> gTelemetryDataRefs;
 
 // window
 static std::optional<Window> gWindow;
@@ -128,6 +157,39 @@ XPLMDrawString(col_white, l + 10, t - 20, title, NULL, xplmFont_Proportional);
 }
 
 
+/*	TelemetryDataRefs
+	Register the datarefs
+*/
+TelemetryDataRefs::TelemetryDataRefs(
+	const Telemetry	&telemetry
+	) :
+	fConnection("xplanepanel/connection", telemetry.connection),	// Telemetry::Connection
+	fReports("xplanepanel/reports", telemetry.reports),
+	fStale("xplanepanel/stale", telemetry.stale),
+	fReportRate("xplanepanel/report_rate", telemetry.reportRate),	// per second
+	fRoundTrip("xplanepanel/round_trip_ms", telemetry.roundTrip)	// bridge only
+{
+}
+
+
+/*	Exchange
+	Synchronize values between X-Plane and a panel; return whether the panel changed them
+*/
+template <typename P>
+static bool Exchange(
+	P		&panel,
+	int		&valueMain,
+	int		&valueStandby
+	)
+{
+if (!panel.Set(valueMain, valueStandby)) return false;
+
+valueMain = panel.Value0();
+valueStandby = panel.Value1();
+return true;
+}
+
+
 /*	Callback
 	Prepare periodic callback
 */
@@ -135,8 +197,9 @@ Callback::Callback() :
 	XPlaneFlightLoop<Callback>(xplm_FlightLoop_Phase_AfterFlightModel),
 	
 	// get data references
-	fCOM1FrequencyMainRef(XPLMFindDataRef("sim/cockpit/radios/com1_freq_hz")),
-	fCOM1FrequencyStandbyRef(XPLMFindDataRef("sim/cockpit/radios/com1_stdby_freq_hz"))
+	/* In kHz, as the panel has them, and with 8.33 kHz channels, which the 10 kHz com1_freq_hz can't hold. */
+	fCOM1FrequencyMainRef(XPLMFindDataRef("sim/cockpit2/radios/actuators/com1_frequency_hz_833")),
+	fCOM1FrequencyStandbyRef(XPLMFindDataRef("sim/cockpit2/radios/actuators/com1_standby_frequency_hz_833"))
 {
 }
 
@@ -152,21 +215,47 @@ float Callback::operator()(
 {
 // get COM1 frequency from X-Plane
 int
-	com1FrequencyMain = XPLMGetDatai(fCOM1FrequencyMainRef) * 10,
-	com1FrequencyStandby = XPLMGetDatai(fCOM1FrequencyStandbyRef) * 10;
+	com1FrequencyMain = XPLMGetDatai(fCOM1FrequencyMainRef),
+	com1FrequencyStandby = XPLMGetDatai(fCOM1FrequencyStandbyRef);
 
-// USB interface exists?
+// pick up the panel once discovery has found it
+if (gDiscovery && !gPanel)
+	gPanel = gDiscovery->Take();
 if (gPanel)
-	// synchronize value from X-Plane with panel; did panel's value change?
-	if ((*gPanel).Set(com1FrequencyMain, com1FrequencyStandby)) {
-		// update based on panel's value
-		com1FrequencyMain = gPanel->Value0();
-		com1FrequencyStandby = gPanel->Value1();
-		
-		// synchronize value from panel with X-Plane
-		XPLMSetDatai(fCOM1FrequencyMainRef, com1FrequencyMain / 10);
-		XPLMSetDatai(fCOM1FrequencyStandbyRef, com1FrequencyStandby / 10);
+	gDiscovery.reset();
+
+// synchronize value from X-Plane with panel; did panel's value change?
+bool changed = false;
+try {
+	changed =
+		gPanel ? Exchange(*gPanel, com1FrequencyMain, com1FrequencyStandby) :
+		gRemotePanel ? Exchange(*gRemotePanel, com1FrequencyMain, com1FrequencyStandby) :
+		false;
+	}
+
+catch (...) {
+	// unplugged: look for it again
+	if (gPanel) {
+		gPanel.reset();
+		gDiscovery.emplace();
 		}
+	}
+
+if (changed) {
+	// synchronize value from panel with X-Plane
+	XPLMSetDatai(fCOM1FrequencyMainRef, com1FrequencyMain);
+	XPLMSetDatai(fCOM1FrequencyStandbyRef, com1FrequencyStandby);
+	}
+
+// publish how the connection is doing
+if (gPanel)
+	gTelemetry.Update(Telemetry::kUSB, gPanel->ReportsRead(), 0, 0, 0, elapsedSinceLastCall);
+else if (gRemotePanel && gRemotePanel->Connected()) {
+	const BridgeStatistics &statistics = gRemotePanel->Statistics();
+	gTelemetry.Update(Telemetry::kBridge, statistics.datagrams, statistics.stale, statistics.roundTrips, statistics.roundTripTotal, elapsedSinceLastCall);
+	}
+else
+	gTelemetry.Update(gDiscovery ? Telemetry::kSearching : Telemetry::kNone, 0, 0, 0, 0, elapsedSinceLastCall);
 
 // make sure window is displaying the current values
 if (gWindow)
@@ -198,8 +287,18 @@ try {
 	memcpy(outDesc, gPanelDescription, sizeof gPanelDescription);
 	static_assert(sizeof gPanelDescription <= 256);
 
-	// open the connection to the USB device
-	gPanel.emplace();
+	// look for the panel in the background; the callback picks it up when it's found
+	gDiscovery.emplace();
+	
+	// meanwhile, or instead, the panel may be on another machine, forwarded through the bridge
+	try {
+		gRemotePanel.emplace(kBridgePort);
+		}
+	
+	catch (...) {}
+
+	// publish the connection statistics
+	gTelemetryDataRefs.emplace(gTelemetry);
 
 	// create an X-Plane window (for debugging purposes)
 	// gWindow.emplace();
@@ -213,8 +312,8 @@ catch (...) {
 	// *** how do we report errors?
 	}
 
-// return whether the USB panel connection and the X-Plane callback were successfully set up
-return gPanel && gCallback;
+// return whether the X-Plane callback was successfully set up; the panel may turn up later
+return gCallback.has_value();
 }
 
 
@@ -230,8 +329,13 @@ try {
 	// close the window
 	gWindow.reset();
 
-	// close the connection to the USB device
+	// withdraw the datarefs
+	gTelemetryDataRefs.reset();
+
+	// stop looking for the panel, and close the connection to it
+	gDiscovery.reset();
 	gPanel.reset();
+	gRemotePanel.reset();
 	}
 
 catch (...) {}
@@ -0,0 +1,39 @@
+/*
+	profile
+	
+	Decoder for the panel firmware's cycle counts
+*/
+
+#include "profile.h"
+
+
+/*	DecodeProfile
+	Extract the probe statistics from the firmware's encoding
+	
+	Each probe is minimum, maximum, count, and the low and high halves of the total; all 32-bit little-endian.
+*/
+std::vector<ProbeStatistics> DecodeProfile(
+	const unsigned char *const encoded,
+	const size_t	length
+	)
+{
+// read one little-endian word
+const auto word = [encoded](size_t offset) {
+	return
+		static_cast<unsigned long>(encoded[offset + 0]) |
+		static_cast<unsigned long>(encoded[offset + 1]) << 8 |
+		static_cast<unsigned long>(encoded[offset + 2]) << 16 |
+		static_cast<unsigned long>(encoded[offset + 3]) << 24;
+	};
+
+std::vector<ProbeStatistics> probes;
+for (size_t offset = 0; offset + 5 * 4 <= length; offset += 5 * 4)
+	probes.push_back({
+		word(offset + 0),
+		word(offset + 4),
+		word(offset + 8),
+		word(offset + 12) | static_cast<unsigned long long>(word(offset + 16)) << 32
+		});
+
+return probes;
+}
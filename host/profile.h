@@ -0,0 +1,26 @@
+/*
+	profile
+	
+	Decoder for the panel firmware's cycle counts
+	
+	Portable, so it can be checked away from Windows.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+
+/*	ProbeStatistics
+	Cycles the firmware spent in one profiled code path
+*/
+struct ProbeStatistics {
+	unsigned long	minimum,
+			maximum,
+			count;
+	unsigned long long total;
+	};
+
+
+extern std::vector<ProbeStatistics> DecodeProfile(const unsigned char *encoded, size_t length);
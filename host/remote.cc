@@ -0,0 +1,255 @@
+/*
+	remote
+
+	Panel plugged into another machine, reached through the UDP bridge
+*/
+
+#ifdef _WIN32
+	#include <WINSOCK2.H>
+
+	typedef int socklen_t;
+#else
+	#include <fcntl.h>
+	#include <netinet/in.h>
+	#include <sys/select.h>
+	#include <sys/socket.h>
+	#include <unistd.h>
+
+	#define closesocket close
+	static constexpr int INVALID_SOCKET = -1;
+#endif
+
+#include "bridge.h"
+#include "remote.h"
+
+
+/*	OpenSocket
+	UDP socket listening on the port, not blocking
+*/
+static uintptr_t OpenSocket(
+	unsigned short	port
+	)
+{
+#ifdef _WIN32
+WSADATA data;
+if (const int error = WSAStartup(MAKEWORD(2, 2), &data)) throw error;
+#endif
+
+const auto s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+if (s == INVALID_SOCKET) throw "can't create bridge socket";
+
+sockaddr_in address = {};
+address.sin_family = AF_INET;
+address.sin_addr.s_addr = htonl(INADDR_ANY);
+address.sin_port = htons(port);
+
+#ifdef _WIN32
+u_long nonblocking = 1;
+const bool ready = ioctlsocket(s, FIONBIO, &nonblocking) == 0;
+#else
+const bool ready = fcntl(s, F_SETFL, O_NONBLOCK) == 0;
+#endif
+
+if (!ready || bind(s, reinterpret_cast<const sockaddr*>(&address), sizeof address) != 0) {
+	closesocket(s);
+	throw "can't listen on the bridge port";
+	}
+
+return static_cast<uintptr_t>(s);
+}
+
+
+/*	RemotePanel
+	Listen for the forwarder
+*/
+RemotePanel::RemotePanel(
+	unsigned short	port
+	) :
+	fSocket(OpenSocket(port)),
+	fBridgeAddress(0),
+	fBridgePort(0),
+	fHeard(0),
+	fSetSent(0),
+	fHaveForwarder(false),
+	fHaveState(false),
+	fConnected(false),
+	fAwaitingEcho(false),
+	fReceivedSequence(0),
+	fSentSequence(0),
+	fChange(0),
+	fReadValue0(0),
+	fReadValue1(0),
+	fWroteValue0(0),
+	fWroteValue1(0),
+	fStatistics{}
+{
+}
+
+
+/*	~RemotePanel
+	Stop listening
+*/
+RemotePanel::~RemotePanel()
+{
+closesocket(fSocket);
+
+#ifdef _WIN32
+WSACleanup();
+#endif
+}
+
+
+/*	Receive
+	Take in every datagram that arrived; return whether the panel changed
+*/
+bool RemotePanel::Receive()
+{
+bool changed = false;
+
+for (;;) {
+	unsigned char buffer[kBridgeDatagramMaximum];
+	sockaddr_in from;
+	socklen_t fromLength = sizeof from;
+
+	const auto length = recvfrom(fSocket, reinterpret_cast<char*>(buffer), sizeof buffer, 0, reinterpret_cast<sockaddr*>(&from), &fromLength);
+	if (length < 0) break;	// nothing more, for now
+
+	BridgeDatagram datagram;
+	try {
+		datagram = DecodeBridgeDatagram(buffer, length);
+		}
+
+	catch (const char*) {
+		continue;
+		}
+
+	if (datagram.kind != BridgeDatagram::kState) continue;
+
+	// from the forwarder, or a new one now the last has gone quiet?
+	const uint32_t now = BridgeClock();
+	const bool forwarder = from.sin_addr.s_addr == fBridgeAddress && from.sin_port == fBridgePort;
+	if (fHaveForwarder && !forwarder && now - fHeard < kBridgeSilence) {
+		fStatistics.foreign++;
+		continue;
+		}
+
+	// overtaken by a newer one?
+	/* A forwarder that restarted counts from zero again; one that far behind is taken to be that. */
+	if (fHaveForwarder && forwarder && !BridgeNewer(datagram.sequence, fReceivedSequence) && fReceivedSequence - datagram.sequence < 1000) {
+		fStatistics.stale++;
+		continue;
+		}
+
+	fStatistics.datagrams++;
+
+	// echoing the last set?
+	/* Both ends of the round trip are on this machine's clock; the forwarder's isn't comparable. */
+	if (fAwaitingEcho && forwarder && datagram.echo == fSetSent) {
+		const uint32_t roundTrip = now - fSetSent;
+		fStatistics.roundTrips++;
+		fStatistics.roundTripTotal += roundTrip;
+		if (roundTrip > fStatistics.roundTripMaximum) fStatistics.roundTripMaximum = roundTrip;
+		fAwaitingEcho = false;
+		}
+
+	fReceivedSequence = datagram.sequence;
+	fBridgeAddress = from.sin_addr.s_addr;
+	fBridgePort = from.sin_port;
+	fHaveForwarder = true;
+	fHeard = now;
+
+	// the one panel the plugin knows of
+	for (const BridgePanel &panel : datagram.panels)
+		if (panel.index == 0) {
+			fConnected = panel.connected;
+			if (!panel.connected || panel.pages == 0) continue;
+
+			// a repeated state also says what the panel is showing, in case a set went missing
+			if (!fHaveState || panel.change != fChange) changed = true;
+			fHaveState = true;
+			fChange = panel.change;
+
+			fReadValue0 = fWroteValue0 = panel.values[0][0];
+			fReadValue1 = fWroteValue1 = panel.values[0][1];
+			}
+	}
+
+return changed;
+}
+
+
+/*	Send
+	Ask the forwarder to show values on the panel
+*/
+void RemotePanel::Send(
+	unsigned	value0,
+	unsigned	value1
+	)
+{
+BridgeDatagram datagram = { BridgeDatagram::kSet, ++fSentSequence, BridgeClock(), 0, {} };
+
+BridgePanel panel = {};
+panel.pages = 1;
+panel.values[0][0] = value0;
+panel.values[0][1] = value1;
+datagram.panels.push_back(panel);
+
+unsigned char buffer[kBridgeDatagramMaximum];
+const size_t length = EncodeBridgeDatagram(datagram, buffer, sizeof buffer);
+
+sockaddr_in to = {};
+to.sin_family = AF_INET;
+to.sin_addr.s_addr = fBridgeAddress;
+to.sin_port = fBridgePort;
+
+// lost or not, the next state datagram tells whether it arrived
+(void) sendto(fSocket, reinterpret_cast<const char*>(buffer), static_cast<int>(length), 0, reinterpret_cast<const sockaddr*>(&to), sizeof to);
+fStatistics.sent++;
+
+// time it until the forwarder echoes it; a set that was lost, or overtaken, is never timed
+fSetSent = datagram.sent;
+fAwaitingEcho = true;
+}
+
+
+/*	Sync
+	Wait a little for the forwarder to say what the panel is showing
+*/
+void RemotePanel::Sync()
+{
+for (unsigned tries = 0; !fHaveState && tries < 10; tries++) {
+	fd_set readable;
+	FD_ZERO(&readable);
+	FD_SET(fSocket, &readable);
+
+	timeval timeout = { 0, 100000 /* us */ };
+	(void) select(static_cast<int>(fSocket + 1), &readable, nullptr, nullptr, &timeout);
+
+	(void) Receive();
+	}
+}
+
+
+/*	Set
+	Apply values to display
+
+	As Panel::Set: the values are sent only if the panel isn't already showing them.  Returns whether the
+	panel itself reported changed values.
+*/
+bool RemotePanel::Set(
+	unsigned	value0,
+	unsigned	value1
+	)
+{
+const bool changed = Receive();
+
+// need to update the panel, and know where it is?
+/* After a change the caller's values are the old ones, about to be replaced; sending them back would undo it. */
+if (!changed && fHaveState && fConnected && (value0 != fWroteValue0 || value1 != fWroteValue1)) {
+	Send(value0, value1);
+	fWroteValue0 = value0;
+	fWroteValue1 = value1;
+	}
+
+return changed;
+}
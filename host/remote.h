@@ -0,0 +1,70 @@
+/*
+	remote
+
+	Panel plugged into another machine, reached through the UDP bridge (see bridge.h)
+
+	Stands in for Panel (hid.h) in the plugin: the same Sync, Set and value accessors.
+	Portable, so it can be checked away from Windows.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+
+/*	BridgeStatistics
+	How the bridge is doing, as seen from this end
+*/
+struct BridgeStatistics {
+	unsigned long	datagrams,	// state datagrams received
+			stale,		// ... that arrived after a newer one, and were dropped
+			foreign,	// ... from other than the forwarder, and ignored
+			sent,		// set datagrams sent
+			roundTrips;	// ... whose echo came back
+	unsigned long long roundTripTotal; // microseconds from sending a set to taking in its echo, over all
+	uint32_t	roundTripMaximum;
+	};
+
+
+/*	RemotePanel
+	Connection to a panel through the bridge
+
+	The forwarder's address is learned from the first state datagram; until then nothing can be sent back.
+	After that, state datagrams from anywhere else are ignored while the forwarder keeps sending (see the
+	trust assumption in bridge.h).
+*/
+struct RemotePanel {
+protected:
+	uintptr_t	fSocket;		// SOCKET, or file descriptor
+	uint32_t	fBridgeAddress;		// forwarder's IPv4 address and port, network order
+	uint16_t	fBridgePort;
+	uint32_t	fHeard,			// BridgeClock() at the forwarder's last state datagram
+			fSetSent;		// BridgeClock() at the last set datagram, if fAwaitingEcho
+	bool		fHaveForwarder,
+			fHaveState,
+			fConnected,
+			fAwaitingEcho;
+	uint32_t	fReceivedSequence,
+			fSentSequence;
+	uint16_t	fChange;
+	unsigned	fReadValue0,
+			fReadValue1,
+			fWroteValue0,
+			fWroteValue1;
+	BridgeStatistics fStatistics;
+
+	bool		Receive();
+	void		Send(unsigned value0, unsigned value1);
+
+public:
+	explicit	RemotePanel(unsigned short port);
+			RemotePanel(const RemotePanel&) = delete;
+			~RemotePanel();
+
+	void		Sync();
+	bool		Set(unsigned valueMain, unsigned valueStandby);
+	unsigned	Value0() const { return fReadValue0; }
+	unsigned	Value1() const { return fReadValue1; }
+	bool		Connected() const { return fConnected; }
+	const BridgeStatistics &Statistics() const { return fStatistics; }
+	};
@@ -0,0 +1,111 @@
+/*
+	report
+	
+	Coders for the panel's Input, Output and Feature reports
+*/
+
+#include <algorithm>
+
+#include "report.h"
+#include "../firmware/Capabilities.h"
+#include "../firmware/State.h"
+
+
+/*	DecodePanelReport
+	Extract the two 20-bit values from a panel values report (without checking the report ID)
+	
+	The values are packed little-endian after the ID, the first in the low bits.
+*/
+std::pair<unsigned long, unsigned long> DecodePanelReport(
+	const unsigned char *const report,
+	const size_t	length
+	)
+{
+if (length < kPanelReportLength) throw "panel report too short";
+
+unsigned long long bits = 0;
+for (size_t i = kPanelReportLength; i-- > 1;)
+	bits = bits << 8 | report[i];
+
+return { static_cast<unsigned long>(bits & 0xFFFFF), static_cast<unsigned long>(bits >> 20 & 0xFFFFF) };
+}
+
+
+/*	EncodePanelReport
+	Build a panel values report
+*/
+void EncodePanelReport(
+	unsigned char	(&report)[kPanelReportLength],
+	const unsigned char reportID,
+	const unsigned long value0,
+	const unsigned long value1
+	)
+{
+unsigned long long bits = (value0 & 0xFFFFF) | static_cast<unsigned long long>(value1 & 0xFFFFF) << 20;
+
+report[0] = reportID;
+for (size_t i = 1; i < kPanelReportLength; i++, bits >>= 8)
+	report[i] = static_cast<unsigned char>(bits);
+}
+
+
+/*	DecodeStateReport
+	Extract the panel state from a state Input report (without checking the report ID)
+	
+	The layout is firmware/State.h; a report in any other layout is refused, since its fields may have moved.
+*/
+PanelState DecodeStateReport(
+	const unsigned char *const report,
+	const size_t	length
+	)
+{
+// too short, or laid out differently?
+if (length < State::kReportLength) throw "state report too short";
+if (report[State::kOffsetLayout] != State::kLayout) throw "unknown state report layout";
+
+// read a little-endian value
+const auto value = [report](size_t offset, unsigned n) {
+	unsigned long v = 0;
+	for (unsigned i = n; i-- > 0;)
+		v = v << 8 | report[offset + i];
+	return v;
+	};
+
+PanelState state;
+state.sequence = static_cast<unsigned short>(value(State::kOffsetSequence, 2));
+state.delta = static_cast<short>(value(State::kOffsetDelta, 2));
+state.time = value(State::kOffsetTime, 4);
+state.keys = value(State::kOffsetKeys, 4);
+
+const unsigned pages = std::min<unsigned>(report[State::kOffsetPages], State::kPagesMaximum);
+for (unsigned page = 0; page < pages; page++)
+	state.pages.emplace_back(
+		value(State::kOffsetValues + page * 8 + 0, 4),
+		value(State::kOffsetValues + page * 8 + 4, 4)
+		);
+
+return state;
+}
+
+
+/*	DecodeCapabilitiesReport
+	Extract what the firmware can do from a capabilities Feature report (without checking the report ID)
+	
+	The layout is firmware/Capabilities.h; later protocol versions only add to it, so any version will do.
+*/
+PanelCapabilities DecodeCapabilitiesReport(
+	const unsigned char *const report,
+	const size_t	length
+	)
+{
+if (length < Capabilities::kReportLength) throw "capabilities report too short";
+
+return {
+	report[Capabilities::kOffsetProtocol],
+	report[Capabilities::kOffsetStateLayout],
+	report[Capabilities::kOffsetPages],
+	report[Capabilities::kOffsetInterval],
+	report[Capabilities::kOffsetCurves],
+	static_cast<unsigned short>(report[Capabilities::kOffsetFeatures] | report[Capabilities::kOffsetFeatures + 1] << 8)
+	};
+}
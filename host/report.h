@@ -0,0 +1,47 @@
+/*
+	report
+	
+	Coders for the panel's Input, Output and Feature reports
+	
+	Portable, so it can be checked away from Windows.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+
+/*	PanelState
+	Everything the panel reports of itself at once
+*/
+struct PanelState {
+	unsigned short	sequence;	// state reports sent since the panel was reset, wrapping
+	short		delta;		// encoder detents turned since the previous state report
+	unsigned long	keys;		// MAX key bits, bank A in the low byte
+	unsigned long	time;		// firmware RTC ticks (32768 per second, 24 bits) when the state last changed
+	std::vector<std::pair<unsigned long, unsigned long>> pages; // active and standby value, per radio page
+	};
+
+
+/*	PanelCapabilities
+	What the panel firmware can do; all zero for firmware that can't say
+*/
+struct PanelCapabilities {
+	unsigned char	protocol,
+			stateLayout,	// layout of the state report, if it has one
+			pages,
+			interval,	// ms between interrupt reports, at least
+			curves;		// encoder acceleration curves
+	unsigned short	features;	// firmware/Capabilities.h Feature bits
+	};
+
+
+constexpr size_t kPanelReportLength = 6;	// panel values report, including the ID
+
+
+extern std::pair<unsigned long, unsigned long> DecodePanelReport(const unsigned char *report, size_t length);
+extern void EncodePanelReport(unsigned char (&report)[kPanelReportLength], unsigned char reportID, unsigned long value0, unsigned long value1);
+extern PanelState DecodeStateReport(const unsigned char *report, size_t length);
+extern PanelCapabilities DecodeCapabilitiesReport(const unsigned char *report, size_t length);
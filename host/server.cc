@@ -0,0 +1,400 @@
+/*
+	server
+
+	Panel server daemon for Linux
+
+	Owns the panel's HID device, through hidraw, and shares it with local clients (see shared.h): every
+	Input report is published to the shared-memory segment, and every request on the socket becomes an
+	Output report.  Runs until interrupted.
+
+	usage: server [hidraw device node]
+*/
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <linux/hidraw.h>
+
+#include <vector>
+
+#include "report.h"
+#include "shared.h"
+
+
+/*	ReportID
+	USB HID report IDs (as in the firmware report descriptor)
+*/
+enum ReportID : unsigned char {
+	kReportPanel = 1,
+	kReportState = 5
+	};
+
+
+static volatile sig_atomic_t gStop;
+
+
+/*	Stop
+	Signal handler: leave the loop
+*/
+static void Stop(
+	int
+	)
+{
+gStop = true;
+}
+
+
+/*	FindDevice
+	Find the panel's hidraw node; return empty if it isn't plugged in
+*/
+static std::string FindDevice()
+{
+static const char gHIDRaw[] = "/sys/class/hidraw";
+
+DIR *const devices = opendir(gHIDRaw);
+if (!devices) return {};
+
+std::string path;
+while (const dirent *const entry = readdir(devices)) {
+	if (entry->d_name[0] == '.') continue;
+
+	// same vendor and product as the HID host looks for
+	if (FILE *const file = fopen((std::string(gHIDRaw) + "/" + entry->d_name + "/device/uevent").c_str(), "r")) {
+		char line[128];
+		bool ours = false;
+		while (!ours && fgets(line, sizeof line, file))
+			ours = strncasecmp(line, "HID_ID=0003:0000F055:00001234", 29) == 0;
+		fclose(file);
+
+		if (ours) {
+			path = std::string("/dev/") + entry->d_name;
+			break;
+			}
+		}
+	}
+
+closedir(devices);
+
+return path;
+}
+
+
+/*	Server
+	Panel server
+*/
+struct Server {
+protected:
+	const std::string fPath;	// device node given on the command line, if any
+	int		fDevice = -1;
+	const int	fListener;
+	std::vector<int> fClients;
+	SharedPanel	*const fShared;
+	SharedState	fState = {};
+
+	static int	Listen();
+	static SharedPanel *Share();
+
+	void		Open();
+	void		Close();
+	void		Publish();
+	void		Read();
+	void		Accept();
+	bool		Serve(int client);
+
+public:
+	explicit	Server(const std::string &path);
+			Server(const Server&) = delete;
+			~Server();
+
+	void		Run();
+	};
+
+
+/*	Listen
+	Create the request socket
+*/
+int Server::Listen()
+{
+const int s = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+if (s < 0) throw errno;
+
+sockaddr_un address = {};
+address.sun_family = AF_UNIX;
+const std::string path = SharedSocketPath();
+if (path.size() >= sizeof address.sun_path) throw "socket path too long";
+path.copy(address.sun_path, path.size());
+
+// left by a server that didn't exit cleanly?
+(void) unlink(path.c_str());
+
+if (bind(s, reinterpret_cast<const sockaddr*>(&address), sizeof address) < 0 || listen(s, 8) < 0) throw errno;
+
+return s;
+}
+
+
+/*	Share
+	Create and map the shared-memory segment
+*/
+SharedPanel *Server::Share()
+{
+const int memory = shm_open(gSharedMemoryName, O_CREAT | O_TRUNC | O_RDWR | O_CLOEXEC, 0644);
+if (memory < 0) throw errno;
+
+if (ftruncate(memory, sizeof(SharedPanel)) < 0) throw errno;
+
+void *const mapped = mmap(nullptr, sizeof(SharedPanel), PROT_READ | PROT_WRITE, MAP_SHARED, memory, 0);
+const int error = errno;
+close(memory);
+if (mapped == MAP_FAILED) throw error;
+
+// fresh (zero) pages are a valid, even sequence
+return static_cast<SharedPanel*>(mapped);
+}
+
+
+/*	Server
+	Set up the segment and the socket; the device is opened when it is found
+*/
+Server::Server(
+	const std::string &path
+	) :
+	fPath(path),
+	fListener(Listen()),
+	fShared(Share())
+{
+fShared->Publish(fState);
+
+// readers check these before trusting the rest
+fShared->fVersion.store(SharedPanel::kVersion);
+fShared->fMagic.store(SharedPanel::kMagic);
+}
+
+
+/*	~Server
+	Withdraw the segment and the socket
+*/
+Server::~Server()
+{
+Close();
+
+for (const int client : fClients)
+	close(client);
+close(fListener);
+(void) unlink(SharedSocketPath().c_str());
+
+(void) munmap(fShared, sizeof(SharedPanel));
+(void) shm_unlink(gSharedMemoryName);
+}
+
+
+/*	Open
+	Open the panel, if it is there, and start from its current state
+*/
+void Server::Open()
+{
+const std::string path = fPath.empty() ? FindDevice() : fPath;
+if (path.empty()) return;
+
+fDevice = open(path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+if (fDevice < 0) return;
+
+fprintf(stderr, "panel opened at %s\n", path.c_str());
+fState.connected = true;
+
+#ifdef HIDIOCGINPUT
+// ask for the state report rather than wait for a change [HID §7.2.1]
+/* Firmware without state reports fails this; it will send its values when they change. */
+unsigned char report[State::kReportLength] = { kReportState };
+if (ioctl(fDevice, HIDIOCGINPUT(sizeof report), report) == sizeof report) {
+	fState.Update(DecodeStateReport(report, sizeof report));
+	fState.delta = 0;
+	}
+#endif
+
+Publish();
+}
+
+
+/*	Close
+	Let go of the panel, after it was unplugged
+*/
+void Server::Close()
+{
+if (fDevice < 0) return;
+
+close(fDevice);
+fDevice = -1;
+
+fState.connected = false;
+Publish();
+}
+
+
+/*	Publish
+	Make the current state visible to clients
+*/
+void Server::Publish()
+{
+fState.updates++;
+fShared->Publish(fState);
+}
+
+
+/*	Read
+	Take in the Input reports the panel sent
+*/
+void Server::Read()
+{
+for (;;) {
+	unsigned char report[State::kReportLength];
+	const ssize_t length = read(fDevice, report, sizeof report);
+
+	if (length < 0) {
+		// unplugged?
+		if (errno != EAGAIN && errno != EINTR) Close();
+		return;
+		}
+
+	try {
+		switch (report[0]) {
+			case kReportPanel: {
+				const auto values = DecodePanelReport(report, length);
+				fState.pages = 1;
+				fState.values[0][0] = values.first;
+				fState.values[0][1] = values.second;
+				}
+				break;
+
+			case kReportState:
+				fState.Update(DecodeStateReport(report, length));
+				break;
+
+			default:
+				continue;
+			}
+		}
+
+	catch (const char *error) {
+		fprintf(stderr, "%s\n", error);
+		continue;
+		}
+
+	Publish();
+	}
+}
+
+
+/*	Accept
+	Take on a new client
+*/
+void Server::Accept()
+{
+const int client = accept4(fListener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+if (client >= 0) fClients.push_back(client);
+}
+
+
+/*	Serve
+	Carry out what a client asked; return false once it has disconnected
+*/
+bool Server::Serve(
+	int		client
+	)
+{
+SharedRequest request;
+const ssize_t length = recv(client, &request, sizeof request, 0);
+
+if (length == 0 || (length < 0 && errno != EAGAIN && errno != EINTR)) return false;
+if (length != sizeof request) return true;
+
+switch (request.command) {
+	case SharedRequest::kSet:
+		// only the first page has an Output report; without the panel the request is dropped
+		if (request.page == 0 && fDevice >= 0) {
+			unsigned char report[kPanelReportLength];
+			EncodePanelReport(report, kReportPanel, request.value, request.valueStandby);
+
+			if (write(fDevice, report, sizeof report) < 0 && errno != EAGAIN) Close();
+			}
+		break;
+	}
+
+return true;
+}
+
+
+/*	Run
+	Serve until interrupted
+*/
+void Server::Run()
+{
+std::vector<pollfd> polled;
+
+while (!gStop) {
+	if (fDevice < 0) Open();
+
+	// listener, device if open, then clients
+	polled.clear();
+	polled.push_back({ fListener, POLLIN, 0 });
+	polled.push_back({ fDevice, POLLIN, 0 });	// ignored while negative
+	for (const int client : fClients)
+		polled.push_back({ client, POLLIN, 0 });
+
+	// look for the panel again every second while it is unplugged
+	if (poll(polled.data(), polled.size(), fDevice < 0 ? 1000 : -1) < 0) {
+		if (errno == EINTR) continue;
+		throw errno;
+		}
+
+	if (polled[1].revents & (POLLIN | POLLERR | POLLHUP)) Read();
+
+	for (size_t i = polled.size(); i-- > 2;)
+		if (polled[i].revents && !Serve(polled[i].fd)) {
+			close(polled[i].fd);
+			fClients.erase(fClients.begin() + (i - 2));
+			}
+
+	if (polled[0].revents & POLLIN) Accept();
+	}
+}
+
+
+/*	main
+	Command line
+*/
+int main(
+	int		argc,
+	const char	*argv[]
+	)
+{
+signal(SIGINT, Stop);
+signal(SIGTERM, Stop);
+signal(SIGPIPE, SIG_IGN);
+
+try {
+	Server(argc > 1 ? argv[1] : "").Run();
+	}
+
+catch (const char *error) {
+	fprintf(stderr, "%s\n", error);
+	return 1;
+	}
+
+catch (int error) {
+	fprintf(stderr, "%s\n", strerror(error));
+	return 1;
+	}
+
+return 0;
+}
@@ -0,0 +1,207 @@
+/*
+	shared
+
+	Panel state shared by the panel server with any number of local clients, on Linux
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "shared.h"
+
+
+/*	gSharedMemoryName
+	POSIX shared-memory object the server publishes in
+*/
+const char gSharedMemoryName[] = "/xplanepanel";
+
+
+/*	SharedSocketPath
+	Where the server listens for requests: the user's runtime directory if there is one
+*/
+std::string SharedSocketPath()
+{
+const char *const directory = getenv("XDG_RUNTIME_DIR");
+
+return std::string(directory && *directory ? directory : "/tmp") + "/xplanepanel.sock";
+}
+
+
+/*	Update
+	Take in what a state report says
+*/
+void SharedState::Update(
+	const PanelState &state
+	)
+{
+sequence = state.sequence;
+delta = state.delta;
+keys = state.keys;
+time = state.time;
+pages = static_cast<uint8_t>(state.pages.size());
+for (unsigned page = 0; page < state.pages.size(); page++) {
+	values[page][0] = state.pages[page].first;
+	values[page][1] = state.pages[page].second;
+	}
+}
+
+
+/*	Publish
+	Make a new snapshot visible to readers
+
+	Only the server calls this, from its one thread.
+*/
+void SharedPanel::Publish(
+	const SharedState &state
+	)
+{
+const uint32_t sequence = fSequence.load(std::memory_order_relaxed);
+
+// odd: readers must retry
+fSequence.store(sequence + 1, std::memory_order_relaxed);
+std::atomic_thread_fence(std::memory_order_release);
+
+fUpdates.store(state.updates, std::memory_order_relaxed);
+fConnected.store(state.connected, std::memory_order_relaxed);
+fReportSequence.store(state.sequence, std::memory_order_relaxed);
+fDelta.store(static_cast<uint16_t>(state.delta), std::memory_order_relaxed);
+fKeys.store(state.keys, std::memory_order_relaxed);
+fTime.store(state.time, std::memory_order_relaxed);
+fPages.store(state.pages, std::memory_order_relaxed);
+for (unsigned page = 0; page < State::kPagesMaximum; page++)
+	for (unsigned i = 0; i < 2; i++)
+		fValues[page][i].store(state.values[page][i], std::memory_order_relaxed);
+
+// even again: the snapshot is complete
+fSequence.store(sequence + 2, std::memory_order_release);
+}
+
+
+/*	Read
+	Copy a consistent snapshot
+
+	Lock-free: retries only while the server is in the middle of publishing, which takes nanoseconds.
+*/
+SharedState SharedPanel::Read() const
+{
+SharedState state;
+
+for (;;) {
+	const uint32_t before = fSequence.load(std::memory_order_acquire);
+
+	if (!(before & 1)) {
+		state.updates = fUpdates.load(std::memory_order_relaxed);
+		state.connected = fConnected.load(std::memory_order_relaxed);
+		state.sequence = static_cast<uint16_t>(fReportSequence.load(std::memory_order_relaxed));
+		state.delta = static_cast<int16_t>(fDelta.load(std::memory_order_relaxed));
+		state.keys = fKeys.load(std::memory_order_relaxed);
+		state.time = fTime.load(std::memory_order_relaxed);
+		state.pages = static_cast<uint8_t>(fPages.load(std::memory_order_relaxed));
+		for (unsigned page = 0; page < State::kPagesMaximum; page++)
+			for (unsigned i = 0; i < 2; i++)
+				state.values[page][i] = fValues[page][i].load(std::memory_order_relaxed);
+
+		// unchanged while we copied?
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (fSequence.load(std::memory_order_relaxed) == before) break;
+		}
+	}
+
+return state;
+}
+
+
+/*	SharedPanelReader
+	Map the server's segment, read-only
+*/
+SharedPanelReader::SharedPanelReader()
+{
+const int memory = shm_open(gSharedMemoryName, O_RDONLY | O_CLOEXEC, 0);
+if (memory < 0) throw errno;
+
+void *const mapped = mmap(nullptr, sizeof(SharedPanel), PROT_READ, MAP_SHARED, memory, 0);
+const int error = errno;
+close(memory);
+if (mapped == MAP_FAILED) throw error;
+
+fPanel = static_cast<const SharedPanel*>(mapped);
+
+// published by a server that lays it out the same way?
+if (fPanel->fMagic.load() != SharedPanel::kMagic || fPanel->fVersion.load() != SharedPanel::kVersion) {
+	(void) munmap(mapped, sizeof(SharedPanel));
+	throw "panel server publishes a different layout";
+	}
+}
+
+
+/*	~SharedPanelReader
+	Unmap the segment
+*/
+SharedPanelReader::~SharedPanelReader()
+{
+(void) munmap(const_cast<SharedPanel*>(fPanel), sizeof(SharedPanel));
+}
+
+
+/*	Connect
+	Connect to the server's socket
+*/
+int SharedPanelWriter::Connect()
+{
+const int s = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+if (s < 0) throw errno;
+
+sockaddr_un address = {};
+address.sun_family = AF_UNIX;
+const std::string path = SharedSocketPath();
+if (path.size() >= sizeof address.sun_path) {
+	close(s);
+	throw "socket path too long";
+	}
+path.copy(address.sun_path, path.size());
+
+if (connect(s, reinterpret_cast<const sockaddr*>(&address), sizeof address) < 0) {
+	const int error = errno;
+	close(s);
+	throw error;
+	}
+
+return s;
+}
+
+
+/*	SharedPanelWriter
+	Connect to the server
+*/
+SharedPanelWriter::SharedPanelWriter() :
+	fSocket(Connect())
+{
+}
+
+
+/*	~SharedPanelWriter
+	Disconnect
+*/
+SharedPanelWriter::~SharedPanelWriter()
+{
+close(fSocket);
+}
+
+
+/*	Set
+	Ask for the panel to show these values
+*/
+void SharedPanelWriter::Set(
+	unsigned	value,
+	unsigned	valueStandby
+	)
+{
+const SharedRequest request = { SharedRequest::kSet, 0 /* page */, {}, value, valueStandby };
+
+if (send(fSocket, &request, sizeof request, MSG_NOSIGNAL) != sizeof request) throw errno;
+}
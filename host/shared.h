@@ -0,0 +1,121 @@
+/*
+	shared
+
+	Panel state shared by the panel server with any number of local clients, on Linux
+
+	Only one process can own the panel's HID device.  The server (server.cc) owns it, and publishes the
+	latest panel state in a shared-memory segment under a sequence lock: clients map the segment and read it
+	without locking or system calls, and without ever holding up the server.  What clients want changed goes
+	the other way, as fixed-size requests on a Unix socket.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "../firmware/State.h"
+#include "report.h"
+
+
+/*	SharedState
+	One consistent snapshot of the panel
+*/
+struct SharedState {
+	uint32_t	updates;	// publications since the server started; unchanged means nothing new
+	bool		connected;	// server has the panel open
+	uint16_t	sequence;	// panel's state report sequence
+	int16_t		delta;		// encoder detents in the last state report
+	uint32_t	keys;		// MAX key bits, bank A in the low byte
+	uint32_t	time;		// firmware RTC ticks when the state last changed
+	uint8_t		pages;
+	uint32_t	values[State::kPagesMaximum][2]; // active and standby value, per radio page
+
+	void		Update(const PanelState&);
+	};
+
+
+/*	SharedPanel
+	Layout of the shared-memory segment
+
+	Every field is written only by the server.  fSequence is odd while it is writing; a reader that sees it
+	odd, or changed by the time it has copied the fields, copies them again.  The fields themselves are
+	atomic only so the racing copy is defined; relaxed order is enough between the fences.
+*/
+struct SharedPanel {
+	static constexpr uint32_t kMagic = 0x53505058;	// 'XPPS'
+	static constexpr uint32_t kVersion = 1;	// changes whenever the layout does
+
+	std::atomic<uint32_t> fMagic,
+			fVersion,
+			fSequence,
+			fUpdates,
+			fConnected,
+			fReportSequence,
+			fDelta,
+			fKeys,
+			fTime,
+			fPages,
+			fValues[State::kPagesMaximum][2];
+
+	void		Publish(const SharedState&);
+	SharedState	Read() const;
+	};
+
+
+/*	SharedRequest
+	What a client asks of the server, on the socket
+*/
+#pragma pack(push, 1)
+struct SharedRequest {
+	enum Command : uint8_t {
+		kSet = 1		// show these values on the panel
+		};
+
+	uint8_t		command;
+	uint8_t		page;		// radio page; the panel's output report only has the first
+	uint8_t		unused[2];
+	uint32_t	value,
+			valueStandby;
+	};
+#pragma pack(pop)
+static_assert(sizeof(SharedRequest) == 12);
+
+
+extern const char gSharedMemoryName[];
+extern std::string SharedSocketPath();
+
+
+/*	SharedPanelReader
+	Client view of the server's segment
+*/
+struct SharedPanelReader {
+protected:
+	const SharedPanel *fPanel;
+
+public:
+			SharedPanelReader();
+			SharedPanelReader(const SharedPanelReader&) = delete;
+			~SharedPanelReader();
+
+	SharedState	Read() const { return fPanel->Read(); }
+	};
+
+
+/*	SharedPanelWriter
+	Client connection for sending requests to the server
+*/
+struct SharedPanelWriter {
+protected:
+	const int	fSocket;
+
+	static int	Connect();
+
+public:
+			SharedPanelWriter();
+			SharedPanelWriter(const SharedPanelWriter&) = delete;
+			~SharedPanelWriter();
+
+	void		Set(unsigned value, unsigned valueStandby);
+	};
@@ -0,0 +1,52 @@
+/*
+	telemetry
+	
+	How the plugin's connection to the panel is doing
+*/
+
+#include "telemetry.h"
+
+
+/*	Update
+	Take in the connection's running counts, after the given seconds
+	
+	The counts only ever grow, as long as the connection stays the same; roundTripTotal is in microseconds.
+	Only the bridge times round trips; the round trip keeps its last value through a window without any.
+*/
+void Telemetry::Update(
+	Connection	connected,
+	unsigned long	reportsRead,
+	unsigned long	dropped,
+	unsigned long	roundTrips,
+	unsigned long long roundTripTotal,
+	float		elapsed
+	)
+{
+// connection changed: start counting again, from now
+if (connected != connection.load(std::memory_order_relaxed)) {
+	connection.store(connected, std::memory_order_relaxed);
+	reportRate.store(0, std::memory_order_relaxed);
+	roundTrip.store(0, std::memory_order_relaxed);
+	fElapsed = 0;
+	fReports = reportsRead;
+	fRoundTrips = roundTrips;
+	fRoundTripTotal = roundTripTotal;
+	}
+else
+	fElapsed += elapsed;
+
+reports.store(static_cast<int>(reportsRead), std::memory_order_relaxed);
+stale.store(static_cast<int>(dropped), std::memory_order_relaxed);
+
+// rates over the window
+if (fElapsed >= kWindow) {
+	reportRate.store((reportsRead - fReports) / fElapsed, std::memory_order_relaxed);
+	if (const unsigned long n = roundTrips - fRoundTrips; n > 0)
+		roundTrip.store((roundTripTotal - fRoundTripTotal) / 1000.f / n, std::memory_order_relaxed);
+	
+	fElapsed = 0;
+	fReports = reportsRead;
+	fRoundTrips = roundTrips;
+	fRoundTripTotal = roundTripTotal;
+	}
+}
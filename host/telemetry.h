@@ -0,0 +1,44 @@
+/*
+	telemetry
+	
+	How the plugin's connection to the panel is doing, published as datarefs for other plugins
+	
+	Portable, so it can be checked away from Windows.
+*/
+
+#pragma once
+
+#include <atomic>
+
+
+/*	Telemetry
+	Statistics block; written only by the panel I/O in the flight loop, read by dataref accessors
+	
+	Each field is atomic on its own; readers only ever want one at a time, so there's no lock.
+*/
+struct Telemetry {
+	enum Connection : int {
+		kNone,
+		kUSB,			// panel plugged in here
+		kBridge,		// panel on another machine (remote.h)
+		kSearching		// neither yet; looking for the panel
+		};
+	
+	std::atomic<int> connection{kNone},
+			reports{0},		// panel reports (or bridge datagrams) taken in
+			stale{0};		// bridge datagrams dropped for arriving late
+	std::atomic<float> reportRate{0},	// reports per second, over the last second or so
+			roundTrip{0};		// bridge milliseconds from a set to its echo, mean over the same
+	
+protected:
+	static constexpr float kWindow = 1;	// seconds between updates of the rates
+	
+	float		fElapsed = 0;
+	unsigned long	fReports = 0,		// at the start of the window
+			fRoundTrips = 0;
+	unsigned long long fRoundTripTotal = 0;
+
+public:
+	void		Update(Connection, unsigned long reports, unsigned long stale, unsigned long roundTrips,
+				unsigned long long roundTripTotal, float elapsed);
+	};
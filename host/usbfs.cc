@@ -0,0 +1,173 @@
+/*
+	usbfs
+	
+	Reader for the panel's diagnostics interface on Linux
+*/
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include <linux/usbdevice_fs.h>
+
+#include "../firmware/Diagnostics.h"
+#include "usbfs.h"
+
+
+/*	ReadAttribute
+	Read a sysfs attribute of a USB device; return empty if it doesn't have it
+*/
+static std::string ReadAttribute(
+	const std::string &device,
+	const char	*const attribute
+	)
+{
+std::string value;
+
+if (FILE *const file = fopen((device + "/" + attribute).c_str(), "r")) {
+	char line[64];
+	if (fgets(line, sizeof line, file)) {
+		value = line;
+		
+		// drop the newline
+		while (!value.empty() && (value.back() == '\n' || value.back() == '\r')) value.pop_back();
+		}
+	
+	fclose(file);
+	}
+
+return value;
+}
+
+
+/*	FindDevice
+	Find the panel; return the path of its usbfs device node
+*/
+std::string DiagnosticsReader::FindDevice()
+{
+static const char gDevices[] = "/sys/bus/usb/devices";
+
+DIR *const devices = opendir(gDevices);
+if (!devices) throw errno;
+
+std::string path;
+while (const dirent *const entry = readdir(devices)) {
+	const std::string device = std::string(gDevices) + "/" + entry->d_name;
+	
+	// same vendor and product as the HID host looks for
+	if (ReadAttribute(device, "idVendor") == "f055" && ReadAttribute(device, "idProduct") == "1234") {
+		char node[32];
+		snprintf(node, sizeof node, "/dev/bus/usb/%03u/%03u",
+			static_cast<unsigned>(std::stoul(ReadAttribute(device, "busnum"))),
+			static_cast<unsigned>(std::stoul(ReadAttribute(device, "devnum"))));
+		path = node;
+		break;
+		}
+	}
+
+closedir(devices);
+
+// didn't find our device?
+if (path.empty()) throw "can't find panel device";
+
+return path;
+}
+
+
+/*	OpenDevice
+	Open the device node and claim the diagnostics interface
+*/
+int DiagnosticsReader::OpenDevice(
+	const std::string &path
+	)
+{
+const int device = open(path.c_str(), O_RDWR | O_CLOEXEC);
+if (device < 0) throw errno;
+
+// vendor interface has no kernel driver to detach
+unsigned interface = Diagnostics::kInterface;
+if (ioctl(device, USBDEVFS_CLAIMINTERFACE, &interface) < 0) {
+	const int error = errno;
+	close(device);
+	throw error;
+	}
+
+return device;
+}
+
+
+/*	DiagnosticsReader
+	Connect to the panel's diagnostics interface
+*/
+DiagnosticsReader::DiagnosticsReader(
+	const std::string &path
+	) :
+	fDevice(OpenDevice(path))
+{
+}
+
+
+/*	~DiagnosticsReader
+	Release the interface
+*/
+DiagnosticsReader::~DiagnosticsReader()
+{
+unsigned interface = Diagnostics::kInterface;
+(void) ioctl(fDevice, USBDEVFS_RELEASEINTERFACE, &interface);
+close(fDevice);
+}
+
+
+/*	Request
+	Send a command and return the complete response
+*/
+std::vector<unsigned char> DiagnosticsReader::Request(
+	unsigned char	command
+	)
+{
+static const unsigned kTimeout = 1000 /* ms */;
+
+// send the command
+usbdevfs_bulktransfer out = { Diagnostics::kEndpoint /* OUT */, sizeof command, kTimeout, &command };
+if (ioctl(fDevice, USBDEVFS_BULK, &out) < 0) throw errno;
+
+// collect the response
+/* The kernel keeps reading packets until the device ends the response with a short one. */
+std::vector<unsigned char> response(Diagnostics::kResponseLength);
+usbdevfs_bulktransfer in = { 0x80 | Diagnostics::kEndpoint /* IN */, static_cast<unsigned>(response.size()), kTimeout, response.data() };
+const int received = ioctl(fDevice, USBDEVFS_BULK, &in);
+if (received < 0) throw errno;
+
+response.resize(received);
+if (response.size() < Diagnostics::kHeaderLength || response[0] != command) throw "unexpected diagnostics response";
+
+return response;
+}
+
+
+/*	Log
+	Collect the records the firmware logged since the last call; also returns its count of dropped records
+*/
+std::vector<LogRecord> DiagnosticsReader::Log(
+	unsigned	&dropped
+	)
+{
+const std::vector<unsigned char> response = Request(Diagnostics::kLog);
+
+// header has the same layout as the log Feature report
+return DecodeLogReport(response.data(), response.size(), dropped);
+}
+
+
+/*	Profile
+	Get the firmware's cycle counts, per probe
+*/
+std::vector<ProbeStatistics> DiagnosticsReader::Profile()
+{
+const std::vector<unsigned char> response = Request(Diagnostics::kProfile);
+
+return DecodeProfile(response.data() + Diagnostics::kHeaderLength, response.size() - Diagnostics::kHeaderLength);
+}
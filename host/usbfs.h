@@ -0,0 +1,37 @@
+/*
+	usbfs
+	
+	Reader for the panel's diagnostics interface on Linux
+	
+	Talks to the kernel's usbfs directly; doesn't need libusb.
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "log.h"
+#include "profile.h"
+
+
+/*	DiagnosticsReader
+	Connection to the panel's vendor bulk interface
+*/
+struct DiagnosticsReader {
+protected:
+	const int	fDevice;	// usbfs device node
+	
+	static std::string FindDevice();
+	static int	OpenDevice(const std::string &path);
+	
+	std::vector<unsigned char> Request(unsigned char command);
+
+public:
+	explicit	DiagnosticsReader(const std::string &path = FindDevice());
+			DiagnosticsReader(const DiagnosticsReader&) = delete;
+			~DiagnosticsReader();
+	
+	std::vector<LogRecord> Log(unsigned &dropped);
+	std::vector<ProbeStatistics> Profile();
+	};
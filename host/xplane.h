@@ -11,6 +11,9 @@
 #include <XPLMGraphics.h>
 #include <XPLMProcessing.h>
 
+#include <atomic>
+#include <type_traits>
+
 #if IBM
 	#include <windows.h>
 #endif
@@ -37,6 +40,10 @@ template <typename Behavior>
 struct XPlaneWindow {
 protected:
 	static XPLMCreateWindow_t CreateParams(XPlaneWindow<Behavior> *that);
+	static XPLMWindowID Create(XPlaneWindow<Behavior> *const that) {
+				XPLMCreateWindow_t params = CreateParams(that);
+				return XPLMCreateWindowEx(&params);
+				}
 	
 	static void	DrawHandler(XPLMWindowID windowID, void *const refCon) {
 				static_cast<Behavior*>(refCon)->Draw(windowID);
@@ -58,7 +65,7 @@ protected:
 
 public:
 			XPlaneWindow() :
-				fID(XPLMCreateWindowEx(&CreateParams(this)))
+				fID(Create(this))
 				{}
 			~XPlaneWindow() { XPLMDestroyWindow(fID); }
 
@@ -147,6 +154,13 @@ protected:
 
 				return params;
 				}
+	static XPLMFlightLoopID Create(
+				XPlaneFlightLoop<Behavior> *const that,
+				XPLMFlightLoopPhaseType phase
+				) {
+				XPLMCreateFlightLoop_t params = CreateParams(that, phase);
+				return XPLMCreateFlightLoop(&params);
+				}
 
 	static float	Callback(
 				float elapsedSinceLastCall,
@@ -163,7 +177,7 @@ public:
 			XPlaneFlightLoop(
 				XPLMFlightLoopPhaseType phase
 				) :
-				fID(XPLMCreateFlightLoop(&CreateParams(this, phase)))
+				fID(Create(this, phase))
 				{}
 
 			~XPlaneFlightLoop() {
@@ -179,3 +193,54 @@ public:
 				}
 	};
 
+
+
+/*
+
+	XPlaneDataRef
+
+	Read-only dataref published by the plugin, backed by an atomic the plugin updates
+
+	X-Plane calls the accessor whenever another plugin reads the dataref; it only loads the atomic, so it
+	never waits on whoever is updating it.
+
+*/
+
+template <typename T>
+struct XPlaneDataRef {
+	static_assert(std::is_same_v<T, int> || std::is_same_v<T, float>, "X-Plane datarefs are int or float");
+
+protected:
+	static T	Read(void *const refCon) {
+				return static_cast<const std::atomic<T>*>(refCon)->load(std::memory_order_relaxed);
+				}
+	static XPLMGetDatai_f ReadInt() {
+				if constexpr (std::is_same_v<T, int>) return &Read; else return nullptr;
+				}
+	static XPLMGetDataf_f ReadFloat() {
+				if constexpr (std::is_same_v<T, float>) return &Read; else return nullptr;
+				}
+
+	const XPLMDataRef fID;
+
+public:
+			XPlaneDataRef(
+				const char	name[],
+				const std::atomic<T> &value
+				) :
+				fID(XPLMRegisterDataAccessor(
+					name,
+					std::is_same_v<T, int> ? xplmType_Int : xplmType_Float,
+					0, // not writable
+					ReadInt(), nullptr,
+					ReadFloat(), nullptr,
+					nullptr, nullptr,
+					nullptr, nullptr,
+					nullptr, nullptr,
+					nullptr, nullptr,
+					const_cast<std::atomic<T>*>(&value), nullptr
+					))
+				{}
+			XPlaneDataRef(const XPlaneDataRef&) = delete;
+			~XPlaneDataRef() { XPLMUnregisterDataRef(fID); }
+	};
@@ -0,0 +1,146 @@
+/*
+	acceleration
+	
+	Encoder acceleration (firmware/Acceleration.cc) on synthetic detent timing traces
+	
+	Each trace is detents reported at steady intervals of RTC ticks.  The multiplier must stay at 1 for slow
+	turning, climb through the curve's steps as the knob speeds up without jumping on a single flick, drop
+	back after a rest, and never fall while the rate holds.
+*/
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+#include "Acceleration.h"
+#include "RTC.h"
+#include "check.h"
+
+
+/*	Trace
+	Report 'detents' detents every 'interval' ticks, 'count' times, from 'start'; return the multipliers
+*/
+static std::vector<unsigned> Trace(
+	Acceleration	&acceleration,
+	uint32_t	&time,
+	uint32_t	interval,
+	signed		detents,
+	unsigned	count
+	)
+{
+std::vector<unsigned> multipliers;
+for (unsigned i = 0; i < count; i++) {
+	time = (time + interval) & RTC::kMask;
+	multipliers.push_back(acceleration(detents, time));
+	}
+
+return multipliers;
+}
+
+
+/*	Nondecreasing
+	Whether the multipliers never fall
+*/
+static bool Nondecreasing(
+	const std::vector<unsigned> &multipliers
+	)
+{
+for (size_t i = 1; i < multipliers.size(); i++)
+	if (multipliers[i] < multipliers[i - 1]) return false;
+
+return true;
+}
+
+
+/*	Reports
+	Reports to cross the airband (760 channels of 25 kHz) turning one detent every 'interval' ticks
+*/
+static unsigned Reports(
+	uint8_t		curve,
+	uint32_t	interval
+	)
+{
+Acceleration acceleration;
+acceleration.Select(curve);
+
+uint32_t time = 0;
+unsigned reports = 0;
+for (unsigned channels = 0; channels < 760; reports++) {
+	time += interval;
+	channels += acceleration(1, time);
+	}
+
+return reports;
+}
+
+
+/*	main
+
+*/
+int main()
+{
+constexpr uint32_t kSecond = RTC::kFrequency;
+
+// curves
+Acceleration acceleration;
+CHECK(acceleration.Selected() == 1);
+CHECK(!acceleration.Select(Acceleration::kCurves.size()));
+CHECK(acceleration.Selected() == 1);
+
+// slow turning, 5 detents a second, isn't accelerated
+uint32_t time = 0;
+std::vector<unsigned> multipliers = Trace(acceleration, time, kSecond / 5, 1, 50);
+CHECK(std::all_of(multipliers.begin(), multipliers.end(), [](unsigned m) { return m == 1; }));
+
+// fast turning, 100 detents a second, climbs through every step to the top, and stays there
+multipliers = Trace(acceleration, time, kSecond / 100, 1, 50);
+CHECK(Nondecreasing(multipliers));
+CHECK(multipliers.front() < 8);
+CHECK(multipliers.back() == Acceleration::kCurves[1].back().multiplier);
+
+// ... and turning up to it from a standstill passes every step on the way
+Acceleration ramp;
+uint32_t rampTime = 0;
+const std::vector<unsigned> ramped = Trace(ramp, rampTime, kSecond / 60, 1, 20);
+CHECK(Nondecreasing(ramped));
+for (unsigned step = 1; step < Acceleration::kSteps; step++)
+	CHECK(std::find(ramped.begin(), ramped.end(), Acceleration::kCurves[1][step].multiplier) != ramped.end());
+
+// several detents in one report count as that many
+Acceleration several;
+uint32_t severalTime = 0;
+CHECK(Trace(several, severalTime, kSecond / 25, 4, 30).back() == 8);
+
+// turning either way is the same
+Acceleration reverse;
+uint32_t reverseTime = 0;
+CHECK(Trace(reverse, reverseTime, kSecond / 100, -1, 50) == multipliers);
+
+// a rest starts over, even across the wrap of the 24-bit counter
+time = RTC::kMask - kSecond / 10;
+CHECK(acceleration(1, time) == 1);
+multipliers = Trace(acceleration, time, kSecond / 100, 1, 50);
+CHECK(time < kSecond);
+CHECK(Nondecreasing(multipliers) && multipliers.back() == 8);
+
+// a single quick detent from rest doesn't jump to the top, as a steady rate that fast would
+Acceleration flick;
+uint32_t flickTime = 0;
+CHECK(flick(1, flickTime += kSecond) == 1);
+CHECK(flick(1, flickTime += kSecond / 100) < Acceleration::kCurves[1].back().multiplier);
+
+// curve 0 is off
+Acceleration off;
+off.Select(0);
+uint32_t offTime = 0;
+multipliers = Trace(off, offTime, kSecond / 200, 3, 50);
+CHECK(std::all_of(multipliers.begin(), multipliers.end(), [](unsigned m) { return m == 1; }));
+
+// crossing the band
+const unsigned reportsOff = Reports(0, kSecond / 50), reportsModerate = Reports(1, kSecond / 50), reportsAggressive = Reports(2, kSecond / 50);
+printf("reports to cross the band at 50 detents/s: off %u, moderate %u, aggressive %u\n", reportsOff, reportsModerate, reportsAggressive);
+CHECK(reportsModerate * 4 < reportsOff);
+CHECK(reportsAggressive < reportsModerate);
+
+return Checked("acceleration");
+}
@@ -0,0 +1,283 @@
+/*
+	bridge
+
+	The UDP bridge's datagram coder (host/bridge.cc), and the plugin's end of it (host/remote.cc) over
+	loopback, with a local stand-in for the forwarder
+
+	Reports the rate the plugin takes in state datagrams at, and the round trip, as the plugin times it from
+	the forwarder's echo and as the test sees it.
+*/
+
+#include <thread>
+
+#include "forwarder.h"
+
+
+/*	Throws
+	Whether decoding the datagram is refused
+*/
+static bool Throws(
+	const unsigned char *datagram,
+	size_t		length
+	)
+{
+try {
+	(void) DecodeBridgeDatagram(datagram, length);
+	}
+
+catch (const char*) {
+	return true;
+	}
+
+return false;
+}
+
+
+/*	Coder
+	Datagrams come back as they went, and anything cut short or foreign is refused
+*/
+static void Coder()
+{
+BridgeDatagram datagram = { BridgeDatagram::kState, 0xfffffffe, 0x12345678, 0x9abcdef0, {} };
+for (uint8_t index = 0; index < 3; index++) {
+	BridgePanel panel = { index, index != 1, static_cast<uint16_t>(0xfff0 + index), 0x80000001u << index, static_cast<int16_t>(-300 + index),
+		0x00abcdef, static_cast<uint8_t>(index == 2 ? State::kPagesMaximum : index), {} };
+	for (unsigned page = 0; page < panel.pages; page++)
+		for (unsigned i = 0; i < 2; i++)
+			panel.values[page][i] = 0xfffff - 1000 * page - i;
+	datagram.panels.push_back(panel);
+	}
+
+unsigned char buffer[kBridgeDatagramMaximum];
+const size_t length = EncodeBridgeDatagram(datagram, buffer, sizeof buffer);
+CHECK(length == 17 + 3 * 15 + (0 + 1 + State::kPagesMaximum) * 6);
+
+const BridgeDatagram decoded = DecodeBridgeDatagram(buffer, length);
+CHECK(decoded.kind == datagram.kind && decoded.sequence == datagram.sequence && decoded.sent == datagram.sent);
+CHECK(decoded.echo == datagram.echo);
+CHECK(decoded.panels.size() == datagram.panels.size());
+for (size_t n = 0; n < decoded.panels.size() && n < datagram.panels.size(); n++) {
+	const BridgePanel &a = decoded.panels[n], &b = datagram.panels[n];
+	CHECK(a.index == b.index && a.connected == b.connected && a.change == b.change && a.keys == b.keys);
+	CHECK(a.delta == b.delta && a.time == b.time && a.pages == b.pages);
+	for (unsigned page = 0; page < a.pages; page++)
+		CHECK(a.values[page][0] == b.values[page][0] && a.values[page][1] == b.values[page][1]);
+	}
+
+// cut short anywhere
+bool refused = true;
+for (size_t cut = 0; cut < length; cut++)
+	refused &= Throws(buffer, cut);
+CHECK(refused);
+
+// another protocol, or another version of this one
+unsigned char foreign[kBridgeDatagramMaximum];
+std::copy(buffer, buffer + length, foreign);
+foreign[0] ^= 1;
+CHECK(Throws(foreign, length));
+std::copy(buffer, buffer + length, foreign);
+foreign[2]++;
+CHECK(Throws(foreign, length));
+
+// more pages than a panel has
+std::copy(buffer, buffer + length, foreign);
+foreign[17 + 15 + 15 + 6 + 4] = State::kPagesMaximum + 1;
+CHECK(Throws(foreign, length));
+
+// more than fits
+datagram.panels.resize(12, datagram.panels[2]);
+bool tooMany = false;
+try {
+	(void) EncodeBridgeDatagram(datagram, buffer, sizeof buffer);
+	}
+
+catch (const char*) {
+	tooMany = true;
+	}
+CHECK(tooMany);
+
+// sequence numbers wrap
+CHECK(BridgeNewer(1, 0) && BridgeNewer(0, 0xffffffff) && BridgeNewer(5, 0xfffffff0));
+CHECK(!BridgeNewer(5, 5) && !BridgeNewer(0, 1) && !BridgeNewer(0xfffffff0, 5));
+}
+
+
+/*	FlightLoop
+	The plugin's end as its flight loop drives it
+
+	The radio's values are handed to the panel every time round; when the panel says it changed them, they
+	are taken back into the radio.
+*/
+struct FlightLoop {
+	RemotePanel	fRemote;
+	unsigned	fValue0 = 0,
+			fValue1 = 0;
+
+	explicit	FlightLoop(unsigned short port) : fRemote(port) {}
+
+	bool		Run();
+	bool		Tune(unsigned value0, unsigned value1);
+	void		Take(unsigned long datagrams);
+	unsigned long	Arrived() const;
+	};
+
+
+/*	Run
+	Once round the loop; return whether the panel changed the radio
+*/
+bool FlightLoop::Run()
+{
+const bool changed = fRemote.Set(fValue0, fValue1);
+if (changed) {
+	fValue0 = fRemote.Value0();
+	fValue1 = fRemote.Value1();
+	}
+
+return changed;
+}
+
+
+/*	Tune
+	Change the radio in X-Plane, and go round the loop
+*/
+bool FlightLoop::Tune(
+	unsigned	value0,
+	unsigned	value1
+	)
+{
+fValue0 = value0;
+fValue1 = value1;
+
+return Run();
+}
+
+
+/*	Arrived
+	State datagrams the plugin has taken in, kept or not
+*/
+unsigned long FlightLoop::Arrived() const
+{
+const BridgeStatistics &statistics = fRemote.Statistics();
+
+return statistics.datagrams + statistics.stale + statistics.foreign;
+}
+
+
+/*	Take
+	Go round the loop until the plugin has taken in 'datagrams' in all
+*/
+void FlightLoop::Take(
+	unsigned long	datagrams
+	)
+{
+for (unsigned tries = 0; Arrived() < datagrams && tries < 100000; tries++)
+	(void) Run();
+}
+
+
+/*	Loopback
+	The plugin and a stand-in forwarder on this machine
+*/
+static void Loopback()
+{
+FlightLoop plugin(kPort);
+const RemotePanel &remote = plugin.fRemote;
+Forwarder forwarder;
+
+// the first state datagram says where the forwarder is
+forwarder.Send(118000, 136975);
+plugin.Take(1);
+CHECK(remote.Connected() && plugin.fValue0 == 118000 && plugin.fValue1 == 136975);
+
+// ... so values can be sent back, once
+CHECK(!plugin.Tune(121500, 136975));
+std::optional<BridgeDatagram> set = forwarder.Receive(1000);
+CHECK(set && set->kind == BridgeDatagram::kSet && set->panels.size() == 1 && set->panels[0].values[0][0] == 121500);
+CHECK(!plugin.Run() && !forwarder.Receive(10));
+
+// a datagram overtaken by a newer one is dropped; the first echoes the set, which times its round trip once
+forwarder.Send(121500, 136975, false);
+forwarder.Send(122000, 136975, true, forwarder.fSequence - 1);
+plugin.Take(3);
+CHECK(remote.Statistics().stale == 1 && plugin.fValue0 == 121500 && !forwarder.Receive(10));
+CHECK(remote.Statistics().roundTrips == 1 && remote.Statistics().roundTripMaximum > 0);
+forwarder.Send(121500, 136975, false);
+plugin.Take(4);
+CHECK(remote.Statistics().roundTrips == 1);
+
+// another sender is ignored while the forwarder is talking, and nothing goes to it
+{
+Forwarder intruder;
+intruder.Send(1000, 2000, true, forwarder.fSequence + 10);
+plugin.Take(5);
+CHECK(remote.Statistics().foreign == 1 && plugin.fValue0 == 121500);
+CHECK(!plugin.Tune(122500, 136975));
+CHECK(!intruder.Receive(10));
+set = forwarder.Receive(1000);
+CHECK(set && set->panels[0].values[0][0] == 122500);
+}
+
+// rate of state datagrams, taken in as they come
+static constexpr unsigned kDatagrams = 20000;
+const BridgeStatistics before = remote.Statistics();
+const unsigned long arrived = plugin.Arrived();
+const uint32_t start = BridgeClock();
+for (unsigned n = 0; n < kDatagrams; n++) {
+	forwarder.Send(122500 + 25 * (n % 100), 136975);
+	if (n % 16 == 15) plugin.Take(arrived + n + 1);
+	}
+plugin.Take(arrived + kDatagrams);
+const double seconds = (BridgeClock() - start) / 1e6;
+const BridgeStatistics after = remote.Statistics();
+const unsigned long received = after.datagrams - before.datagrams;
+CHECK(received == kDatagrams && after.stale == before.stale);
+CHECK(plugin.fValue0 == 122500 + 25 * ((kDatagrams - 1) % 100) && !forwarder.Receive(10));
+
+// round trip: the panel turned, and the radio tuned in X-Plane in response; each state echoes the last set
+static constexpr unsigned kRoundTrips = 1000;
+const BridgeStatistics timed = remote.Statistics();
+unsigned long long roundTrip = 0;
+unsigned answered = 0;
+for (unsigned n = 0; n < kRoundTrips; n++) {
+	const uint32_t sent = BridgeClock();
+	forwarder.Send(118000 + 25 * (n % 2), 136975);
+	plugin.Take(plugin.Arrived() + 1);
+
+	(void) plugin.Tune(plugin.fValue0 + 1000, 136975);
+	set = forwarder.Receive(1000);
+	if (set && set->panels[0].values[0][0] == plugin.fValue0) {
+		answered++;
+		roundTrip += BridgeClock() - sent;
+		}
+	}
+CHECK(answered == kRoundTrips);
+const unsigned long roundTrips = remote.Statistics().roundTrips - timed.roundTrips;
+CHECK(roundTrips == kRoundTrips - 1 /* the last set isn't echoed */);
+
+printf("%.0f state datagrams/s; round trip %.1f us as the plugin times it, %.1f us panel to radio and back\n",
+	received / seconds, roundTrips ? static_cast<double>(remote.Statistics().roundTripTotal - timed.roundTripTotal) / roundTrips : 0.0,
+	answered ? static_cast<double>(roundTrip) / answered : 0.0);
+
+// a forwarder that has gone quiet is replaced by the next that speaks, as a restarted one on a new port
+std::this_thread::sleep_for(std::chrono::microseconds(kBridgeSilence + 100000));
+Forwarder restarted;
+restarted.Send(119000, 136975);
+plugin.Take(plugin.Arrived() + 1);
+CHECK(plugin.fValue0 == 119000);
+CHECK(!plugin.Tune(119025, 136975));
+set = restarted.Receive(1000);
+CHECK(set && set->panels[0].values[0][0] == 119025);
+CHECK(!forwarder.Receive(10));
+}
+
+
+/*	main
+	Check the coder, then the plugin's end over loopback
+*/
+int main()
+{
+Coder();
+Loopback();
+
+return Checked("bridge");
+}
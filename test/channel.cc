@@ -0,0 +1,110 @@
+/*
+	channel
+
+	Turning the knobs through each band (firmware/Channel.h), against the radio's rules worked in kHz
+
+	Every channel of every band, both knobs, any number of detents either way: the coarse knob steps the MHz
+	around the band keeping the digits below, and the fine knob steps within the MHz without carrying, except
+	on ADF, which wraps around as a whole.  Also reports how long a step takes.
+*/
+
+#include <chrono>
+#include <cstdio>
+
+#include "Channel.h"
+#include "check.h"
+
+
+/*	Radio
+	kHz after turning a knob some detents, as the radio's digits go
+*/
+static uint32_t Radio(
+	Channel::Band	band,
+	uint32_t	kHz,
+	Channel::Knob	knob,
+	int32_t		detents
+	)
+{
+// wrap into 0 to modulus - 1
+const auto around = [](int64_t value, int64_t modulus) { return static_cast<uint32_t>(((value % modulus) + modulus) % modulus); };
+
+switch (band) {
+	case Channel::kADF:
+		// 190 to 1750 kHz, 100 kHz or 1 kHz a detent
+		return 190 + around(static_cast<int64_t>(kHz) - 190 + detents * (knob == Channel::kCoarse ? 100 : 1), 1561);
+
+	default: {
+		// whole MHz through the band; kHz within the MHz, 25 or 50 at a time
+		const uint32_t first = band == Channel::kNAV ? 108 : 118, megahertz = band == Channel::kNAV ? 10 : 19;
+		const uint32_t fine = band == Channel::kNAV ? 50 : 25;
+		const int64_t above = kHz / 1000 - first, within = kHz % 1000;
+
+		return knob == Channel::kCoarse ?
+			(first + around(above + detents, megahertz)) * 1000 + within :
+			(first + above) * 1000 + around(within + detents * int64_t{fine}, 1000);
+		}
+	}
+}
+
+
+/*	Step
+	Channel::Step for a band known only at run time
+*/
+static uint16_t Step(
+	Channel::Band	band,
+	uint16_t	index,
+	Channel::Knob	knob,
+	int32_t		detents
+	)
+{
+switch (band) {
+	case Channel::kCOM25: return Channel::Step<Channel::kCOM25>(index, knob, detents);
+	case Channel::kCOM833: return Channel::Step<Channel::kCOM833>(index, knob, detents);
+	case Channel::kNAV: return Channel::Step<Channel::kNAV>(index, knob, detents);
+	default: return Channel::Step<Channel::kADF>(index, knob, detents);
+	}
+}
+
+
+/*	main
+	Turn every channel of every band every way
+*/
+int main()
+{
+static constexpr int32_t kDetents[] = { 1, -1, 2, -2, 3, -7, 19, -20, 39, 40, -41, 160, 1000, -1000, 32767, -32768 };
+
+for (uint8_t b = 0; b < Channel::kBands; b++) {
+	const Channel::Band band = static_cast<Channel::Band>(b);
+	const Channel::Description &d = Channel::kDescriptions[band];
+
+	unsigned wrong = 0, outside = 0;
+	for (uint16_t index = 0; index < d.count; index++)
+		for (const Channel::Knob knob : { Channel::kCoarse, Channel::kFine })
+			for (const int32_t detents : kDetents) {
+				const uint16_t stepped = Step(band, index, knob, detents);
+				if (stepped >= d.count) {
+					outside++;
+					continue;
+					}
+
+				if (Channel::Frequency(band, stepped) != Radio(band, Channel::Frequency(band, index), knob, detents)) wrong++;
+				}
+	CHECK(wrong == 0 && outside == 0);
+	}
+
+// the compile-time proof Panel.cc asserts, at run time
+CHECK(Channel::Stepped<Channel::kCOM25>() && Channel::Stepped<Channel::kCOM833>());
+CHECK(Channel::Stepped<Channel::kNAV>() && Channel::Stepped<Channel::kADF>());
+
+// how long a step takes on this machine
+static constexpr unsigned kSteps = 10000000;
+volatile int32_t detents = 1;
+uint16_t at = 0;
+const auto start = std::chrono::steady_clock::now();
+for (unsigned n = 0; n < kSteps; n++)
+	at = Channel::Step<Channel::kCOM833>(at, n & 1 ? Channel::kCoarse : Channel::kFine, detents);
+const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+printf("%.1f ns a step (at %u)\n", seconds * 1e9 / kSteps, at);
+
+return Checked("channel");
+}
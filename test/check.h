@@ -0,0 +1,51 @@
+/*
+	check
+	
+	Assertions for the host tests
+	
+	A failed check is reported with where it is and the test carries on, so one run shows every failure;
+	the test's exit status says whether there were any.
+*/
+
+#pragma once
+
+#include <cstdio>
+
+
+inline unsigned gChecks, gFailures;
+
+
+/*	Check
+	Count a check, and report it if it failed
+*/
+inline bool Check(
+	bool		passed,
+	const char	*const condition,
+	const char	*const file,
+	int		line
+	)
+{
+gChecks++;
+if (!passed) {
+	gFailures++;
+	fprintf(stderr, "%s:%d: failed: %s\n", file, line, condition);
+	}
+
+return passed;
+}
+
+
+/*	Checked
+	Report the checks made; return the test's exit status
+*/
+inline int Checked(
+	const char	*const test
+	)
+{
+printf("%s: %u checks, %u failed\n", test, gChecks, gFailures);
+
+return gFailures ? 1 : 0;
+}
+
+
+#define CHECK(condition) Check(static_cast<bool>(condition), #condition, __FILE__, __LINE__)
@@ -0,0 +1,151 @@
+/*
+	discovery
+
+	Finding the panel in the background (host/discovery.h), with a stand-in for the USB connection
+
+	The plugin asks for the panel every flight loop, so asking must never wait, even while the search is
+	opening a device.  Until the panel is plugged in, or while it won't answer, the search tries again a
+	retry period later; once found, the panel is handed over once.  Stopping mustn't wait out the retry.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <optional>
+#include <thread>
+
+#include "check.h"
+#include "discovery.h"
+
+
+/*	StandIn
+	The connection to a panel that can be plugged in and made to answer, and takes a while to open
+*/
+struct StandIn {
+	static inline std::atomic<bool> gPlugged{false}, gAnswering{false};
+	static inline std::atomic<unsigned> gOpens{0}, gOpen{0};
+	static constexpr std::chrono::milliseconds kOpening{50};
+
+			StandIn();
+			~StandIn() { gOpen--; }
+
+	void		Sync();
+	};
+
+
+/*	StandIn
+	Open the connection, if the panel is plugged in
+*/
+StandIn::StandIn()
+{
+gOpens++;
+std::this_thread::sleep_for(kOpening);
+if (!gPlugged) throw "not plugged in";
+
+gOpen++;
+}
+
+
+/*	Sync
+	Find out what the panel is displaying, if it answers
+*/
+void StandIn::Sync()
+{
+if (!gAnswering) throw "not answering";
+}
+
+
+/*	Milliseconds
+	How long since then
+*/
+static long Milliseconds(
+	std::chrono::steady_clock::time_point then
+	)
+{
+return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - then).count();
+}
+
+
+/*	Taken
+	Ask for the panel every 10 ms, as the flight loop would, for up to so long; return it, and the longest an ask took
+*/
+static std::unique_ptr<StandIn> Taken(
+	Discovery<StandIn> &discovery,
+	std::chrono::milliseconds timeout,
+	long		&longest
+	)
+{
+const auto start = std::chrono::steady_clock::now();
+longest = 0;
+while (Milliseconds(start) < timeout.count()) {
+	const auto asked = std::chrono::steady_clock::now();
+	std::unique_ptr<StandIn> panel = discovery.Take();
+	longest = std::max(longest, Milliseconds(asked));
+	if (panel) return panel;
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+
+return nullptr;
+}
+
+
+/*	main
+	Look with nothing plugged in, plug in a panel that doesn't answer, then one that does; and stop mid-retry
+*/
+int main()
+{
+using namespace std::chrono_literals;
+long longest;
+
+	{
+	// nothing there: asking never waits, even while a device is being opened, and the search retries
+	Discovery<StandIn> discovery;
+	CHECK(!Taken(discovery, 2500ms, longest));
+	CHECK(longest < 5);
+	CHECK(StandIn::gOpens >= 2 && StandIn::gOpens <= 4);
+
+	// plugged in but not answering: opened, dropped, and tried again
+	StandIn::gPlugged = true;
+	const unsigned opens = StandIn::gOpens;
+	CHECK(!Taken(discovery, 1500ms, longest));
+	CHECK(StandIn::gOpens > opens && StandIn::gOpen == 0);
+
+	// answering: found within a retry, and handed over once
+	StandIn::gAnswering = true;
+	std::unique_ptr<StandIn> panel = Taken(discovery, 1500ms, longest);
+	CHECK(panel && StandIn::gOpen == 1);
+	CHECK(longest < 5);
+
+	// not looked for again
+	const unsigned found = StandIn::gOpens;
+	CHECK(!Taken(discovery, 1500ms, longest));
+	CHECK(StandIn::gOpens == found);
+	}
+CHECK(StandIn::gOpen == 0);
+
+	{
+	// stopping mid-retry doesn't wait it out
+	StandIn::gPlugged = false;
+	std::optional<Discovery<StandIn>> discovery;
+	discovery.emplace();
+	std::this_thread::sleep_for(200ms);
+
+	const auto stopping = std::chrono::steady_clock::now();
+	discovery.reset();
+	CHECK(Milliseconds(stopping) < 100);
+	}
+
+	{
+	// stopping while a device is being opened waits only for the open
+	std::optional<Discovery<StandIn>> discovery;
+	discovery.emplace();
+	std::this_thread::sleep_for(10ms);
+
+	const auto stopping = std::chrono::steady_clock::now();
+	discovery.reset();
+	CHECK(Milliseconds(stopping) < StandIn::kOpening.count() + 50);
+	}
+
+return Checked("discovery");
+}
@@ -0,0 +1,133 @@
+/*
+	emulator
+	
+	The panel's firmware, USB stack and all, on the simulation HAL and the USBD register model, for the
+	host tests to play the USB host against
+*/
+
+#pragma once
+
+#include <optional>
+#include <vector>
+
+#include "nrf_power.h"
+#include "nrf_usbd.h"
+
+#include "HAL.h"
+#include "Panel.h"
+#include "USB.h"
+#include "check.h"
+
+
+extern void
+	ConfigurePowerAndClock(),
+	ConfigureUSBD();
+
+
+inline Panel *gPanel;
+
+
+/*	Settle
+	Run the event loop, completing each EasyDMA transfer it starts, until the device has nothing left to do
+*/
+inline void Settle()
+{
+gPanel->Run();
+while (USBDModel::Transfer()) gPanel->Run();
+}
+
+
+/*	PowerUp
+	Connect the panel's USB events and reports to the real stack, and plug it in
+*/
+inline void PowerUp(
+	Panel		&panel
+	)
+{
+HAL::USBD::gHandle = USBEvent;
+HAL::USBD::gReport = USBEndpointIN1;
+HAL::USBD::gWakeup = USBWakeup;
+
+gPanel = &panel;
+ConfigurePowerAndClock();
+ConfigureUSBD();
+
+PowerModel::Raise(NRF_POWER_EVENT_USBPWRRDY);
+PowerModel::Raise(NRF_POWER_EVENT_USBDETECTED);
+Settle();
+
+USBDModel::Reset();
+Settle();
+}
+
+/*	ControlIn
+	Control read: return the data, or nothing if the device stalled
+	
+	The host reads packets until the device acknowledges the STATUS stage; 'packets' counts them, with any
+	zero-length packet.
+*/
+inline std::optional<std::vector<uint8_t>> ControlIn(
+	uint8_t		bmRequestType,
+	uint8_t		bRequest,
+	uint16_t	wValue,
+	uint16_t	wIndex,
+	uint16_t	wLength,
+	unsigned	*const packets = nullptr
+	)
+{
+USBDModel::Setup(bmRequestType, bRequest, wValue, wIndex, wLength);
+Settle();
+
+std::vector<uint8_t> data;
+unsigned n = 0;
+while (USBDModel::gStatus == USBDModel::kNoStatus) {
+	const std::optional<std::vector<uint8_t>> packet = USBDModel::In(0);
+	if (!packet) break;
+	
+	// a host reads no further than a short packet, or wLength
+	CHECK(data.size() < wLength || packet->empty());
+	data.insert(data.end(), packet->begin(), packet->end());
+	n++;
+	Settle();
+	}
+
+if (packets) *packets = n;
+if (USBDModel::gStatus != USBDModel::kAcknowledged) return std::nullopt;
+
+CHECK(data.size() <= wLength);
+return data;
+}
+
+
+/*	ControlOut
+	Control write: return whether the device acknowledged it
+*/
+inline bool ControlOut(
+	uint8_t		bmRequestType,
+	uint8_t		bRequest,
+	uint16_t	wValue,
+	uint16_t	wIndex,
+	const std::vector<uint8_t> &data
+	)
+{
+USBDModel::Setup(bmRequestType, bRequest, wValue, wIndex, data.size());
+Settle();
+
+for (size_t offset = 0; offset < data.size() && USBDModel::gStatus == USBDModel::kNoStatus; offset += USBDModel::kPacketSize) {
+	const size_t end = std::min(offset + USBDModel::kPacketSize, data.size());
+	if (!CHECK(USBDModel::Out(0, { data.begin() + offset, data.begin() + end }))) break;
+	Settle();
+	}
+
+// no DATA stage at all is acknowledged straight away
+return USBDModel::gStatus == USBDModel::kAcknowledged;
+}
+
+
+/*	Configure
+	Enumerate as far as the host has to before using the device: SET_CONFIGURATION
+*/
+inline bool Configure()
+{
+return ControlOut(0x00, 9 /* SET_CONFIGURATION */, 1, 0, {});
+}
@@ -0,0 +1,99 @@
+/*
+	forwarder
+	
+	Local stand-in for the bridge forwarder (host/forward.cc), for the host tests to play against the
+	plugin's end of the bridge (host/remote.cc) over loopback
+*/
+
+#pragma once
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <optional>
+
+#include "bridge.h"
+#include "check.h"
+#include "remote.h"
+
+
+constexpr unsigned short kPort = kBridgePort + 100;	// away from a plugin that may be running
+
+
+/*	Forwarder
+	Local stand-in for forward.cc: sends to the plugin's port, and hears only from it
+*/
+struct Forwarder {
+	const int	fSocket;
+	uint32_t	fSequence = 0,
+			fEcho = 0;	// 'sent' of the last set datagram received
+	uint16_t	fChange = 0;
+
+			Forwarder();
+			~Forwarder() { close(fSocket); }
+
+	void		Send(unsigned value0, unsigned value1, bool changed = true, std::optional<uint32_t> sequence = {});
+	std::optional<BridgeDatagram> Receive(int timeout);
+	};
+
+
+/*	Forwarder
+	Connect to the plugin on loopback
+*/
+inline Forwarder::Forwarder() :
+	fSocket(socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP))
+{
+sockaddr_in address = {};
+address.sin_family = AF_INET;
+address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+address.sin_port = htons(kPort);
+
+CHECK(fSocket >= 0 && connect(fSocket, reinterpret_cast<const sockaddr*>(&address), sizeof address) == 0);
+}
+
+
+/*	Send
+	Send the panel's state, with the next sequence number unless given one, echoing the last set
+*/
+inline void Forwarder::Send(
+	unsigned	value0,
+	unsigned	value1,
+	bool		changed,
+	std::optional<uint32_t> sequence
+	)
+{
+if (changed) fChange++;
+
+BridgePanel panel = { 0, true, fChange, 0, 0, 0, 1, {} };
+panel.values[0][0] = value0;
+panel.values[0][1] = value1;
+const BridgeDatagram datagram = { BridgeDatagram::kState, sequence ? *sequence : ++fSequence, BridgeClock(), fEcho, { panel } };
+
+unsigned char buffer[kBridgeDatagramMaximum];
+const size_t length = EncodeBridgeDatagram(datagram, buffer, sizeof buffer);
+CHECK(send(fSocket, buffer, length, 0) == static_cast<ssize_t>(length));
+}
+
+
+/*	Receive
+	Wait up to 'timeout' ms for a datagram from the plugin; the next state sent echoes it
+*/
+inline std::optional<BridgeDatagram> Forwarder::Receive(
+	int		timeout
+	)
+{
+pollfd polled = { fSocket, POLLIN, 0 };
+if (poll(&polled, 1, timeout) != 1) return std::nullopt;
+
+unsigned char buffer[kBridgeDatagramMaximum];
+const ssize_t length = recv(fSocket, buffer, sizeof buffer, 0);
+if (length < 0) return std::nullopt;
+
+const BridgeDatagram datagram = DecodeBridgeDatagram(buffer, length);
+if (datagram.kind == BridgeDatagram::kSet) fEcho = datagram.sent;
+
+return datagram;
+}
@@ -0,0 +1,103 @@
+/*
+	log
+	
+	The firmware's deferred log (firmware/Log.cc), drained in log reports and decoded into text as the host
+	does (host/log.cc)
+*/
+
+#include <cstring>
+#include <string>
+
+#include "HAL.h"
+#include "Log.h"
+#include "check.h"
+#include "log.h"
+
+
+/*	Drain
+	Take up to three records out of the log into a report, as the firmware's log Feature report does; decode it
+*/
+static std::vector<LogRecord> Drain(
+	unsigned	&dropped
+	)
+{
+uint8_t report[1 + 2 + 1 + 3 * Log::kEncodedRecord] = { 4 /* kReportLog */ };
+uint16_t droppedNow;
+const size_t length = Log::Encode(report + 4, sizeof report - 4, droppedNow);
+report[1] = static_cast<uint8_t>(droppedNow);
+report[2] = static_cast<uint8_t>(droppedNow >> 8);
+report[3] = length / Log::kEncodedRecord;
+
+return DecodeLogReport(report, sizeof report, dropped);
+}
+
+
+/*	main
+
+*/
+int main()
+{
+unsigned dropped;
+
+// nothing logged
+CHECK(Drain(dropped).empty() && dropped == 0);
+
+// records with no, one and two arguments come out as they went in, and as text
+HAL::RTC::gNow = 0x123456;
+Log::Write(Log::kLogUSBReset);
+Log::Write(Log::kLogDiagnosticsCommand, 9);
+HAL::RTC::gNow = 0x1000000 + 7;
+Log::Write(Log::kLogControlTimeout, 64, 200);
+
+std::vector<LogRecord> records = Drain(dropped);
+CHECK(records.size() == 3 && dropped == 0);
+if (records.size() == 3) {
+	CHECK(records[0].time == 0x123456 && records[0].format == Log::kLogUSBReset && records[0].argumentsN == 0);
+	CHECK(records[1].format == Log::kLogDiagnosticsCommand && records[1].argumentsN == 1 && records[1].arguments[0] == 9);
+	CHECK(records[2].time == 7 && records[2].argumentsN == 2 && records[2].arguments[0] == 64 && records[2].arguments[1] == 200);
+	
+	CHECK(FormatLogRecord(records[0]) == "USB bus reset");
+	CHECK(FormatLogRecord(records[1]) == "diagnostics command 9 not known");
+	CHECK(FormatLogRecord(records[2]) == "control transfer abandoned at byte 64 of 200");
+	}
+
+// more than a report holds is drained over several, oldest first
+for (uint32_t n = 0; n < 7; n++) Log::Write(Log::kLogEventsDropped, n);
+uint32_t next = 0;
+for (records = Drain(dropped); !records.empty(); records = Drain(dropped)) {
+	CHECK(records.size() <= 3);
+	for (const LogRecord &record : records)
+		CHECK(record.format == Log::kLogEventsDropped && record.arguments[0] == next++);
+	}
+CHECK(next == 7);
+
+// a full log drops the newest records, and counts them
+for (uint32_t n = 0; n < 64 + 5; n++) Log::Write(Log::kLogStateSaved, n / 8, n % 8);
+next = 0;
+for (records = Drain(dropped); !records.empty(); records = Drain(dropped))
+	for (const LogRecord &record : records) {
+		CHECK(record.arguments[0] * 8 + record.arguments[1] == next);
+		next++;
+		}
+CHECK(next == 64 && dropped == 5);
+
+// a format from newer firmware is shown as a number
+LogRecord unknown = { 0, Log::kFormats, 2, { 1, 2 } };
+CHECK(FormatLogRecord(unknown) == "unknown message " + std::to_string(Log::kFormats) + " (1, 2)");
+
+// a report too short for its header is refused; one claiming more records than it holds is cut short
+bool refused = false;
+const uint8_t shortReport[3] = { 4, 0, 0 };
+try { (void) DecodeLogReport(shortReport, sizeof shortReport, dropped); }
+catch (const char*) { refused = true; }
+CHECK(refused);
+
+Log::Write(Log::kLogUSBSuspend);
+uint8_t report[4 + Log::kEncodedRecord] = { 4, 0, 0, 3 };
+uint16_t droppedNow;
+CHECK(Log::Encode(report + 4, sizeof report - 4, droppedNow) == Log::kEncodedRecord);
+records = DecodeLogReport(report, sizeof report, dropped);
+CHECK(records.size() == 1 && FormatLogRecord(records[0]) == "USB suspended");
+
+return Checked("log");
+}
@@ -0,0 +1,187 @@
+/*
+	maxbus
+
+	MAX6954s daisy-chained on one SPI master (firmware/MAXBus.cc), against a model of the chain bit by bit
+
+	For one to four chips: registers written and staged land on the chip they were meant for, a flush takes
+	as many frames as the busiest chip needs, and a read comes back from the chip it was asked of.  Also
+	reports the frames and display updates a second the bus manages at the SPIM's 1 MHz.
+*/
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <optional>
+#include <random>
+
+#include "HAL.h"
+#include "MAX6954.h"
+#include "MAXBus.h"
+#include "check.h"
+
+
+/*	Chain
+	MAX6954s with DOUT of each to DIN of the next: MOSI into the first, MISO out of the last
+
+	Each chip's 16-bit shift register takes in what the one before shifts out.  As chip select rises, each
+	acts on the word it holds; a read loads the register's value, to be shifted out during the next frame.
+*/
+static struct Chain {
+	unsigned	fChips;
+	uint8_t		fRegisters[MAXBus::kChipsMaximum][128];
+	int		fRead[MAXBus::kChipsMaximum];	// register whose value goes out in the next frame
+	uint16_t	fShift[MAXBus::kChipsMaximum];
+	unsigned long	fFrames, fWords;
+
+	void		Reset(unsigned chips);
+	void		Frame(const uint8_t *out, size_t length, uint8_t *in);
+	} gChain;
+
+
+/*	Reset
+	Power up a chain of so many chips
+*/
+void Chain::Reset(
+	unsigned	chips
+	)
+{
+fChips = chips;
+memset(fRegisters, 0, sizeof fRegisters);
+std::fill_n(fRead, MAXBus::kChipsMaximum, -1);
+std::fill_n(fShift, MAXBus::kChipsMaximum, 0);
+fFrames = fWords = 0;
+}
+
+
+/*	Frame
+	Chip select low, the bits clocked through, and chip select high
+*/
+void Chain::Frame(
+	const uint8_t	*const out,
+	size_t		length,
+	uint8_t		*const in
+	)
+{
+fFrames++;
+fWords += length / 2;
+
+for (unsigned chip = 0; chip < fChips; chip++)
+	if (fRead[chip] >= 0) fShift[chip] = fRegisters[chip][fRead[chip]];
+
+// most significant bit first, each chip passing on its top bit to the next
+for (size_t bit = 0; bit < 8 * length; bit++) {
+	const unsigned mosi = out[bit / 8] >> (7 - bit % 8) & 1, miso = fShift[fChips - 1] >> 15 & 1;
+	for (unsigned chip = fChips - 1; chip > 0; chip--)
+		fShift[chip] = fShift[chip] << 1 | fShift[chip - 1] >> 15;
+	fShift[0] = fShift[0] << 1 | mosi;
+
+	if (bit % 8 == 0) in[bit / 8] = 0;
+	in[bit / 8] |= miso << (7 - bit % 8);
+	}
+
+for (unsigned chip = 0; chip < fChips; chip++) {
+	const uint16_t word = fShift[chip];
+	const uint8_t registre = word >> 8 & 0x7f;
+
+	fRead[chip] = word & 0x8000 ? registre : -1;
+	if (!(word & 0x8000) && registre != 0 /* No-Op */) fRegisters[chip][registre] = word;
+	}
+}
+
+
+/*	Chips
+	Chain so many chips on a bus, and check that they're written, flushed and read as they should be
+*/
+static void Chips(
+	unsigned	chips
+	)
+{
+static constexpr unsigned kDigits = 16, kUpdates = 1000;
+static constexpr double kClock = 1e6, kDeselected = 2e-6 /* s chip select is high between frames */;
+
+gChain.Reset(chips);
+SPIM spim(HAL::Pin(1, 8), HAL::Pin(0, 14), HAL::Pin(0, 13), HAL::Pin(0, 15));
+MAXBus bus(spim, chips);
+std::optional<MAX6954> max[MAXBus::kChipsMaximum];
+for (unsigned chip = 0; chip < chips; chip++)
+	max[chip].emplace(bus, chip);
+
+// written now, a frame each, and only to its own chip
+for (unsigned chip = 0; chip < chips; chip++)
+	max[chip]->ScanLimit(5 + chip);
+bool written = gChain.fFrames == chips;
+for (unsigned chip = 0; chip < chips; chip++)
+	written &= gChain.fRegisters[chip][0x03] == 5 + chip;
+CHECK(written);
+
+// updates alternately of every digit and of a few; only those that changed are sent, interleaved
+std::mt19937 random(1);
+uint8_t shown[MAXBus::kChipsMaximum][kDigits] = {};
+bool known = false;
+unsigned slotted = 0, landed = 0;
+unsigned long frames = 0, words = 0;
+for (unsigned update = 0; update < kUpdates; update++) {
+	unsigned busiest = 0;
+	for (unsigned chip = 0; chip < chips; chip++) {
+		unsigned changed = 0;
+		for (unsigned digit = 0; digit < kDigits; digit++) {
+			const uint8_t value = update % 2 == 0 || random() % 8 == 0 ? random() & 0x7f : shown[chip][digit];
+			changed += !known || value != shown[chip][digit];
+			shown[chip][digit] = value;
+			max[chip]->Digit(digit, value);
+			}
+		busiest = std::max(busiest, changed);
+		}
+	known = true;
+
+	gChain.fFrames = gChain.fWords = 0;
+	bus.Flush();
+	slotted += gChain.fFrames == busiest && gChain.fWords == busiest * chips;
+	frames += gChain.fFrames;
+	words += gChain.fWords;
+
+	bool all = true;
+	for (unsigned chip = 0; chip < chips; chip++)
+		all &= memcmp(&gChain.fRegisters[chip][0x20], shown[chip], kDigits) == 0;
+	landed += all;
+	}
+CHECK(slotted == kUpdates && landed == kUpdates);
+
+// nothing staged, nothing sent
+gChain.fFrames = 0;
+bus.Flush();
+CHECK(gChain.fFrames == 0);
+
+// reads come back from the chip asked, one frame after each; in sequences of as many as fit
+const unsigned perSequence = SPIM::kSequenceMaximum / chips - 1;
+for (unsigned chip = 0; chip < chips; chip++) {
+	uint8_t registers[kDigits], values[kDigits];
+	for (unsigned digit = 0; digit < kDigits; digit++)
+		registers[digit] = 0x20 + digit;
+
+	gChain.fFrames = 0;
+	max[chip]->Read(registers, values, kDigits);
+	CHECK(gChain.fFrames == kDigits + (kDigits + perSequence - 1) / perSequence);
+	CHECK(memcmp(values, shown[chip], kDigits) == 0);
+	CHECK(max[chip]->Digit(3) == shown[chip][3]);
+	}
+
+// at 1 MHz, 16 clocks a chip a frame
+const double seconds = words * 16 / kClock + frames * kDeselected;
+printf("%u chips: %.1f frames an update, %.0f frames/s, %.0f updates/s\n", chips,
+	static_cast<double>(frames) / kUpdates, frames / seconds, kUpdates / seconds);
+}
+
+
+/*	main
+	Chains of one chip up to as many as the bus drives
+*/
+int main()
+{
+HAL::SPI::gDevice = [](const uint8_t *out, size_t outLength, uint8_t *in, size_t) { gChain.Frame(out, outLength, in); };
+
+for (unsigned chips = 1; chips <= MAXBus::kChipsMaximum; chips++)
+	Chips(chips);
+
+return Checked("maxbus");
+}
@@ -0,0 +1,57 @@
+/*
+	nrf
+	
+	Interrupt controller model, standing in for the nRF SDK's CMSIS headers in the host tests
+	
+	An interrupt raised while its IRQ is disabled is held pending, and its handler runs when the IRQ is
+	enabled again, as the NVIC does.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+
+enum IRQn_Type {
+	POWER_CLOCK_IRQn,
+	USBD_IRQn,
+	kIRQs
+	};
+
+
+extern "C" void POWER_CLOCK_IRQHandler();
+extern "C" void USBD_IRQHandler();
+
+
+/*	NVICModel
+	Which interrupts are enabled and pending
+*/
+struct NVICModel {
+	static inline bool gEnabled[kIRQs], gPending[kIRQs];
+	
+	static void	Handle(IRQn_Type irq) {
+				if (irq == USBD_IRQn) USBD_IRQHandler(); else POWER_CLOCK_IRQHandler();
+				}
+	
+	// stimulus: the peripheral interrupts
+	static void	Interrupt(IRQn_Type irq) {
+				if (gEnabled[irq]) Handle(irq); else gPending[irq] = true;
+				}
+	};
+
+
+inline void NVIC_SetPriority(IRQn_Type, uint32_t) {}
+inline void NVIC_ClearPendingIRQ(IRQn_Type irq) { NVICModel::gPending[irq] = false; }
+inline void NVIC_DisableIRQ(IRQn_Type irq) { NVICModel::gEnabled[irq] = false; }
+
+inline void NVIC_EnableIRQ(
+	IRQn_Type	irq
+	)
+{
+NVICModel::gEnabled[irq] = true;
+
+if (NVICModel::gPending[irq]) {
+	NVICModel::gPending[irq] = false;
+	NVICModel::Handle(irq);
+	}
+}
@@ -0,0 +1,13 @@
+/*
+	nrf52_erratas
+	
+	The modelled chip has none of the errata the firmware works around
+*/
+
+#pragma once
+
+
+inline bool nrf52_errata_171() { return false; }
+inline bool nrf52_errata_187() { return false; }
+inline bool nrf52_errata_199() { return false; }
+inline bool nrf52_errata_223() { return false; }
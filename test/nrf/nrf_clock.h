@@ -0,0 +1,39 @@
+/*
+	nrf_clock
+	
+	Clock model: the high-frequency crystal starts as soon as it's asked to
+*/
+
+#pragma once
+
+#include <cstdint>
+
+#include "nrf.h"
+
+
+enum nrf_clock_task_t {
+	NRF_CLOCK_TASK_HFCLKSTART,
+	NRF_CLOCK_TASK_HFCLKSTOP
+	};
+
+enum nrf_clock_event_t {
+	NRF_CLOCK_EVENT_HFCLKSTARTED
+	};
+
+
+struct ClockModel {
+	static inline bool gRunning, gStarted;
+	};
+
+
+inline void nrf_clock_int_disable(uint32_t) {}
+inline bool nrf_clock_event_check(nrf_clock_event_t) { return ClockModel::gStarted; }
+inline void nrf_clock_event_clear(nrf_clock_event_t) { ClockModel::gStarted = false; }
+
+inline void nrf_clock_task_trigger(
+	nrf_clock_task_t task
+	)
+{
+ClockModel::gRunning = task == NRF_CLOCK_TASK_HFCLKSTART;
+if (ClockModel::gRunning) ClockModel::gStarted = true;
+}
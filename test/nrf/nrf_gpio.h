@@ -0,0 +1,23 @@
+/*
+	nrf_gpio
+	
+	GPIO model: remembers which pins were set
+*/
+
+#pragma once
+
+#include <cstdint>
+
+#include "nrf.h"
+
+
+#define NRF_GPIO_PIN_MAP(port, pin) (((port) << 5) | ((pin) & 0x1f))
+
+
+struct GPIOModel {
+	static inline uint64_t gSet;
+	};
+
+
+inline void nrf_gpio_pin_set(uint32_t pin) { GPIOModel::gSet |= 1ull << pin; }
+inline void nrf_gpio_pin_clear(uint32_t pin) { GPIOModel::gSet &= ~(1ull << pin); }
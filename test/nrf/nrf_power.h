@@ -0,0 +1,41 @@
+/*
+	nrf_power
+	
+	Power model: USB supply detection, raised by the test
+*/
+
+#pragma once
+
+#include <cstdint>
+
+#include "nrf.h"
+
+
+enum nrf_power_event_t {
+	NRF_POWER_EVENT_USBDETECTED,
+	NRF_POWER_EVENT_USBREMOVED,
+	NRF_POWER_EVENT_USBPWRRDY,
+	kPowerEvents
+	};
+
+#define NRF_POWER_INT_USBDETECTED_MASK (1u << NRF_POWER_EVENT_USBDETECTED)
+#define NRF_POWER_INT_USBREMOVED_MASK (1u << NRF_POWER_EVENT_USBREMOVED)
+#define NRF_POWER_INT_USBPWRRDY_MASK (1u << NRF_POWER_EVENT_USBPWRRDY)
+
+
+struct PowerModel {
+	static inline bool gEvents[kPowerEvents];
+	static inline uint32_t gInterrupts;
+	
+	// stimulus: the event happens
+	static void	Raise(nrf_power_event_t event) {
+				gEvents[event] = true;
+				if (gInterrupts & 1u << event) NVICModel::Interrupt(POWER_CLOCK_IRQn);
+				}
+	};
+
+
+inline bool nrf_power_event_check(nrf_power_event_t event) { return PowerModel::gEvents[event]; }
+inline void nrf_power_event_clear(nrf_power_event_t event) { PowerModel::gEvents[event] = false; }
+inline void nrf_power_int_enable(uint32_t mask) { PowerModel::gInterrupts |= mask; }
+inline void nrf_power_int_disable(uint32_t mask) { PowerModel::gInterrupts &= ~mask; }
@@ -0,0 +1,320 @@
+/*
+	nrf_usbd
+	
+	USBD register model, standing in for the nRF HAL in the host tests
+	
+	The firmware side is the nrf_usbd_* functions, as in the nRF HAL.  The host side is the stimulus
+	functions of USBDModel: a SETUP packet, IN and OUT tokens, frames, suspend and resume.  Each raises the
+	events the USBD would, and interrupts if the firmware enabled them.
+	
+	An EasyDMA transfer starts on its STARTEP task and ends only when the test calls Transfer(), so the
+	test decides how long it takes.  The USBD can only do one at a time [nRFPS §6.35.5]: starting another
+	in the meantime is counted as an overlap, as is starting one while in low power or without HFCLK.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <vector>
+
+#include "nrf.h"
+#include "nrf_clock.h"
+
+
+/*	nrf_usbd_event_t
+	Events, numbered as their INTEN bits
+*/
+enum nrf_usbd_event_t {
+	NRF_USBD_EVENT_USBRESET = 0,
+	NRF_USBD_EVENT_STARTED = 1,
+	NRF_USBD_EVENT_ENDEPIN0 = 2,
+	NRF_USBD_EVENT_ENDEPIN1 = 3,
+	NRF_USBD_EVENT_ENDEPIN2 = 4,
+	NRF_USBD_EVENT_EP0DATADONE = 10,
+	NRF_USBD_EVENT_ENDEPOUT0 = 12,
+	NRF_USBD_EVENT_ENDEPOUT1 = 13,
+	NRF_USBD_EVENT_ENDEPOUT2 = 14,
+	NRF_USBD_EVENT_SOF = 21,
+	NRF_USBD_EVENT_USBEVENT = 22,
+	NRF_USBD_EVENT_EP0SETUP = 23,
+	NRF_USBD_EVENT_DATAEP = 24,
+	kUSBDEvents
+	};
+
+#define NRF_USBD_INT_USBRESET_MASK (1u << NRF_USBD_EVENT_USBRESET)
+#define NRF_USBD_INT_ENDEPIN0_MASK (1u << NRF_USBD_EVENT_ENDEPIN0)
+#define NRF_USBD_INT_ENDEPIN1_MASK (1u << NRF_USBD_EVENT_ENDEPIN1)
+#define NRF_USBD_INT_ENDEPIN2_MASK (1u << NRF_USBD_EVENT_ENDEPIN2)
+#define NRF_USBD_INT_EP0DATADONE_MASK (1u << NRF_USBD_EVENT_EP0DATADONE)
+#define NRF_USBD_INT_ENDEPOUT0_MASK (1u << NRF_USBD_EVENT_ENDEPOUT0)
+#define NRF_USBD_INT_ENDEPOUT1_MASK (1u << NRF_USBD_EVENT_ENDEPOUT1)
+#define NRF_USBD_INT_ENDEPOUT2_MASK (1u << NRF_USBD_EVENT_ENDEPOUT2)
+#define NRF_USBD_INT_SOF_MASK (1u << NRF_USBD_EVENT_SOF)
+#define NRF_USBD_INT_USBEVENT_MASK (1u << NRF_USBD_EVENT_USBEVENT)
+#define NRF_USBD_INT_EP0SETUP_MASK (1u << NRF_USBD_EVENT_EP0SETUP)
+#define NRF_USBD_INT_DATAEP_MASK (1u << NRF_USBD_EVENT_DATAEP)
+
+
+enum nrf_usbd_task_t {
+	NRF_USBD_TASK_STARTEPIN0,
+	NRF_USBD_TASK_STARTEPIN1,
+	NRF_USBD_TASK_STARTEPIN2,
+	NRF_USBD_TASK_STARTEPOUT0,
+	NRF_USBD_TASK_STARTEPOUT1,
+	NRF_USBD_TASK_STARTEPOUT2,
+	NRF_USBD_TASK_EP0RCVOUT,
+	NRF_USBD_TASK_EP0STATUS,
+	NRF_USBD_TASK_EP0STALL,
+	NRF_USBD_TASK_DRIVEDPDM,
+	NRF_USBD_TASK_NODRIVEDPDM
+	};
+
+enum nrf_usbd_dpdmvalue_t {
+	NRF_USBD_DPDMVALUE_RESUME,
+	NRF_USBD_DPDMVALUE_J,
+	NRF_USBD_DPDMVALUE_K
+	};
+
+#define NRF_USBD_EVENTCAUSE_SUSPEND_MASK (1u << 8)
+#define NRF_USBD_EVENTCAUSE_RESUME_MASK (1u << 9)
+#define NRF_USBD_EVENTCAUSE_WUREQ_MASK (1u << 10)
+#define NRF_USBD_EVENTCAUSE_READY_MASK (1u << 11)
+
+#define NRF_USBD_EPDATASTATUS_EPIN1_MASK (1u << 1)
+#define NRF_USBD_EPDATASTATUS_EPIN2_MASK (1u << 2)
+#define NRF_USBD_EPDATASTATUS_EPOUT1_MASK (1u << 17)
+#define NRF_USBD_EPDATASTATUS_EPOUT2_MASK (1u << 18)
+
+#define NRF_USBD_EPIN(n) static_cast<uint8_t>(0x80 | (n))
+#define NRF_USBD_EPOUT(n) static_cast<uint8_t>(n)
+
+
+/*	USBDModel
+	The USBD's registers and endpoint buffers, and the host's view of them
+*/
+struct USBDModel {
+	static constexpr unsigned kEndpoints = 3;
+	static constexpr size_t kPacketSize = 64;
+	
+	enum Status { kNoStatus, kAcknowledged, kStalled };
+	
+	/*	Endpoint
+		One direction of one endpoint
+	*/
+	struct Endpoint {
+		bool		enabled,
+				ready;		// IN: packet waiting for the host; OUT: buffer free for the host
+		uintptr_t	pointer;	// EasyDMA
+		uint32_t	count;
+		std::vector<uint8_t> data;	// the USBD's buffer
+		};
+	
+	static inline bool gEnabled, gPullup, gLowPower, gSuspended;
+	static inline bool gEvents[kUSBDEvents];
+	static inline uint32_t gInterrupts, gEventCause, gDataStatus, gFrame;
+	static inline uint8_t gSetup[8];
+	static inline Endpoint gIn[kEndpoints], gOut[kEndpoints];
+	static inline Status gStatus;			// of the last control transfer
+	static inline int gDMA = -1;			// STARTEP task of the transfer in progress
+	static inline unsigned gTransfers, gOverlaps, gAsleep, gResumes;
+	static inline std::vector<nrf_usbd_task_t> gTasks;
+	
+	static Endpoint	&Of(uint8_t ep) { return ep & 0x80 ? gIn[ep & 0x7f] : gOut[ep]; }
+	
+	static void	Raise(nrf_usbd_event_t event) {
+				gEvents[event] = true;
+				if (gInterrupts & 1u << event) NVICModel::Interrupt(USBD_IRQn);
+				}
+	
+	static void	Cause(uint32_t cause) {
+				gEventCause |= cause;
+				Raise(NRF_USBD_EVENT_USBEVENT);
+				}
+	
+	// firmware started a transfer: the data moves now, but the transfer only ends in Transfer()
+	static void	Start(unsigned n, bool in) {
+				if (gDMA >= 0) gOverlaps++;
+				if (gLowPower || !ClockModel::gRunning) gAsleep++;
+				gDMA = in ? NRF_USBD_TASK_STARTEPIN0 + n : NRF_USBD_TASK_STARTEPOUT0 + n;
+				gTransfers++;
+				
+				Endpoint &e = in ? gIn[n] : gOut[n];
+				uint8_t *const ram = reinterpret_cast<uint8_t*>(e.pointer);
+				if (in)
+					e.data.assign(ram, ram + e.count);
+				else
+					memcpy(ram, e.data.data(), std::min<size_t>(e.count, e.data.size()));
+				}
+	
+	// stimulus: the transfer in progress ends; return whether there was one
+	static bool	Transfer() {
+				if (gDMA < 0) return false;
+				
+				const bool in = gDMA < NRF_USBD_TASK_STARTEPOUT0;
+				const unsigned n = gDMA - (in ? NRF_USBD_TASK_STARTEPIN0 : NRF_USBD_TASK_STARTEPOUT0);
+				gDMA = -1;
+				
+				if (in) {
+					gIn[n].ready = true;
+					Raise(static_cast<nrf_usbd_event_t>(NRF_USBD_EVENT_ENDEPIN0 + n));
+					}
+				else {
+					// the buffer is free again, except on Endpoint 0, which waits for EP0RCVOUT
+					gOut[n].data.clear();
+					gOut[n].ready = n != 0;
+					Raise(static_cast<nrf_usbd_event_t>(NRF_USBD_EVENT_ENDEPOUT0 + n));
+					}
+				
+				return true;
+				}
+	
+	// stimulus: the host sends a SETUP packet
+	static void	Setup(uint8_t bmRequestType, uint8_t bRequest, uint16_t wValue, uint16_t wIndex, uint16_t wLength) {
+				const uint8_t setup[8] = {
+					bmRequestType, bRequest,
+					static_cast<uint8_t>(wValue), static_cast<uint8_t>(wValue >> 8),
+					static_cast<uint8_t>(wIndex), static_cast<uint8_t>(wIndex >> 8),
+					static_cast<uint8_t>(wLength), static_cast<uint8_t>(wLength >> 8)
+					};
+				memcpy(gSetup, setup, sizeof gSetup);
+				gStatus = kNoStatus;
+				gIn[0].ready = gOut[0].ready = false;
+				Raise(NRF_USBD_EVENT_EP0SETUP);
+				}
+	
+	// stimulus: the host sends an IN token; returns the packet, or nothing if the endpoint NAKs
+	static std::optional<std::vector<uint8_t>> In(unsigned n) {
+				if (!gIn[n].ready) return std::nullopt;
+				gIn[n].ready = false;
+				
+				if (n == 0)
+					Raise(NRF_USBD_EVENT_EP0DATADONE);
+				else {
+					gDataStatus |= 1u << n;
+					Raise(NRF_USBD_EVENT_DATAEP);
+					}
+				
+				return gIn[n].data;
+				}
+	
+	// stimulus: the host sends an OUT packet; returns whether the endpoint took it (or NAKed)
+	static bool	Out(unsigned n, const std::vector<uint8_t> &data) {
+				if (!gOut[n].ready) return false;
+				gOut[n].ready = false;
+				gOut[n].data.assign(data.begin(), data.begin() + std::min(data.size(), kPacketSize));
+				
+				if (n == 0)
+					Raise(NRF_USBD_EVENT_EP0DATADONE);
+				else {
+					gDataStatus |= 1u << (16 + n);
+					Raise(NRF_USBD_EVENT_DATAEP);
+					}
+				
+				return true;
+				}
+	
+	// stimulus: start of frame
+	static void	Frame(uint32_t frame) {
+				gFrame = frame & 0x7ff;
+				Raise(NRF_USBD_EVENT_SOF);
+				}
+	
+	// stimulus: bus reset, suspend and resume
+	static void	Reset() { Raise(NRF_USBD_EVENT_USBRESET); }
+	static void	Suspend() { gSuspended = true; Cause(NRF_USBD_EVENTCAUSE_SUSPEND_MASK); }
+	static void	Resume() { gSuspended = false; Cause(NRF_USBD_EVENTCAUSE_RESUME_MASK); }
+	};
+
+
+inline void nrf_usbd_enable() { USBDModel::gEnabled = true; USBDModel::gEventCause |= NRF_USBD_EVENTCAUSE_READY_MASK; }
+inline void nrf_usbd_pullup_enable() { USBDModel::gPullup = true; }
+inline void nrf_usbd_lowpower_enable() { USBDModel::gLowPower = true; }
+
+// leaving low power on a suspended bus is how remote wakeup starts
+inline void nrf_usbd_lowpower_disable()
+{
+const bool waking = USBDModel::gLowPower && USBDModel::gSuspended;
+USBDModel::gLowPower = false;
+
+if (waking) USBDModel::Cause(NRF_USBD_EVENTCAUSE_WUREQ_MASK);
+}
+
+inline bool nrf_usbd_event_check(nrf_usbd_event_t event) { return USBDModel::gEvents[event]; }
+inline void nrf_usbd_event_clear(nrf_usbd_event_t event) { USBDModel::gEvents[event] = false; }
+inline void nrf_usbd_int_enable(uint32_t mask) { USBDModel::gInterrupts |= mask; }
+inline void nrf_usbd_int_disable(uint32_t mask) { USBDModel::gInterrupts &= ~mask; }
+inline uint32_t nrf_usbd_eventcause_get() { return USBDModel::gEventCause; }
+inline void nrf_usbd_eventcause_clear(uint32_t mask) { USBDModel::gEventCause &= ~mask; }
+inline uint32_t nrf_usbd_epdatastatus_get() { return USBDModel::gDataStatus; }
+inline void nrf_usbd_epdatastatus_clear(uint32_t mask) { USBDModel::gDataStatus &= ~mask; }
+inline uint32_t nrf_usbd_framecntr_get() { return USBDModel::gFrame; }
+
+inline uint8_t nrf_usbd_setup_bmrequesttype_get() { return USBDModel::gSetup[0]; }
+inline uint8_t nrf_usbd_setup_brequest_get() { return USBDModel::gSetup[1]; }
+inline uint16_t nrf_usbd_setup_wvalue_get() { return USBDModel::gSetup[2] | USBDModel::gSetup[3] << 8; }
+inline uint16_t nrf_usbd_setup_windex_get() { return USBDModel::gSetup[4] | USBDModel::gSetup[5] << 8; }
+inline uint16_t nrf_usbd_setup_wlength_get() { return USBDModel::gSetup[6] | USBDModel::gSetup[7] << 8; }
+
+inline void nrf_usbd_ep_enable(uint8_t ep) { USBDModel::Of(ep).enabled = true; }
+inline size_t nrf_usbd_epout_size_get(uint8_t ep) { return USBDModel::Of(ep).data.size(); }
+inline void nrf_usbd_epout_clear(uint8_t ep) { USBDModel::Of(ep).data.clear(); USBDModel::Of(ep).ready = true; }
+
+// the pointer is uintptr_t here, rather than the nRF's uint32_t, for a 64-bit host
+inline void nrf_usbd_ep_easydma_set(
+	uint8_t		ep,
+	uintptr_t	pointer,
+	uint32_t	count
+	)
+{
+USBDModel::Of(ep).pointer = pointer;
+USBDModel::Of(ep).count = count;
+}
+
+inline void nrf_usbd_dpdmvalue_set(nrf_usbd_dpdmvalue_t) {}
+
+inline void nrf_usbd_task_trigger(
+	nrf_usbd_task_t	task
+	)
+{
+USBDModel::gTasks.push_back(task);
+
+switch (task) {
+	case NRF_USBD_TASK_STARTEPIN0:
+	case NRF_USBD_TASK_STARTEPIN1:
+	case NRF_USBD_TASK_STARTEPIN2:
+		USBDModel::Start(task - NRF_USBD_TASK_STARTEPIN0, true);
+		break;
+	
+	case NRF_USBD_TASK_STARTEPOUT0:
+	case NRF_USBD_TASK_STARTEPOUT1:
+	case NRF_USBD_TASK_STARTEPOUT2:
+		USBDModel::Start(task - NRF_USBD_TASK_STARTEPOUT0, false);
+		break;
+	
+	// allow the host to send an Endpoint 0 OUT packet
+	case NRF_USBD_TASK_EP0RCVOUT:
+		USBDModel::gOut[0].ready = true;
+		break;
+	
+	case NRF_USBD_TASK_EP0STATUS:
+		USBDModel::gStatus = USBDModel::kAcknowledged;
+		break;
+	
+	case NRF_USBD_TASK_EP0STALL:
+		USBDModel::gStatus = USBDModel::kStalled;
+		break;
+	
+	// resume signalling: the host resumes the bus
+	case NRF_USBD_TASK_DRIVEDPDM:
+		USBDModel::gSuspended = false;
+		USBDModel::gResumes++;
+		break;
+	
+	default:
+		break;
+	}
+}
@@ -0,0 +1,287 @@
+/*
+	panel
+	
+	The panel (firmware/Panel.cc) on the simulation HAL, against a model of the MAX6954 on the SPI bus
+	
+	Knob turns go in through the QDEC, key presses through the MAX's key registers and its IRQ.  What
+	comes out is checked on both sides: the display registers the MAX ends up with, and the words it took
+	to get there; and the reports sent to the host.
+*/
+
+#include <cstdio>
+#include <utility>
+
+#include "Channel.h"
+#include "HAL.h"
+#include "Panel.h"
+#include "check.h"
+
+
+/*	MAX
+	One MAX6954 on the bus
+	
+	Each 16-bit word is a register address, with the top bit set to read, and data.  A read's value is
+	clocked out during the next word.  The key debounce and pressed registers read differently from how they
+	are written; reading a debounce register clears it.
+*/
+static struct MAX {
+	uint8_t		fRegisters[128];
+	int		fRead = -1;		// register whose value goes out in the next word
+	uint32_t	fDebounced, fPressed;
+	unsigned	fWords, fDigitWrites;
+	
+	void		Word(const uint8_t *out, uint8_t *in);
+	} gMAX;
+
+
+/*	Word
+	One word through the shift register
+*/
+void MAX::Word(
+	const uint8_t	*const out,
+	uint8_t		*const in
+	)
+{
+fWords++;
+
+in[0] = 0;
+in[1] = 0;
+if (fRead >= 0x08 && fRead < 0x0c) {
+	const unsigned shift = 8 * (fRead - 0x08);
+	in[1] = fDebounced >> shift;
+	fDebounced &= ~(0xffu << shift);
+	}
+else if (fRead >= 0x0c && fRead < 0x10)
+	in[1] = fPressed >> 8 * (fRead - 0x0c);
+else if (fRead >= 0)
+	in[1] = fRegisters[fRead];
+
+const uint8_t registre = out[0] & 0x7f;
+if (out[0] & 0x80)
+	fRead = registre;
+else {
+	fRead = -1;
+	if (registre != 0) fRegisters[registre] = out[1];
+	if (registre >= 0x20 && registre < 0x30) fDigitWrites++;
+	}
+}
+
+
+/*	Displayed
+	The value shown on the display starting at the given digit, or ~0 if it isn't a value
+*/
+static unsigned Displayed(
+	uint8_t		base
+	)
+{
+unsigned value = 0;
+for (unsigned digit = 0; digit < 6; digit++) {
+	const uint8_t shown = gMAX.fRegisters[0x20 + base + digit];
+	
+	// the decimal point is after the third digit only
+	if ((shown & 0x80) != (digit == 2 ? 0x80 : 0) || (shown & 0x7f) > 9) return ~0u;
+	value = value * 10 + (shown & 0x7f);
+	}
+
+return value;
+}
+
+
+/*	Shows
+	Whether the display and the panel agree on the values, which are the given ones
+*/
+static bool Shows(
+	const Panel	&panel,
+	unsigned	value,
+	unsigned	valueStandby
+	)
+{
+return
+	panel.Value() == value && panel.ValueStandby() == valueStandby &&
+	Displayed(0) == value && Displayed(8) == valueStandby;
+}
+
+
+/*	Turn
+	Turn the QDEC's encoder some samples, a second after the last time, so there's no acceleration
+*/
+static void Turn(
+	Panel		&panel,
+	int32_t		samples
+	)
+{
+HAL::RTC::gNow += RTC::kFrequency;
+gMAX.fWords = gMAX.fDigitWrites = 0;
+HAL::QDEC::Turn(samples);
+panel.Run();
+}
+
+
+/*	Press
+	The MAX's debounce and pressed registers change and it interrupts
+*/
+static void Press(
+	Panel		&panel,
+	uint32_t	debounced,
+	uint32_t	pressed
+	)
+{
+gMAX.fDebounced = debounced;
+gMAX.fPressed = pressed;
+gMAX.fWords = gMAX.fDigitWrites = 0;
+HAL::GPIOTE::Trigger(0);
+panel.Run();
+}
+
+
+/*	gCrowding
+	An event comes in as the panel next reads the MAX
+*/
+static bool gCrowding;
+
+
+/*	Crowd
+	A QDEC report of so many samples, behind which the queue fills up just as the panel reads the keys
+*/
+static void Crowd(
+	Panel		&panel,
+	int32_t		samples
+	)
+{
+HAL::RTC::gNow += RTC::kFrequency;
+HAL::QDEC::Turn(samples);
+for (unsigned frame = 1; frame < 32; frame++)
+	(void) gEvents.Push({ Event::kUSBFrame, { .frame = frame } });
+
+gCrowding = true;
+panel.Run();
+}
+
+
+/*	main
+
+*/
+int main()
+{
+HAL::SPI::gDevice = [](const uint8_t *out, size_t outLength, uint8_t *in, size_t) {
+	for (size_t word = 0; word < outLength; word += 2)
+		gMAX.Word(out + word, in + word);
+	
+	if (std::exchange(gCrowding, false)) (void) gEvents.Push({ Event::kUSBFrame, {} });
+	};
+
+// set up the MAX, and show the default values
+Panel panel;
+CHECK(gMAX.fRegisters[0x01] == 0xff && gMAX.fRegisters[0x03] == 5 && gMAX.fRegisters[0x06] == 0x80);
+CHECK(gMAX.fRegisters[0x04] & 1 /* not shut down */);
+CHECK(Shows(panel, 121500, 122900));
+
+// the host sets the values; only the digits that changed are sent
+gMAX.fWords = gMAX.fDigitWrites = 0;
+panel.SetValue(121500, 122925);
+CHECK(Shows(panel, 121500, 122925));
+CHECK(gMAX.fDigitWrites == 2);
+CHECK(HAL::USBD::gReports.empty());
+
+// one detent is four samples, which may come in more than one report
+constexpr Channel::Band band = Panel::kBand;
+const uint16_t standby = Channel::Index(band, 122925);
+Turn(panel, 2);
+CHECK(Shows(panel, 121500, 122925) && HAL::USBD::gReports.empty());
+Turn(panel, 2);
+const unsigned coarse = Channel::Frequency(band, Channel::Step<band>(standby, Channel::kCoarse, 1));
+CHECK(Shows(panel, 121500, coarse));
+printf("coarse detent: %u words, %u digits written\n", gMAX.fWords, gMAX.fDigitWrites);
+CHECK(gMAX.fWords == 2 /* 'decimals' key */ + gMAX.fDigitWrites);
+
+// ... and is reported with its detent and the new values
+CHECK(HAL::USBD::gReports.size() == 1);
+const State::Values report = HAL::USBD::gReports.back();
+CHECK(report.delta == 1 && report.value == 121500 && report.valueStandby == coarse && report.time == HAL::RTC::Now());
+
+// the other way
+Turn(panel, -8);
+const unsigned down = Channel::Frequency(band, Channel::Step<band>(standby, Channel::kCoarse, -1));
+CHECK(Shows(panel, 121500, down));
+CHECK(HAL::USBD::gReports.size() == 2 && HAL::USBD::gReports.back().delta == -2);
+
+// with 'decimals' held, the same encoder turns the fine knob; the key is read as the knob turns
+const uint16_t before = Channel::Index(band, panel.ValueStandby());
+gMAX.fPressed = 1 << Panel::kKeyDecimals;
+Turn(panel, 4);
+const unsigned fine = Channel::Frequency(band, Channel::Step<band>(before, Channel::kFine, 1));
+CHECK(Shows(panel, 121500, fine));
+printf("fine detent: %u words, %u digits written\n", gMAX.fWords, gMAX.fDigitWrites);
+CHECK(HAL::USBD::gReports.back().keys == 1u << Panel::kKeyDecimals);
+
+// releasing it is noticed on the next read
+gMAX.fPressed = 0;
+Turn(panel, 4);
+CHECK(Shows(panel, 121500, Channel::Frequency(band, Channel::Step<band>(Channel::Index(band, fine), Channel::kCoarse, 1))));
+CHECK(HAL::USBD::gReports.back().keys == 0);
+
+// 'flip' swaps the values, and the key is reported going down and up
+const unsigned active = panel.Value(), other = panel.ValueStandby();
+size_t reports = HAL::USBD::gReports.size();
+Press(panel, 1 << Panel::kKeyFlip, 1 << Panel::kKeyFlip);
+CHECK(Shows(panel, other, active));
+CHECK(HAL::USBD::gReports.size() == reports + 1 && HAL::USBD::gReports.back().keys == 1u << Panel::kKeyFlip);
+// one sequence reads every key register, and only the digits that changed are written
+CHECK(gMAX.fWords == 9 + gMAX.fDigitWrites && gMAX.fDigitWrites <= 12);
+printf("flip: %u words, %u digits written\n", gMAX.fWords, gMAX.fDigitWrites);
+
+Press(panel, 0, 0);
+CHECK(Shows(panel, other, active));
+CHECK(HAL::USBD::gReports.size() == reports + 2 && HAL::USBD::gReports.back().keys == 0);
+
+// tapped and let go before the read: down and up, and flipped back
+reports = HAL::USBD::gReports.size();
+Press(panel, 1 << Panel::kKeyFlip, 0);
+CHECK(Shows(panel, active, other));
+CHECK(HAL::USBD::gReports.size() == reports + 2 && HAL::USBD::gReports.back().keys == 0);
+
+// another key is only reported
+reports = HAL::USBD::gReports.size();
+Press(panel, 1 << 20, 1 << 20);
+CHECK(Shows(panel, active, other));
+CHECK(gMAX.fDigitWrites == 0);
+CHECK(HAL::USBD::gReports.size() == reports + 1 && HAL::USBD::gReports.back().keys == 1u << 20);
+
+// every key held, then all tapped again before the next read with the queue nearly full of USB events:
+// up, down and up each, 96 edges from one event, and 'flip' down twice
+Press(panel, ~0u, ~0u);
+CHECK(Shows(panel, other, active));
+reports = HAL::USBD::gReports.size();
+const uint32_t overflows = gEvents.Overflows();
+for (unsigned frame = 0; frame < 30; frame++)
+	(void) gEvents.Push({ Event::kUSBFrame, { .frame = frame } });
+Press(panel, ~0u, 0);
+CHECK(gEvents.Overflows() == overflows);
+CHECK(HAL::USBD::gReports.size() == reports + 96 && HAL::USBD::gReports.back().keys == 0);
+CHECK(Shows(panel, active, other));
+
+// a turn with the keys as they were posts nothing for them, so doesn't overrun a queue that's filled up
+reports = HAL::USBD::gReports.size();
+uint32_t crowded = gEvents.Overflows();
+Crowd(panel, 4);
+CHECK(gEvents.Overflows() == crowded && HAL::USBD::gReports.size() == reports + 1);
+
+// a key gone down that the full queue can't take is posted on the next read
+gMAX.fPressed = 1 << 3;
+reports = HAL::USBD::gReports.size();
+Crowd(panel, 0);
+CHECK(gEvents.Overflows() == crowded + 1 && HAL::USBD::gReports.size() == reports);
+Turn(panel, 0);
+CHECK(HAL::USBD::gReports.size() == reports + 1 && HAL::USBD::gReports.back().keys == 1u << 3);
+gMAX.fPressed = 0;
+Turn(panel, 0);
+CHECK(HAL::USBD::gReports.size() == reports + 2 && HAL::USBD::gReports.back().keys == 0);
+
+// suspended, the display is shut down
+panel.Suspend();
+CHECK(!(gMAX.fRegisters[0x04] & 1));
+panel.Resume();
+CHECK(gMAX.fRegisters[0x04] & 1);
+
+return Checked("panel");
+}
@@ -0,0 +1,163 @@
+/*
+	persist
+	
+	Panel state in flash (firmware/Persist.cc) on the simulated flash pages
+	
+	Each reboot is a Load() from whatever the flash holds.  Power failing partway through a save is
+	simulated by letting only so many more erases and writes happen: the flash must then hold either the
+	state before or the one being saved, and the next save must work.
+*/
+
+#include <cstdio>
+
+#include "HAL.h"
+#include "Panel.h"
+#include "Persist.h"
+#include "check.h"
+
+
+/*	State
+	A distinct state for each number
+*/
+static Persist::Record Saved(
+	uint32_t	n
+	)
+{
+return { 118000 + 25 * (n % 760), 136975 - 25 * (n % 760), static_cast<uint8_t>(n % 3), static_cast<uint8_t>(n % 2) };
+}
+
+
+/*	Erase
+	Start from blank flash, as just programmed
+*/
+static void Erase()
+{
+std::fill(HAL::Flash::gWords.begin(), HAL::Flash::gWords.end(), 0xffffffff);
+std::fill_n(HAL::Flash::gErases, HAL::Flash::kPages, 0);
+HAL::Flash::gWritesLeft = SIZE_MAX;
+
+(void) Persist::Load();
+}
+
+
+/*	Interrupted
+	Power fails after 'writes' erases and writes of saving 'state' over 'before'; return whether the flash
+	then holds one of them, and takes the next save
+*/
+static bool Interrupted(
+	const Persist::Record &before,
+	const Persist::Record &state,
+	size_t		writes,
+	bool		&completed
+	)
+{
+HAL::Flash::gWritesLeft = writes;
+Persist::Save(state);
+HAL::Flash::gWritesLeft = SIZE_MAX;
+
+// reboot
+const std::optional<Persist::Record> loaded = Persist::Load();
+completed = loaded && *loaded == state;
+if (!loaded || !(completed || *loaded == before)) return false;
+
+// carries on
+const Persist::Record next = { 121500, 122900, 2, 1 };
+Persist::Save(next);
+return Persist::Load() == next;
+}
+
+
+/*	main
+
+*/
+int main()
+{
+const size_t records = Persist::Records();
+CHECK(records == (HAL::Flash::kPageWords - 1) / Persist::kRecordWords);
+
+// blank flash has nothing
+Erase();
+CHECK(!Persist::Load());
+
+// saved, and found after a reboot
+Persist::Save(Saved(1));
+CHECK(Persist::Load() == Saved(1));
+
+// saving the same again doesn't write
+const std::vector<uint32_t> flash = HAL::Flash::gWords;
+Persist::Save(Saved(1));
+CHECK(HAL::Flash::gWords == flash);
+
+// records append until the page fills, then the other page takes over
+for (uint32_t n = 2; n <= records; n++) Persist::Save(Saved(n));
+CHECK(HAL::Flash::gErases[0] == 1 && HAL::Flash::gErases[1] == 0);
+CHECK(Persist::Load() == Saved(records));
+Persist::Save(Saved(records + 1));
+CHECK(HAL::Flash::gErases[1] == 1);
+CHECK(Persist::Load() == Saved(records + 1));
+
+// the pages take turns, so wear evenly
+Erase();
+for (uint32_t n = 0; n < 10 * records; n++) {
+	Persist::Save(Saved(n));
+	
+	// sometimes rebooting in between
+	if (n % 97 == 0) (void) Persist::Load();
+	}
+CHECK(Persist::Load() == Saved(10 * records - 1));
+CHECK(HAL::Flash::gErases[0] == 5 && HAL::Flash::gErases[1] == 5);
+printf("%zu records per page; %zu saves erased the pages %u and %u times\n", records, 10 * records, HAL::Flash::gErases[0], HAL::Flash::gErases[1]);
+
+// power failing at every point of a save into the same page, and of one that starts the other page
+for (const bool switching : { false, true }) {
+	unsigned completions = 0, writes = 0;
+	
+	for (size_t cut = 0; cut <= Persist::kRecordWords + 2; cut++) {
+		Erase();
+		
+		// leave the current page full, or with room
+		const uint32_t saves = switching ? records : 3;
+		for (uint32_t n = 0; n < saves; n++) Persist::Save(Saved(n));
+		
+		bool completed;
+		CHECK(Interrupted(Saved(saves - 1), Saved(1000), cut, completed));
+		
+		// a save completes only once its last write is done
+		if (completed) completions++; else writes = cut + 1;
+		}
+	
+	// writes per save: the record and its check word, and for a new page its erase and generation too
+	CHECK(writes == (switching ? Persist::kRecordWords + 2 : Persist::kRecordWords));
+	CHECK(completions == Persist::kRecordWords + 3 - writes);
+	}
+
+// the panel shows the saved state as it starts, before the host is there
+Erase();
+Persist::Save({ 118000, 136975, 0, 0 });
+{
+	Panel panel;
+	CHECK(panel.Value() == 118000 && panel.ValueStandby() == 136975 && panel.AccelerationCurve() == 0);
+	
+	// and saves a change only once it has been quiet for a while
+	HAL::RTC::Alarm(0);
+	panel.SetValue(121500, 122900);
+	HAL::RTC::Advance(Panel::kQuietTicks - 1);
+	panel.Run();
+	CHECK(Persist::Load()->value == 118000);
+	
+	// ... which a further change puts off
+	panel.SetValue(121525, 122900);
+	HAL::RTC::Advance(Panel::kQuietTicks - 1);
+	panel.Run();
+	CHECK(Persist::Load()->value == 118000);
+	
+	HAL::RTC::Advance(1);
+	panel.Run();
+	CHECK(Persist::Load()->value == 121525);
+	}
+
+Panel rebooted;
+CHECK(rebooted.Value() == 121525 && rebooted.ValueStandby() == 122900);
+
+return Checked("persist");
+}
@@ -0,0 +1,73 @@
+/*
+	profile
+	
+	Cycle count probes (firmware/Profile.cc) on the simulated cycle counter, decoded as the host does
+	(host/profile.cc)
+*/
+
+#include "HAL.h"
+#include "Profile.h"
+#include "check.h"
+#include "profile.h"
+
+
+/*	Probe
+	Spend the given cycles in a probe
+*/
+static void Probe(
+	uint32_t	cycles
+	)
+{
+PROFILE(kUpdateDisplay);
+HAL::Cycles::Advance(cycles);
+}
+
+
+/*	main
+
+*/
+int main()
+{
+Profile::Start();
+Profile::Reset();
+
+// a probe that never ran
+const Profile::Statistics &never = Profile::Probed(Profile::kUSBSetup0);
+CHECK(never.count == 0 && never.minimum == UINT32_MAX && never.maximum == 0 && never.total == 0);
+
+// minimum, maximum, count and total
+for (const uint32_t cycles : { 100u, 250u, 50u })
+	Probe(cycles);
+const Profile::Statistics &display = Profile::Probed(Profile::kUpdateDisplay);
+CHECK(display.count == 3 && display.minimum == 50 && display.maximum == 250 && display.total == 400);
+
+// the counter wrapping around in a probe
+HAL::Cycles::gNow = UINT32_MAX - 10;
+Probe(30);
+CHECK(display.count == 4 && display.minimum == 30 && display.total == 430);
+
+// the total outgrows 32 bits
+for (unsigned i = 0; i < 3; i++) Profile::Record(Profile::kStepChannel, 0xf0000000);
+CHECK(Profile::Probed(Profile::kStepChannel).total == 3 * 0xf0000000ull);
+
+// encoded, and decoded by the host
+uint8_t encoded[Profile::kEncoded];
+CHECK(Profile::Encode(encoded) == sizeof encoded);
+
+const std::vector<ProbeStatistics> decoded = DecodeProfile(encoded, sizeof encoded);
+CHECK(decoded.size() == Profile::kProbes);
+for (unsigned probe = 0; probe < decoded.size(); probe++) {
+	const Profile::Statistics &statistics = Profile::Probed(static_cast<Profile::Probe>(probe));
+	CHECK(decoded[probe].minimum == statistics.minimum && decoded[probe].maximum == statistics.maximum);
+	CHECK(decoded[probe].count == statistics.count && decoded[probe].total == statistics.total);
+	}
+
+// a short report only has whole probes
+CHECK(DecodeProfile(encoded, Profile::kEncodedStatistics + 3).size() == 1);
+
+// reset
+Profile::Reset();
+CHECK(Profile::Probed(Profile::kUpdateDisplay).count == 0);
+
+return Checked("profile");
+}
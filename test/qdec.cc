@@ -0,0 +1,138 @@
+/*
+	qdec
+
+	The hardware quadrature decoder's interrupt handler and sampling modes (firmware/QDEC.cc), on the
+	simulation HAL's model of SAMPLEPER, REPORTPER and ACC
+
+	Switching modes must set both periods and carry a partial count over into the next report.  Each report
+	records how long after the first sample showing movement it came, against the mode's latency probe;
+	low-latency mode must report within a sample.  Also reports the mean latency in either mode.
+*/
+
+#include <cstdio>
+#include <vector>
+
+#include "Event.h"
+#include "HAL.h"
+#include "Profile.h"
+#include "QDEC.h"
+#include "check.h"
+#include "profile.h"
+
+
+/*	Reported
+	Take the decoder's reports off the event queue: the steps reported, and how many reports
+*/
+static unsigned Reported(
+	int32_t		&steps
+	)
+{
+unsigned reports = 0;
+while (const std::optional<Event> event = gEvents.Pop())
+	if (event->type == Event::kQDECReport && event->encoder == 0) {
+		steps += event->accumulator;
+		reports++;
+		}
+
+return reports;
+}
+
+
+/*	Detents
+	Turn the knob a detent at a time, resting a varying number of samples after each; return the steps reported
+*/
+static int32_t Detents(
+	unsigned	detents,
+	unsigned	&reports
+	)
+{
+int32_t steps = 0;
+reports = 0;
+for (unsigned detent = 0; detent < detents; detent++) {
+	HAL::QDEC::Step(1);
+	for (unsigned rest = detent % 23; rest > 0; rest--)
+		HAL::QDEC::Step(0);
+
+	reports += Reported(steps);
+	}
+
+// rest long enough for the last report
+for (unsigned rest = 0; rest < 10; rest++)
+	HAL::QDEC::Step(0);
+reports += Reported(steps);
+
+return steps;
+}
+
+
+/*	main
+	Turn the knob in either mode, and switch between them with a partial count pending
+*/
+int main()
+{
+static constexpr unsigned kDetents = 1000;
+static constexpr double kTick = 1e3 / 32768 /* ms */;
+
+Profile::Reset();
+QDEC qdec(HAL::Pin(1, 4), HAL::Pin(1, 6));
+
+// powers up in normal mode
+CHECK(qdec.Sampling() == QDEC::kNormal);
+CHECK(!HAL::QDEC::gLowLatency && HAL::QDEC::gSamplePeriod == 2048 && HAL::QDEC::gReportPeriod == 10);
+CHECK(HAL::QDEC::gSampleInterrupt);
+
+// every detent reported, some of them together
+unsigned reports;
+CHECK(Detents(kDetents, reports) == kDetents);
+CHECK(reports > 0 && reports < kDetents);
+const Profile::Statistics normal = Profile::Probed(Profile::kQDECLatency);
+CHECK(normal.count == reports && Profile::Probed(Profile::kQDECLatencyLow).count == 0);
+
+// a report comes within 10 samples of the first movement, and at once on the 10th
+CHECK(normal.minimum == 0 && normal.maximum <= 9 * 2048 * 32768 / 1000000 + 1);
+
+// a partial count isn't lost in the switch, and comes with the first low-latency report
+HAL::QDEC::Step(1);
+HAL::QDEC::Step(-1);
+HAL::QDEC::Step(1);
+HAL::QDEC::Step(1);
+int32_t steps = 0;
+CHECK(Reported(steps) == 0);
+
+qdec.Sampling(QDEC::kLowLatency);
+CHECK(qdec.Sampling() == QDEC::kLowLatency);
+CHECK(HAL::QDEC::gLowLatency && HAL::QDEC::gSamplePeriod == 512 && HAL::QDEC::gReportPeriod == 1);
+
+HAL::QDEC::Step(0);
+CHECK(Reported(steps) == 1 && steps == 2);
+
+// switching to the mode it's already in changes nothing
+qdec.Sampling(QDEC::kLowLatency);
+CHECK(HAL::QDEC::gReportPeriod == 1);
+
+// every detent a report of its own, without waiting for another sample
+Profile::Reset();
+CHECK(Detents(kDetents, reports) == kDetents);
+CHECK(reports == kDetents);
+const Profile::Statistics low = Profile::Probed(Profile::kQDECLatencyLow);
+CHECK(low.count == kDetents && low.maximum < 512 * 32768 / 1000000 + 1);
+CHECK(Profile::Probed(Profile::kQDECLatency).count == 0);
+
+// and back: the report period is long again
+qdec.Sampling(QDEC::kNormal);
+CHECK(!HAL::QDEC::gLowLatency && HAL::QDEC::gSamplePeriod == 2048 && HAL::QDEC::gReportPeriod == 10);
+HAL::QDEC::Step(1);
+CHECK(Reported(steps) == 0);
+
+// the host sees the probes as the profile report carries them
+uint8_t encoded[Profile::kEncoded];
+const std::vector<ProbeStatistics> decoded = DecodeProfile(encoded, Profile::Encode(encoded));
+CHECK(decoded.size() == Profile::kProbes);
+CHECK(decoded.size() == Profile::kProbes && decoded[Profile::kQDECLatencyLow].count == kDetents &&
+	decoded[Profile::kQDECLatencyLow].maximum == low.maximum);
+
+printf("mean latency: %.2f ms normal, %.2f ms low latency\n",
+	normal.total * kTick / normal.count, low.total * kTick / low.count);
+
+return Checked("qdec");
+}
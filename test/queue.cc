@@ -0,0 +1,127 @@
+/*
+	queue
+	
+	Stress test of the interrupt-to-event-loop queue (firmware/Queue.h)
+	
+	Producer threads stand in for interrupt handlers, pushing as fast as they can while one consumer pops.
+	Every element is numbered per producer, and every producer remembers which of its pushes the queue
+	took.  The consumer must see exactly those, each producer's in the order pushed, and the queue's count
+	of overflows must account for every other.
+*/
+
+#include <thread>
+#include <vector>
+
+#include "../firmware/Queue.h"
+#include "check.h"
+
+
+/*	Element
+	What a producer pushes
+*/
+struct Element {
+	uint16_t	producer;
+	uint32_t	number;		// pushes by this producer before this one
+	};
+
+
+/*	Stress
+	Run producers against one consumer
+	
+	Each producer spins for a while between pushes, as interrupts are spaced out; the consumer yields every
+	so often, so the queue also fills up.
+*/
+template <unsigned qSize>
+static void Stress(
+	unsigned	producers,
+	uint32_t	pushes,
+	unsigned	spacing,
+	unsigned	pauseEvery
+	)
+{
+Queue<Element, qSize> queue;
+
+std::vector<std::vector<bool>> accepted(producers, std::vector<bool>(pushes));
+std::vector<std::thread> threads;
+for (unsigned p = 0; p < producers; p++)
+	threads.emplace_back([&queue, &accepted, p, pushes, spacing] {
+		for (uint32_t n = 0; n < pushes; n++) {
+			accepted[p][n] = queue.Push({ static_cast<uint16_t>(p), n });
+			for (volatile unsigned i = 0; i < spacing; i++) {}
+			
+			// let the others run, on a machine with fewer cores than threads
+			if (n % 8 == 7) std::this_thread::yield();
+			}
+		});
+
+// consume until every producer is done and the queue is empty
+std::vector<std::vector<bool>> popped(producers, std::vector<bool>(pushes));
+std::vector<int64_t> last(producers, -1);
+bool ordered = true, known = true;
+unsigned long pops = 0;
+
+const auto consume = [&] {
+	while (const std::optional<Element> element = queue.Pop()) {
+		pops++;
+		if (element->producer >= producers || element->number >= pushes) {
+			known = false;
+			continue;
+			}
+		
+		ordered &= element->number > last[element->producer];
+		last[element->producer] = element->number;
+		popped[element->producer][element->number] = true;
+		
+		if (pauseEvery && pops % pauseEvery == 0) std::this_thread::yield();
+		}
+	};
+
+// every push is either in the queue or counted as an overflow, so keep popping until they all are
+const unsigned long total = static_cast<unsigned long>(producers) * pushes;
+while (pops + queue.Overflows() < total) {
+	consume();
+	std::this_thread::yield();
+	}
+
+for (std::thread &thread : threads) thread.join();
+consume();
+
+// every push the queue took was popped, in order, and none it dropped
+unsigned long taken = 0;
+for (unsigned p = 0; p < producers; p++)
+	for (uint32_t n = 0; n < pushes; n++)
+		taken += accepted[p][n];
+
+CHECK(known);
+CHECK(ordered);
+CHECK(popped == accepted);
+CHECK(pops == taken);
+CHECK(pops + queue.Overflows() == total);
+
+printf("%u producers, %u slots, spaced %u: %lu popped, %u overflowed\n", producers, qSize, spacing, pops, queue.Overflows());
+}
+
+
+/*	main
+	Small queues overflow often; a large one with a fast consumer hardly ever
+*/
+int main()
+{
+Stress<32>(4, 50000, 100, 64);
+Stress<32>(8, 25000, 100, 16);
+Stress<4>(3, 50000, 50, 1);
+Stress<1024>(2, 200000, 0, 0);
+
+// single-threaded: fill, overflow by one, then drain in order
+Queue<Element, 8> queue;
+for (uint32_t n = 0; n < 8; n++) CHECK(queue.Push({ 0, n }));
+CHECK(!queue.Push({ 0, 8 }));
+CHECK(queue.Overflows() == 1);
+for (uint32_t n = 0; n < 8; n++) {
+	const std::optional<Element> element = queue.Pop();
+	CHECK(element && element->number == n);
+	}
+CHECK(!queue.Pop());
+
+return Checked("queue");
+}
@@ -0,0 +1,253 @@
+/*
+	shared
+
+	The panel server's sequence lock and request socket (host/shared.cc), with several clients at once
+
+	First a writer publishes as fast as it can while readers copy snapshots: every snapshot must be one
+	that was published whole.  Then the test stands in for the server (host/server.cc) in front of the
+	emulated panel: clients send it requests on the socket, which it passes on as Output reports, and read
+	what it publishes of the panel's state reports while the encoder turns.
+*/
+
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <thread>
+
+#include "emulator.h"
+#include "shared.h"
+
+
+/*	Snapshot
+	State whose every field follows from its update count, so a torn copy shows
+*/
+static SharedState Snapshot(
+	uint32_t	updates
+	)
+{
+SharedState state = {};
+state.updates = updates;
+state.connected = updates & 1;
+state.sequence = static_cast<uint16_t>(updates);
+state.delta = static_cast<int16_t>(updates * 7);
+state.keys = updates * 3;
+state.time = updates * 5;
+state.pages = updates % State::kPagesMaximum + 1;
+for (unsigned page = 0; page < State::kPagesMaximum; page++)
+	for (unsigned i = 0; i < 2; i++)
+		state.values[page][i] = updates + 2 * page + i;
+
+return state;
+}
+
+
+/*	Same
+	Whether two snapshots are of the same state
+*/
+static bool Same(
+	const SharedState &a,
+	const SharedState &b
+	)
+{
+if (a.updates != b.updates || a.connected != b.connected || a.sequence != b.sequence || a.delta != b.delta
+	|| a.keys != b.keys || a.time != b.time || a.pages != b.pages)
+	return false;
+
+for (unsigned page = 0; page < State::kPagesMaximum; page++)
+	for (unsigned i = 0; i < 2; i++)
+		if (a.values[page][i] != b.values[page][i]) return false;
+
+return true;
+}
+
+
+/*	Reader
+	What one reader thread saw
+*/
+struct Reader {
+	uint32_t	reads = 0,
+			torn = 0,	// snapshots that weren't any one published
+			backwards = 0;	// snapshots older than one read before
+	SharedState	last = {};
+	};
+
+
+/*	Stress
+	Publish 'updates' snapshots as fast as possible while 'readers' threads copy them
+*/
+static void Stress(
+	unsigned	readers,
+	uint32_t	updates
+	)
+{
+static SharedPanel shared;
+shared.Publish(Snapshot(0));
+
+std::atomic<bool> stop = false;
+std::atomic<unsigned> running = 0;
+std::vector<Reader> seen(readers);
+std::vector<std::thread> threads;
+for (Reader &reader : seen)
+	threads.emplace_back([&reader, &stop, &running] {
+		running++;
+		for (bool last = false; !last;) {
+			last = stop.load(std::memory_order_acquire);
+
+			const SharedState state = shared.Read();
+			reader.reads++;
+			if (!Same(state, Snapshot(state.updates))) reader.torn++;
+			else if (state.updates < reader.last.updates) reader.backwards++;
+			reader.last = state;
+			}
+		});
+
+// once every reader is reading
+while (running < readers) std::this_thread::yield();
+for (uint32_t update = 1; update <= updates; update++)
+	shared.Publish(Snapshot(update));
+stop.store(true, std::memory_order_release);
+
+for (std::thread &thread : threads)
+	thread.join();
+
+for (const Reader &reader : seen)
+	CHECK(reader.reads > 1 && reader.torn == 0 && reader.backwards == 0 && Same(reader.last, Snapshot(updates)));
+}
+
+
+/*	Listen
+	Listen on the request socket, as the server does
+*/
+static int Listen()
+{
+const int s = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+
+sockaddr_un address = {};
+address.sun_family = AF_UNIX;
+const std::string path = SharedSocketPath();
+path.copy(address.sun_path, sizeof address.sun_path - 1);
+
+CHECK(s >= 0 && bind(s, reinterpret_cast<const sockaddr*>(&address), sizeof address) == 0 && listen(s, 8) == 0);
+
+return s;
+}
+
+
+/*	Serve
+	Stand in for the server, with the emulated panel as its device
+
+	Each client asks for values to be shown, then reads what is published until told to stop; its last read
+	must be the last state published.  Every snapshot read must be one the server published.
+*/
+static void Serve(
+	unsigned	clients,
+	unsigned	turns
+	)
+{
+// a socket of our own, away from any real server's
+char directory[] = "/tmp/xplanepanel-XXXXXX";
+CHECK(mkdtemp(directory));
+setenv("XDG_RUNTIME_DIR", directory, 1);
+const int listener = Listen();
+
+static SharedPanel shared;
+SharedState state = {};
+state.connected = true;
+std::vector<SharedState> published(turns + 1);
+published[0] = state;
+shared.Publish(state);
+
+// the clients
+std::atomic<bool> stop = false;
+std::vector<Reader> seen(clients);
+std::vector<std::thread> threads;
+for (unsigned client = 0; client < clients; client++)
+	threads.emplace_back([client, &reader = seen[client], &published, &stop] {
+		SharedPanelWriter writer;
+		writer.Set(118000 + 25 * client, 136975);
+
+		for (bool last = false; !last;) {
+			// told to stop after the last publication, so this read has it
+			last = stop.load(std::memory_order_acquire);
+
+			const SharedState state = shared.Read();
+			reader.reads++;
+			if (state.updates >= published.size() || !Same(state, published[state.updates])) reader.torn++;
+			else if (state.updates < reader.last.updates) reader.backwards++;
+			reader.last = state;
+			}
+		});
+
+// each client's request becomes an Output report to the panel
+std::vector<int> connections;
+for (unsigned client = 0; client < clients; client++) {
+	const int connection = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+	connections.push_back(connection);
+
+	SharedRequest request;
+	CHECK(recv(connection, &request, sizeof request, 0) == sizeof request && request.command == SharedRequest::kSet);
+
+	unsigned char report[kPanelReportLength];
+	EncodePanelReport(report, 1 /* kReportPanel */, request.value, request.valueStandby);
+	CHECK(USBDModel::Out(1, { report, report + sizeof report }));
+	Settle();
+	CHECK(gPanel->Value() == request.value && gPanel->ValueStandby() == request.valueStandby);
+	}
+
+// and every state report the panel sends is published
+for (unsigned turn = 1; turn <= turns; turn++) {
+	HAL::QDEC::Turn(turn % 3 ? 4 : -8);
+	Settle();
+
+	const std::optional<std::vector<uint8_t>> report = USBDModel::In(1);
+	if (!CHECK(report && (*report)[0] == 5 /* kReportState */)) break;
+	Settle();
+
+	const uint16_t sequence = state.sequence;
+	state.Update(DecodeStateReport(report->data(), report->size()));
+	CHECK(turn == 1 || state.sequence == static_cast<uint16_t>(sequence + 1));
+	CHECK(state.delta == (turn % 3 ? 1 : -2));
+
+	state.updates = turn;
+	published[turn] = state;
+	shared.Publish(state);
+	}
+stop.store(true, std::memory_order_release);
+
+for (std::thread &thread : threads)
+	thread.join();
+
+unsigned reads = 0;
+for (const Reader &reader : seen) {
+	CHECK(reader.torn == 0 && reader.backwards == 0);
+	CHECK(Same(reader.last, published[turns]));
+	reads += reader.reads;
+	}
+printf("%u clients read %u snapshots of %u published\n", clients, reads, turns);
+
+for (const int connection : connections)
+	close(connection);
+close(listener);
+unlink(SharedSocketPath().c_str());
+rmdir(directory);
+}
+
+
+/*	main
+	Stress the sequence lock, then serve the emulated panel
+*/
+int main()
+{
+Stress(1, 100000);
+Stress(4, 1000000);
+
+Panel panel;
+PowerUp(panel);
+CHECK(Configure());
+Serve(3, 300);
+
+return Checked("shared");
+}
@@ -0,0 +1,141 @@
+/*
+	softqdec
+
+	The GPIOTE, PPI and TIMER quadrature decoders (firmware/SoftQDEC.cc) on edge traces of a knob, on the
+	simulation HAL's model of the PPI wiring
+
+	Clean turns are reported a detent at a time.  Contacts bouncing, and edges too short for GPIOTE to see
+	in any phase of a detent either way, must leave what was reported adding up to where the knob really
+	is once it rests in a detent; an unseen edge must be resynchronized and logged.
+*/
+
+#include "Event.h"
+#include "HAL.h"
+#include "Log.h"
+#include "SoftQDEC.h"
+#include "check.h"
+
+
+/*	Knob
+	An encoder on a decoder's pins, resting in a detent to start with
+*/
+struct Knob {
+	const unsigned	fInstance;
+	int32_t		fPosition = 0;	// edges forward
+
+	/*	Edge
+		Move one edge either way; GPIOTE may not see it
+
+		Forward, pin A changes from an even phase and pin B from an odd one; backward is the reverse.
+	*/
+	void		Edge(bool forward, bool seen = true) {
+				const unsigned phase = static_cast<uint32_t>(fPosition) % SoftQDEC::kEdges;
+				HAL::SoftQDEC::Edge(fInstance, forward ? phase % 2 : phase % 2 == 0, seen);
+				fPosition += forward ? 1 : -1;
+				}
+
+	void		Turn(int32_t edges) {
+				for (; edges > 0; edges--) Edge(true);
+				for (; edges < 0; edges++) Edge(false);
+				}
+	};
+
+
+/*	Reported
+	Take the decoders' reports off the event queue: the edges reported, per decoder, and how many reports
+*/
+static unsigned Reported(
+	int32_t		(&edges)[SoftQDEC::kInstances]
+	)
+{
+unsigned reports = 0;
+while (const std::optional<Event> event = gEvents.Pop())
+	if (event->type == Event::kQDECReport && event->encoder >= 1 && event->encoder <= SoftQDEC::kInstances) {
+		edges[event->encoder - 1] += event->accumulator;
+		reports++;
+		}
+
+return reports;
+}
+
+
+/*	Resyncs
+	Take the records out of the log; return how many are of a decoder resynchronizing
+*/
+static unsigned Resyncs()
+{
+uint8_t records[64 * Log::kEncodedRecord];
+uint16_t dropped;
+const size_t length = Log::Encode(records, sizeof records, dropped);
+
+unsigned resyncs = 0;
+for (size_t record = 0; record < length; record += Log::kEncodedRecord)
+	resyncs += (records[record + 4] | records[record + 5] << 8) == Log::kLogEncoderResync;
+
+return resyncs;
+}
+
+
+/*	main
+	Turn knobs on both decoders
+*/
+int main()
+{
+const SoftQDEC decoders[] = { { 0, 0, 1 }, { 1, 2, 3 } };
+(void) decoders;
+Knob knobs[] = { { 0 }, { 1 } };
+int32_t edges[SoftQDEC::kInstances] = {};
+(void) Resyncs();
+
+// clean turns, a report a detent
+knobs[0].Turn(10 * SoftQDEC::kEdges);
+CHECK(Reported(edges) == 10 && edges[0] == knobs[0].fPosition && edges[1] == 0);
+knobs[0].Turn(-3 * SoftQDEC::kEdges);
+CHECK(Reported(edges) == 3 && edges[0] == knobs[0].fPosition);
+
+// the other decoder on its own
+knobs[1].Turn(-5 * SoftQDEC::kEdges);
+CHECK(Reported(edges) == 5 && edges[1] == -20 && edges[0] == knobs[0].fPosition);
+
+// bouncing at every phase, either way, settling into the next detent or back into this one
+for (const bool forward : { true, false })
+	for (int32_t into = 0; into < SoftQDEC::kEdges; into++)
+		for (const bool back : { true, false }) {
+			Knob &knob = knobs[0];
+			knob.Turn(forward ? into : -into);
+			for (unsigned bounce = 0; bounce < 5; bounce++) {
+				knob.Edge(forward);
+				knob.Edge(!forward);
+				}
+			knob.Turn(back ? (forward ? -into : into) : (forward ? SoftQDEC::kEdges - into : into - SoftQDEC::kEdges));
+			Reported(edges);
+			CHECK(edges[0] == knob.fPosition);
+			}
+CHECK(Resyncs() == 0);
+
+// an edge GPIOTE doesn't see, at every phase either way, and turning on for a while before resting
+for (const bool forward : { true, false })
+	for (int32_t into = 0; into < SoftQDEC::kEdges; into++)
+		for (const int32_t after : { 1, 2, 3, 4, 7, 8 * SoftQDEC::kEdges }) {
+			Knob &knob = knobs[1];
+			knob.Turn(forward ? into : -into);
+			knob.Edge(forward, false);
+
+			// on into a detent
+			const int32_t rest = forward ? (knob.fPosition + after + SoftQDEC::kEdges - 1) & ~(SoftQDEC::kEdges - 1) : (knob.fPosition - after) & ~(SoftQDEC::kEdges - 1);
+			knob.Turn(rest - knob.fPosition);
+			Reported(edges);
+			if (!CHECK(edges[1] == knob.fPosition && Resyncs() == 1))
+				fprintf(stderr, "forward %d, %d edges into the detent, %d after\n", forward, into, after);
+			}
+
+// a glitch too short for either edge to be seen leaves nothing to put right
+knobs[0].Turn(2);
+HAL::SoftQDEC::Edge(0, false, false);
+HAL::SoftQDEC::Edge(0, false, false);
+knobs[0].Turn(2 + 3 * SoftQDEC::kEdges);
+Reported(edges);
+CHECK(edges[0] == knobs[0].fPosition && Resyncs() == 0);
+
+return Checked("softqdec");
+}
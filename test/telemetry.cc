@@ -0,0 +1,183 @@
+/*
+	telemetry
+
+	The plugin's connection telemetry (host/telemetry.cc), published through xplane.h's datarefs in the
+	headless X-Plane harness (test/xplm), and read back as another plugin would
+
+	A flight loop does what the plugin's does with a panel on the bridge: trade COM1 with it, and update
+	the telemetry from its statistics.  A local stand-in forwarder sends it state datagrams.
+*/
+
+#include "xplm/harness.h"
+
+#include "forwarder.h"
+#include "telemetry.h"
+#include "xplane.h"
+
+
+/*	Radio
+	COM1 in X-Plane, as datarefs another plugin can write
+*/
+struct Radio {
+	int		fMain = 118000,
+			fStandby = 136975;
+
+	static int	Read(void *value) { return *static_cast<int*>(value); }
+	static void	Write(void *value, int to) { *static_cast<int*>(value) = to; }
+
+	static XPLMDataRef Register(const char *name, int &value) {
+				return XPLMRegisterDataAccessor(name, xplmType_Int, 1, Read, Write, nullptr, nullptr, nullptr, nullptr,
+					nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, &value, &value);
+				}
+
+			Radio() {
+				Register("sim/cockpit2/radios/actuators/com1_frequency_hz_833", fMain);
+				Register("sim/cockpit2/radios/actuators/com1_standby_frequency_hz_833", fStandby);
+				}
+	};
+
+
+/*	Callback
+	The plugin's flight loop, with a panel on the bridge
+*/
+struct Callback : public XPlaneFlightLoop<Callback> {
+protected:
+	RemotePanel	&fRemote;
+	Telemetry	&fTelemetry;
+	XPLMDataRef	fMain,
+			fStandby;
+
+public:
+	static constexpr float gPollingInterval = +.1f;
+
+			Callback(RemotePanel &remote, Telemetry &telemetry) :
+				XPlaneFlightLoop<Callback>(xplm_FlightLoop_Phase_AfterFlightModel),
+				fRemote(remote),
+				fTelemetry(telemetry),
+				fMain(XPLMFindDataRef("sim/cockpit2/radios/actuators/com1_frequency_hz_833")),
+				fStandby(XPLMFindDataRef("sim/cockpit2/radios/actuators/com1_standby_frequency_hz_833"))
+				{}
+
+	float		operator()(float elapsedSinceLastCall, float, int);
+	};
+
+
+/*	()
+	Trade COM1 with the panel, and publish how the bridge is doing
+*/
+float Callback::operator()(
+	float		elapsedSinceLastCall,
+	float,
+	int
+	)
+{
+if (fRemote.Set(XPLMGetDatai(fMain), XPLMGetDatai(fStandby))) {
+	XPLMSetDatai(fMain, fRemote.Value0());
+	XPLMSetDatai(fStandby, fRemote.Value1());
+	}
+
+if (fRemote.Connected()) {
+	const BridgeStatistics &statistics = fRemote.Statistics();
+	fTelemetry.Update(Telemetry::kBridge, statistics.datagrams, statistics.stale, statistics.roundTrips, statistics.roundTripTotal, elapsedSinceLastCall);
+	}
+else
+	fTelemetry.Update(Telemetry::kSearching, 0, 0, 0, 0, elapsedSinceLastCall);
+
+return gPollingInterval;
+}
+
+
+/*	TelemetryDataRefs
+	The datarefs, as the plugin registers them
+*/
+struct TelemetryDataRefs {
+	XPlaneDataRef<int> fConnection,
+			fReports,
+			fStale;
+	XPlaneDataRef<float> fReportRate,
+			fRoundTrip;
+
+			TelemetryDataRefs(const Telemetry &telemetry) :
+				fConnection("xplanepanel/connection", telemetry.connection),
+				fReports("xplanepanel/reports", telemetry.reports),
+				fStale("xplanepanel/stale", telemetry.stale),
+				fReportRate("xplanepanel/report_rate", telemetry.reportRate),
+				fRoundTrip("xplanepanel/round_trip_ms", telemetry.roundTrip)
+				{}
+	};
+
+
+/*	main
+	Load the plugin's parts, fly with the panel on the bridge, and watch the datarefs
+*/
+int main()
+{
+Radio radio;
+Telemetry telemetry;
+std::optional<TelemetryDataRefs> dataRefs(telemetry);
+RemotePanel remote(kPort);
+Callback callback(remote, telemetry);
+callback.Schedule(Callback::gPollingInterval, true);
+
+// what another plugin sees
+const XPLMDataRef
+	connection = XPLMFindDataRef("xplanepanel/connection"),
+	reports = XPLMFindDataRef("xplanepanel/reports"),
+	stale = XPLMFindDataRef("xplanepanel/stale"),
+	reportRate = XPLMFindDataRef("xplanepanel/report_rate"),
+	roundTrip = XPLMFindDataRef("xplanepanel/round_trip_ms");
+CHECK(connection && reports && stale && reportRate && roundTrip);
+CHECK(XPLMGetDataRefTypes(connection) == xplmType_Int && XPLMGetDataRefTypes(reportRate) == xplmType_Float);
+
+// nothing on the bridge yet
+Harness::Fly(.5f);
+CHECK(XPLMGetDatai(connection) == Telemetry::kSearching && XPLMGetDatai(reports) == 0 && XPLMGetDataf(reportRate) == 0);
+
+// ten state datagrams every flight loop, and the panel turned now and then
+Forwarder forwarder;
+for (unsigned loop = 0; loop < 20; loop++) {
+	for (unsigned n = 0; n < 10; n++)
+		forwarder.Send(121500 + 25 * (loop / 5), 136975, n == 0);
+	Harness::Fly(Callback::gPollingInterval);
+	}
+CHECK(XPLMGetDatai(connection) == Telemetry::kBridge && XPLMGetDatai(reports) == 200 && XPLMGetDatai(stale) == 0);
+CHECK(XPLMGetDataf(reportRate) > 99 && XPLMGetDataf(reportRate) < 101);
+CHECK(XPLMGetDataf(roundTrip) == 0 /* nothing set yet */);
+CHECK(radio.fMain == 121500 + 25 * 3 && radio.fStandby == 136975);
+
+// tuned in X-Plane: sent to the panel
+XPLMSetDatai(XPLMFindDataRef("sim/cockpit2/radios/actuators/com1_frequency_hz_833"), 122800);
+Harness::Fly(Callback::gPollingInterval);
+const std::optional<BridgeDatagram> set = forwarder.Receive(1000);
+CHECK(set && set->kind == BridgeDatagram::kSet && set->panels[0].values[0][0] == 122800);
+
+// a datagram overtaken by a newer one is counted; the first echoes the set, timing the round trip
+forwarder.Send(122800, 136975, false);
+forwarder.Send(122800, 136975, false, forwarder.fSequence - 1);
+Harness::Fly(Callback::gPollingInterval);
+CHECK(XPLMGetDatai(reports) == 201 && XPLMGetDatai(stale) == 1 && remote.Statistics().roundTrips == 1);
+
+// gone quiet: the rate falls to nothing within the window, and the round trip stays as it was
+Harness::Fly(2);
+CHECK(XPLMGetDatai(connection) == Telemetry::kBridge && XPLMGetDataf(reportRate) == 0);
+CHECK(XPLMGetDataf(roundTrip) > 0 && XPLMGetDataf(roundTrip) < 1000 /* ms */);
+
+// the datarefs are read-only
+CHECK(!XPLMCanWriteDataRef(reports));
+XPLMSetDatai(reports, 0);
+CHECK(XPLMGetDatai(reports) == 201);
+
+// a new connection starts counting again
+telemetry.Update(Telemetry::kUSB, 5000, 0, 0, 0, .5f);
+CHECK(XPLMGetDatai(connection) == Telemetry::kUSB && XPLMGetDataf(reportRate) == 0 && XPLMGetDataf(roundTrip) == 0);
+telemetry.Update(Telemetry::kUSB, 5500, 0, 0, 0, .5f);
+CHECK(XPLMGetDataf(reportRate) == 0);
+telemetry.Update(Telemetry::kUSB, 6000, 0, 0, 0, .5f);
+CHECK(XPLMGetDatai(reports) == 6000 && XPLMGetDataf(reportRate) == 1000);
+
+// withdrawn when the plugin stops
+dataRefs.reset();
+CHECK(!XPLMFindDataRef("xplanepanel/connection") && !XPLMFindDataRef("xplanepanel/round_trip_ms"));
+
+return Checked("telemetry");
+}
@@ -0,0 +1,438 @@
+/*
+	usb
+	
+	The USB stack (firmware/USB.cc) against a scripted USBD register model (test/nrf/nrf_usbd.h)
+	
+	The test plays the host: it sends SETUP packets and IN and OUT tokens, and completes each EasyDMA
+	transfer, while the panel's event loop runs the control transfer state machine as on the device.
+	Throughout, the USBD must never be given a second EasyDMA transfer while one is in progress.  Also
+	reports the state reports a second the host collects, and how long after a detent, as it polls.
+*/
+
+#include <deque>
+#include <random>
+
+#include "Capabilities.h"
+#include "Log.h"
+#include "emulator.h"
+#include "report.h"
+
+
+/*	PanelReport
+	Output report of the displayed values
+*/
+static std::vector<uint8_t> PanelReport(
+	unsigned	value0,
+	unsigned	value1,
+	uint8_t		reportID = 1
+	)
+{
+const uint64_t values = value0 | static_cast<uint64_t>(value1) << 20;
+std::vector<uint8_t> report = { reportID };
+for (unsigned i = 0; i < 5; i++) report.push_back(static_cast<uint8_t>(values >> 8 * i));
+
+return report;
+}
+
+
+/*	Logged
+	Take the records out of the log; return whether any has the given format
+*/
+static bool Logged(
+	Log::Format	format
+	)
+{
+uint8_t records[64 * Log::kEncodedRecord];
+uint16_t dropped;
+const size_t length = Log::Encode(records, sizeof records, dropped);
+
+bool found = false;
+for (size_t record = 0; record < length; record += Log::kEncodedRecord)
+	found |= (records[record + 4] | records[record + 5] << 8) == format;
+
+return found;
+}
+
+
+/*	Benchmark
+	Turn the knob so many detents a second, at random within each period, for a second of frames while the
+	host polls Endpoint 1 every so many; return whether every detent was reported
+*/
+static bool Benchmark(
+	unsigned	detentsPerSecond,
+	unsigned	interval	// frames
+	)
+{
+static constexpr uint32_t kFrame = 1000 /* us */, kFrames = 1000;
+
+std::mt19937 random(detentsPerSecond);
+const uint32_t period = 1000000 / detentsPerSecond;
+std::deque<uint32_t> turned;	// us at each detent not yet reported
+unsigned reports = 0, reported = 0, detents = 0;
+uint64_t total = 0;
+uint32_t maximum = 0;
+
+uint32_t next = random() % period;
+for (uint32_t frame = 1; frame <= kFrames; frame++) {
+	for (; next < frame * kFrame; next = (next / period + 1) * period + random() % period) {
+		HAL::QDEC::Turn(4);
+		Settle();
+		turned.push_back(next);
+		detents++;
+		}
+	
+	USBDModel::Frame(USBDModel::gFrame + 1);
+	Settle();
+	if (frame % interval != 0) continue;
+	
+	// the host collects whatever is armed at the start of the frame
+	const std::optional<std::vector<uint8_t>> in = USBDModel::In(1);
+	if (!in) continue;
+	reports++;
+	for (int16_t delta = (*in)[State::kOffsetDelta] | (*in)[State::kOffsetDelta + 1] << 8; delta > 0 && !turned.empty(); delta--) {
+		const uint32_t latency = frame * kFrame - turned.front();
+		total += latency;
+		maximum = std::max(maximum, latency);
+		turned.pop_front();
+		reported++;
+		}
+	Settle();
+	}
+
+printf("%u detents/s, polled every %u ms: %u reports/s, latency %.2f ms mean, %.2f ms maximum\n", detentsPerSecond, interval,
+	reports * 1000 / kFrames, reported ? total / 1e3 / reported : 0, maximum / 1e3);
+
+// collect what was left for the next poll
+for (std::optional<std::vector<uint8_t>> in; (in = USBDModel::In(1)); Settle())
+	reported += (*in)[State::kOffsetDelta] | (*in)[State::kOffsetDelta + 1] << 8;
+
+return reported == detents;
+}
+
+
+/*	main
+	Power up and enumerate, then try each kind of transfer
+*/
+int main()
+{
+Panel panel;
+PowerUp(panel);
+CHECK(USBDModel::gEnabled && USBDModel::gPullup && ClockModel::gRunning);
+
+// device descriptor, in one packet; and just its start, as a host first asks for
+unsigned packets;
+std::optional<std::vector<uint8_t>> data = ControlIn(0x80, 6 /* GET_DESCRIPTOR */, 0x0100, 0, 64, &packets);
+CHECK(data && data->size() == 18 && (*data)[0] == 18 && (*data)[1] == 1 && packets == 1);
+data = ControlIn(0x80, 6, 0x0100, 0, 8, &packets);
+CHECK(data && data->size() == 8 && packets == 1);
+
+// the configuration descriptor is exactly one packet, so asking for more takes a zero-length packet to end
+data = ControlIn(0x80, 6, 0x0200, 0, 9, &packets);
+CHECK(data && data->size() == 9 && packets == 1);
+const uint16_t configurationLength = (*data)[2] | (*data)[3] << 8;
+CHECK(configurationLength == USBDModel::kPacketSize);
+
+data = ControlIn(0x80, 6, 0x0200, 0, 255, &packets);
+CHECK(data && data->size() == configurationLength && packets == 2);
+data = ControlIn(0x80, 6, 0x0200, 0, configurationLength, &packets);
+CHECK(data && data->size() == configurationLength && packets == 1);
+
+// the HID descriptor gives the length of the report descriptor
+const uint16_t reportDescriptorLength = data ? (*data)[9 + 9 + 7] | (*data)[9 + 9 + 8] << 8 : 0;
+
+// unknown descriptor is stalled
+CHECK(!ControlIn(0x80, 6, 0x0700, 0, 64));
+
+CHECK(Configure());
+CHECK(USBDModel::gIn[1].enabled && USBDModel::gOut[1].enabled && USBDModel::gOut[1].ready);
+
+// polled before anything has changed, both reports have the panel's values
+const auto word = [](const std::vector<uint8_t> &report, size_t offset, unsigned n) {
+	uint32_t value = 0;
+	for (unsigned i = 0; i < n; i++) value |= report[offset + i] << 8 * i;
+	return value;
+	};
+const auto polled = [&word](const Panel &panel) {
+	const std::optional<std::vector<uint8_t>> values = ControlIn(0xa1, 1 /* GET_REPORT */, 0x0101, 0, 64);
+	const std::optional<std::vector<uint8_t>> state = ControlIn(0xa1, 1, 0x0105, 0, 64);
+	const uint64_t packed = values && values->size() == 6 ? word(*values, 1, 4) | static_cast<uint64_t>((*values)[5]) << 32 : 0;
+	return
+		values && state && state->size() == State::kReportLength && (*state)[0] == 5 /* kReportState */ &&
+		(packed & 0xfffff) == panel.Value() && packed >> 20 == panel.ValueStandby() &&
+		word(*state, State::kOffsetValues, 4) == panel.Value() && word(*state, State::kOffsetValues + 4, 4) == panel.ValueStandby() &&
+		word(*state, State::kOffsetKeys, 4) == panel.Keys() && word(*state, State::kOffsetDelta, 2) == 0;
+	};
+CHECK(panel.Value() != 0 && polled(panel));
+
+// ... and after a turn, without taking the detents still to be sent on Endpoint 1
+const unsigned standby = panel.ValueStandby();
+HAL::QDEC::Turn(4);
+Settle();
+HAL::QDEC::Turn(4);
+Settle();
+CHECK(panel.ValueStandby() != standby && polled(panel));
+data = USBDModel::In(1);
+CHECK(data && word(*data, State::kOffsetDelta, 2) == 1);
+Settle();
+data = USBDModel::In(1);
+CHECK(data && word(*data, State::kOffsetDelta, 2) == 1 && word(*data, State::kOffsetValues + 4, 4) == panel.ValueStandby());
+Settle();
+CHECK(!USBDModel::In(1));
+
+// SET_IDLE: GET_IDLE says it back, and the state is repeated, without detents, each 8 ms without a report
+const auto frames = [](unsigned n, unsigned &first) {
+	unsigned repeats = 0;
+	first = 0;
+	for (unsigned frame = 1; frame <= n; frame++) {
+		USBDModel::Frame(USBDModel::gFrame + 1);
+		Settle();
+		if (const std::optional<std::vector<uint8_t>> repeat = USBDModel::In(1)) {
+			CHECK((*repeat)[State::kOffsetDelta] == 0 && (*repeat)[State::kOffsetDelta + 1] == 0);
+			if (!repeats++) first = frame;
+			Settle();
+			}
+		}
+	return repeats;
+	};
+CHECK(ControlOut(0x21, 0x0a /* SET_IDLE */, 2 << 8 /* 8 ms, all reports */, 0, {}));
+data = ControlIn(0xa1, 2 /* GET_IDLE */, 0, 0, 1);
+CHECK(data && data->size() == 1 && (*data)[0] == 2);
+CHECK(USBDModel::gInterrupts & NRF_USBD_INT_SOF_MASK);
+unsigned first;
+CHECK(frames(40, first) == 5 && first == 8);
+
+// ... counting from the last report sent, whether repeated or not
+HAL::QDEC::Turn(4);
+Settle();
+CHECK(USBDModel::In(1));
+Settle();
+CHECK(frames(12, first) == 1 && first == 8);
+
+// ... and not for a report other than the state, nor with an idle rate of 0
+CHECK(!ControlOut(0x21, 0x0a, 2 << 8 | 1 /* kReportPanel */, 0, {}));
+CHECK(ControlOut(0x21, 0x0a, 0, 0, {}));
+CHECK(!(USBDModel::gInterrupts & NRF_USBD_INT_SOF_MASK));
+CHECK(frames(40, first) == 0);
+
+// what the firmware can do, as the host decodes it
+data = ControlIn(0xa1, 1 /* GET_REPORT */, 0x0306 /* Feature, kReportCapabilities */, 0, 64);
+CHECK(data && data->size() == Capabilities::kReportLength && (*data)[0] == 6);
+if (data) {
+	const PanelCapabilities capabilities = DecodeCapabilitiesReport(data->data(), data->size());
+	CHECK(capabilities.protocol == Capabilities::kProtocol && capabilities.stateLayout == State::kLayout);
+	CHECK(capabilities.pages == Panel::kPages && capabilities.interval == 1 && capabilities.curves == Acceleration::kCurves.size());
+	CHECK(capabilities.features == (Capabilities::kFeatureStateReport | Capabilities::kFeatureSync | Capabilities::kFeatureIdleRate |
+		Capabilities::kFeatureLowLatency | Capabilities::kFeatureProfile | Capabilities::kFeatureLog | Capabilities::kFeatureDiagnostics));
+	}
+
+// ... and the state report it says it sends, likewise
+data = ControlIn(0xa1, 1, 0x0105, 0, 64);
+if (data) {
+	const PanelState decoded = DecodeStateReport(data->data(), data->size());
+	CHECK(decoded.pages.size() == Panel::kPages && decoded.pages[0].first == panel.Value() && decoded.pages[0].second == panel.ValueStandby());
+	CHECK(decoded.keys == panel.Keys() && decoded.delta == 0);
+	}
+
+// report descriptor, in several packets
+data = ControlIn(0x81, 6, 0x2200, 0, 1024, &packets);
+CHECK(reportDescriptorLength > USBDModel::kPacketSize);
+CHECK(data && data->size() == reportDescriptorLength);
+CHECK(packets == reportDescriptorLength / USBDModel::kPacketSize + 1);
+
+// Output report through the control pipe, in one packet and in two
+CHECK(ControlOut(0x21, 9 /* SET_REPORT */, 0x0201, 0, PanelReport(121500, 122900)));
+CHECK(panel.Value() == 121500 && panel.ValueStandby() == 122900);
+
+std::vector<uint8_t> report = PanelReport(118000, 136975);
+report.resize(70);
+CHECK(ControlOut(0x21, 9, 0x0201, 0, report));
+CHECK(panel.Value() == 118000 && panel.ValueStandby() == 136975);
+
+// ... and of the wrong report ID is stalled
+CHECK(!ControlOut(0x21, 9, 0x0201, 0, PanelReport(121500, 122900, 7)));
+CHECK(panel.Value() == 118000);
+
+// settings Feature report; one with either setting out of range is stalled, and changes neither
+CHECK(ControlOut(0x21, 9, 0x0302, 0, { 2 /* kReportSettings */, 1, QDEC::kNormal, 0 }));
+CHECK(panel.AccelerationCurve() == 1 && panel.EncoderSampling() == QDEC::kNormal);
+CHECK(!ControlOut(0x21, 9, 0x0302, 0, { 2, 2, QDEC::kLowLatency + 1, 0 }));
+CHECK(panel.AccelerationCurve() == 1 && panel.EncoderSampling() == QDEC::kNormal);
+CHECK(!ControlOut(0x21, 9, 0x0302, 0, { 2, static_cast<uint8_t>(Acceleration::kCurves.size()), QDEC::kLowLatency, 0 }));
+CHECK(panel.AccelerationCurve() == 1 && panel.EncoderSampling() == QDEC::kNormal);
+data = ControlIn(0xa1, 1 /* GET_REPORT */, 0x0302, 0, 64);
+CHECK(data && data->size() == 4 && (*data)[1] == 1 && (*data)[2] == QDEC::kNormal);
+
+// the encoder turning while a DATA stage waits for the host is handled, and reported on Endpoint 1
+USBDModel::Setup(0x21, 9, 0x0201, 0, 6);
+Settle();
+const size_t reports = HAL::USBD::gReports.size();
+HAL::QDEC::Turn(4);
+Settle();
+CHECK(HAL::USBD::gReports.size() > reports);
+const std::optional<std::vector<uint8_t>> state = USBDModel::In(1);
+CHECK(state && state->size() == 64 && (*state)[0] == 5 /* kReportState */);
+Settle();
+CHECK(USBDModel::Out(0, PanelReport(121500, 122900)));
+Settle();
+CHECK(USBDModel::gStatus == USBDModel::kAcknowledged && panel.Value() == 121500);
+
+// a DATA stage the host abandons times out after 500 frames, across the wrap of the frame counter
+USBDModel::gFrame = 0x7ff - 200;
+USBDModel::Setup(0x21, 9, 0x0201, 0, 6);
+Settle();
+CHECK(USBDModel::gInterrupts & NRF_USBD_INT_SOF_MASK);
+Logged(Log::kLogControlTimeout);
+for (uint32_t frame = 1; frame <= 500; frame++) {
+	USBDModel::Frame(0x7ff - 200 + frame);
+	Settle();
+	}
+CHECK(USBDModel::gStatus == USBDModel::kNoStatus);
+USBDModel::Frame(0x7ff - 200 + 501);
+Settle();
+CHECK(USBDModel::gStatus == USBDModel::kStalled);
+CHECK(Logged(Log::kLogControlTimeout));
+CHECK(!(USBDModel::gInterrupts & NRF_USBD_INT_SOF_MASK));
+
+// a new SETUP abandons a control read halfway
+USBDModel::Setup(0x81, 6, 0x2200, 0, 1024);
+Settle();
+CHECK(USBDModel::In(0));
+Settle();
+data = ControlIn(0x80, 6, 0x0100, 0, 64);
+CHECK(data && data->size() == 18 && (*data)[1] == 1);
+
+// Output report on the interrupt endpoint; one of the wrong ID, or too short, is ignored
+CHECK(USBDModel::Out(1, PanelReport(118000, 136975)));
+Settle();
+CHECK(panel.Value() == 118000 && panel.ValueStandby() == 136975);
+
+Logged(Log::kLogOutputReportIgnored);
+CHECK(USBDModel::Out(1, PanelReport(121500, 122900, 7)));
+Settle();
+CHECK(USBDModel::Out(1, { 1, 0x9c, 0xda }));
+Settle();
+CHECK(panel.Value() == 118000);
+CHECK(Logged(Log::kLogOutputReportIgnored));
+CHECK(USBDModel::gOut[1].ready);
+
+// an Output report arriving while an Endpoint 0 transfer is in progress waits for it
+USBDModel::Setup(0x80, 6, 0x0100, 0, 64);
+gPanel->Run();
+CHECK(USBDModel::gDMA == NRF_USBD_TASK_STARTEPIN0);
+CHECK(USBDModel::Out(1, PanelReport(121500, 122900)));
+gPanel->Run();
+CHECK(USBDModel::gDMA == NRF_USBD_TASK_STARTEPIN0);
+CHECK(USBDModel::Transfer());
+gPanel->Run();
+CHECK(USBDModel::gDMA == NRF_USBD_TASK_STARTEPOUT1);
+Settle();
+CHECK(panel.Value() == 121500);
+CHECK(USBDModel::In(0));
+Settle();
+CHECK(USBDModel::gStatus == USBDModel::kAcknowledged);
+
+// a state report waits for an Endpoint 0 transfer to finish with EasyDMA
+USBDModel::Setup(0x80, 6, 0x0100, 0, 64);
+gPanel->Run();
+const uint16_t sequence = (*state)[4] | (*state)[5] << 8;
+USBEndpointIN1({ 1000, 121500, 122900, 2, 0 });
+CHECK(USBDModel::gDMA == NRF_USBD_TASK_STARTEPIN0);
+CHECK(!USBDModel::In(1));
+CHECK(USBDModel::Transfer());
+gPanel->Run();
+CHECK(USBDModel::gDMA == NRF_USBD_TASK_STARTEPIN1);
+Settle();
+
+// states changing while the host hasn't collected it are combined into one report, adding up the detents
+USBEndpointIN1({ 1010, 121525, 122900, 3, 0 });
+USBEndpointIN1({ 1020, 121550, 122900, -1, 1 << 4 });
+CHECK(USBDModel::gDMA < 0);
+
+// ... which is armed as soon as the host has the first
+const auto delta = [](const std::vector<uint8_t> &report) { return static_cast<int16_t>(report[6] | report[7] << 8); };
+std::optional<std::vector<uint8_t>> in = USBDModel::In(1);
+CHECK(in && (*in)[0] == 5 && (*in)[4] == static_cast<uint8_t>(sequence + 1) && delta(*in) == 2);
+Settle();
+in = USBDModel::In(1);
+CHECK(in && (*in)[4] == static_cast<uint8_t>(sequence + 2) && delta(*in) == 2 && (*in)[12] == 1 << 4);
+CHECK(in && ((*in)[16] | (*in)[17] << 8 | (*in)[18] << 16) == 121550);
+Settle();
+CHECK(!USBDModel::In(1));
+
+// ... and a state the host already has isn't sent again
+USBEndpointIN1({ 1030, 121550, 122900, 0, 1 << 4 });
+Settle();
+CHECK(!USBDModel::In(1));
+
+CHECK(USBDModel::In(0));
+Settle();
+CHECK(USBDModel::gStatus == USBDModel::kAcknowledged);
+
+// suspended, the display is shut down, the crystal stopped and the USBD put in low power
+static uint8_t configuration = 0;
+HAL::SPI::gDevice = [](const uint8_t *out, size_t length, uint8_t *in, size_t) {
+	for (size_t word = 0; word < length; word += 2)
+		if (out[word] == 0x04 /* configuration */) configuration = out[word + 1];
+	memset(in, 0, length);
+	};
+
+USBDModel::Suspend();
+Settle();
+CHECK(!(configuration & 1) && !ClockModel::gRunning && USBDModel::gLowPower);
+
+// turning the knob without the host allowing remote wakeup is noted, but nothing lights or is sent
+HAL::QDEC::Turn(4);
+Settle();
+CHECK(!(configuration & 1) && !ClockModel::gRunning && USBDModel::gLowPower);
+CHECK(USBDModel::gResumes == 0 && USBDModel::gDMA < 0 && !USBDModel::In(1));
+
+// ... until the host resumes the bus
+USBDModel::Resume();
+Settle();
+CHECK((configuration & 1) && ClockModel::gRunning && !USBDModel::gLowPower);
+in = USBDModel::In(1);
+CHECK(in && delta(*in) == 1);
+Settle();
+
+// with remote wakeup allowed, turning the knob wakes the host, and then lights the display and sends the state
+CHECK(ControlOut(0x00, 3 /* SET_FEATURE */, 1 /* DEVICE_REMOTE_WAKEUP */, 0, {}));
+USBDModel::Suspend();
+Settle();
+CHECK(!(configuration & 1) && !ClockModel::gRunning);
+Logged(Log::kLogUSBResume);
+
+HAL::QDEC::Turn(-4);
+Settle();
+CHECK(USBDModel::gResumes == 1 && !USBDModel::gSuspended);
+CHECK((configuration & 1) && ClockModel::gRunning && !USBDModel::gLowPower);
+in = USBDModel::In(1);
+CHECK(in && delta(*in) == -1);
+Settle();
+CHECK(Logged(Log::kLogUSBResume));
+
+// a bus reset ends suspend too; the state changed while suspended is kept, and sent once configured again
+USBDModel::Suspend();
+Settle();
+HAL::QDEC::Turn(4);
+Settle();
+USBDModel::Reset();
+Settle();
+CHECK((configuration & 1) && ClockModel::gRunning && USBDModel::gDMA < 0);
+CHECK(Configure());
+in = USBDModel::In(1);
+CHECK(in && delta(*in) == 1);
+Settle();
+
+// a knob turned at a leisurely and at a frantic pace, polled at the endpoint's interval and at the 10 ms it was
+CHECK(Benchmark(50, 1));
+CHECK(Benchmark(50, 10));
+CHECK(Benchmark(2000, 1));
+CHECK(Benchmark(2000, 10));
+
+// never two transfers at once, nor one with the USBD asleep
+CHECK(USBDModel::gOverlaps == 0);
+CHECK(USBDModel::gAsleep == 0);
+printf("%u EasyDMA transfers\n", USBDModel::gTransfers);
+
+return Checked("usb");
+}
@@ -0,0 +1,193 @@
+/*
+	usbfs
+	
+	The host's diagnostics reader (host/usbfs.cc) against the emulated panel
+	
+	The reader's usbfs calls are intercepted here: ioctl() is defined in this program, so the reader calls
+	it instead of the C library's.  Claiming the interface and bulk transfers on the diagnostics endpoints
+	go to the USBD model, as packets the host controller would send and receive, while the device file
+	itself is just /dev/null.
+*/
+
+#include <errno.h>
+#include <stdarg.h>
+#include <sys/ioctl.h>
+
+#include <linux/usbdevice_fs.h>
+
+#include "Diagnostics.h"
+#include "Log.h"
+#include "Profile.h"
+#include "emulator.h"
+#include "usbfs.h"
+
+
+static unsigned gClaimed = ~0u;		// interface claimed through usbfs
+static unsigned gPackets;		// bulk packets either way
+
+
+/*	BulkOut
+	Send the data on a bulk OUT endpoint; return the bytes sent, or -1 if the device doesn't take them
+*/
+static int BulkOut(
+	unsigned	endpoint,
+	const uint8_t	*const data,
+	unsigned	length
+	)
+{
+for (unsigned offset = 0; offset < length; offset += USBDModel::kPacketSize) {
+	const unsigned end = std::min<unsigned>(offset + USBDModel::kPacketSize, length);
+	if (!USBDModel::Out(endpoint, { data + offset, data + end })) return -1;
+	gPackets++;
+	Settle();
+	}
+
+return length;
+}
+
+
+/*	BulkIn
+	Read packets from a bulk IN endpoint until a short one, or the buffer is full; return the bytes read
+	
+	An endpoint that still has nothing after the device has settled has timed out.
+*/
+static int BulkIn(
+	unsigned	endpoint,
+	uint8_t		*const data,
+	unsigned	length
+	)
+{
+unsigned received = 0;
+for (;;) {
+	Settle();
+	const std::optional<std::vector<uint8_t>> packet = USBDModel::In(endpoint);
+	if (!packet) return -1;
+	gPackets++;
+	
+	// more than the host asked for is an overflow
+	if (received + packet->size() > length) return -1;
+	memcpy(data + received, packet->data(), packet->size());
+	received += packet->size();
+	
+	if (packet->size() < USBDModel::kPacketSize || received == length) break;
+	}
+
+Settle();
+return received;
+}
+
+
+/*	ioctl
+	The usbfs requests the reader makes
+*/
+extern "C" int ioctl(
+	int		,
+	unsigned long	request,
+	...
+	)
+{
+va_list arguments;
+va_start(arguments, request);
+void *const argument = va_arg(arguments, void*);
+va_end(arguments);
+
+int result = -1;
+switch (request) {
+	case USBDEVFS_CLAIMINTERFACE:
+		gClaimed = *static_cast<unsigned*>(argument);
+		result = 0;
+		break;
+	
+	case USBDEVFS_RELEASEINTERFACE:
+		if (*static_cast<unsigned*>(argument) == gClaimed) {
+			gClaimed = ~0u;
+			result = 0;
+			}
+		break;
+	
+	case USBDEVFS_BULK: {
+		const usbdevfs_bulktransfer &transfer = *static_cast<usbdevfs_bulktransfer*>(argument);
+		
+		// only on the claimed interface's endpoints
+		if (gClaimed != Diagnostics::kInterface || (transfer.ep & 0x7f) != Diagnostics::kEndpoint) {
+			errno = EINVAL;
+			return -1;
+			}
+		
+		result = transfer.ep & 0x80 ?
+			BulkIn(transfer.ep & 0x7f, static_cast<uint8_t*>(transfer.data), transfer.len) :
+			BulkOut(transfer.ep, static_cast<const uint8_t*>(transfer.data), transfer.len);
+		if (result < 0) errno = ETIMEDOUT;
+		return result;
+		}
+	}
+
+if (result < 0) errno = ENOTTY;
+return result;
+}
+
+
+/*	main
+
+*/
+int main()
+{
+Panel panel;
+PowerUp(panel);
+CHECK(Configure());
+
+// empty the log of starting up
+unsigned dropped;
+{
+	DiagnosticsReader reader("/dev/null");
+	CHECK(gClaimed == Diagnostics::kInterface);
+	(void) reader.Log(dropped);
+	}
+CHECK(gClaimed == ~0u);
+
+DiagnosticsReader reader("/dev/null");
+
+// a few records, in one packet
+Log::Write(Log::kLogDiagnosticsCommand, 42);
+Log::Write(Log::kLogControlTimeout, 3, 6);
+gPackets = 0;
+std::vector<LogRecord> records = reader.Log(dropped);
+CHECK(records.size() == 2 && dropped == 0);
+CHECK(records.size() == 2 && FormatLogRecord(records[1]) == "control transfer abandoned at byte 3 of 6");
+CHECK(gPackets == 1 + 1);
+
+// a full log takes a response of many packets, and what doesn't fit is left for the next
+for (uint32_t n = 0; n < 64; n++) Log::Write(Log::kLogStateSaved, 0, n);
+const unsigned fit = (Diagnostics::kResponseLength - Diagnostics::kHeaderLength) / Log::kEncodedRecord;
+gPackets = 0;
+records = reader.Log(dropped);
+CHECK(records.size() == fit && records.back().arguments[1] == fit - 1);
+CHECK(gPackets == 1 + (Diagnostics::kHeaderLength + fit * Log::kEncodedRecord + USBDModel::kPacketSize - 1) / USBDModel::kPacketSize);
+records = reader.Log(dropped);
+CHECK(records.size() == 64 - fit && records.front().arguments[1] == fit);
+CHECK(reader.Log(dropped).empty());
+
+// cycle counts of the probes the emulated panel has been through
+const std::vector<ProbeStatistics> probes = reader.Profile();
+CHECK(probes.size() == Profile::kProbes);
+CHECK(probes.size() == Profile::kProbes && probes[Profile::kUSBSetup0].count == Profile::Probed(Profile::kUSBSetup0).count);
+CHECK(probes.size() == Profile::kProbes && probes[Profile::kUSBSetup0].count > 0);
+
+// the HID interface carries on alongside
+const std::optional<std::vector<uint8_t>> descriptor = ControlIn(0x80, 6, 0x0100, 0, 18);
+CHECK(descriptor && descriptor->size() == 18);
+CHECK(reader.Log(dropped).empty());
+
+// an unknown command gets no response, and is logged
+uint8_t command = 99, response[64];
+usbdevfs_bulktransfer out = { Diagnostics::kEndpoint, 1, 1000, &command };
+CHECK(ioctl(-1, USBDEVFS_BULK, &out) == 1);
+usbdevfs_bulktransfer in = { 0x80 | Diagnostics::kEndpoint, sizeof response, 1000, response };
+CHECK(ioctl(-1, USBDEVFS_BULK, &in) < 0 && errno == ETIMEDOUT);
+records = reader.Log(dropped);
+CHECK(records.size() == 1 && records[0].format == Log::kLogDiagnosticsCommand && records[0].arguments[0] == 99);
+
+CHECK(USBDModel::gOverlaps == 0);
+
+return Checked("usbfs");
+}
@@ -0,0 +1,7 @@
+/*
+	gl
+	
+	Stands in for OpenGL's header, which xplane.h includes; the headless harness doesn't draw
+*/
+
+#pragma once
@@ -0,0 +1,83 @@
+/*
+	XPLMDisplay
+	
+	The part of the X-Plane SDK's display API the plugin uses, for the headless harness (harness.h)
+	
+	Declared only; the harness has no screen, so a test can't open a window.
+*/
+
+#pragma once
+
+extern "C" {
+
+typedef void	*XPLMWindowID;
+typedef int	XPLMMouseStatus;
+typedef int	XPLMKeyFlags;
+
+enum {
+	xplm_CursorDefault = 0,
+	xplm_CursorHidden = 1,
+	xplm_CursorArrow = 2,
+	xplm_CursorCustom = 3
+	};
+typedef int	XPLMCursorStatus;
+
+enum {
+	xplm_WindowLayerFlightOverlay = 0,
+	xplm_WindowLayerFloatingWindows = 1,
+	xplm_WindowLayerModal = 2,
+	xplm_WindowLayerGrowlNotifications = 3
+	};
+typedef int	XPLMWindowLayer;
+
+enum {
+	xplm_WindowDecorationNone = 0,
+	xplm_WindowDecorationRoundRectangle = 1,
+	xplm_WindowDecorationSelfDecorated = 2,
+	xplm_WindowDecorationSelfDecoratedResizable = 3
+	};
+typedef int	XPLMWindowDecoration;
+
+enum {
+	xplm_WindowPositionFree = 0,
+	xplm_WindowCenterOnMonitor = 1,
+	xplm_WindowFullScreenOnMonitor = 2,
+	xplm_WindowFullScreenOnAllMonitors = 3,
+	xplm_WindowPopOut = 4,
+	xplm_WindowVR = 5
+	};
+typedef int	XPLMWindowPositioningMode;
+
+typedef void	(*XPLMDrawWindow_f)(XPLMWindowID inWindowID, void *inRefcon);
+typedef void	(*XPLMHandleKey_f)(XPLMWindowID inWindowID, char inKey, XPLMKeyFlags inFlags, char inVirtualKey, void *inRefcon, int losingFocus);
+typedef int	(*XPLMHandleMouseClick_f)(XPLMWindowID inWindowID, int x, int y, XPLMMouseStatus inMouse, void *inRefcon);
+typedef XPLMCursorStatus (*XPLMHandleCursor_f)(XPLMWindowID inWindowID, int x, int y, void *inRefcon);
+typedef int	(*XPLMHandleMouseWheel_f)(XPLMWindowID inWindowID, int x, int y, int wheel, int clicks, void *inRefcon);
+
+struct XPLMCreateWindow_t {
+	int		structSize;
+	int		left,
+			top,
+			right,
+			bottom;
+	int		visible;
+	XPLMDrawWindow_f drawWindowFunc;
+	XPLMHandleMouseClick_f handleMouseClickFunc;
+	XPLMHandleKey_f	handleKeyFunc;
+	XPLMHandleCursor_f handleCursorFunc;
+	XPLMHandleMouseWheel_f handleMouseWheelFunc;
+	void		*refcon;
+	XPLMWindowDecoration decorateAsFloatingWindow;
+	XPLMWindowLayer	layer;
+	XPLMHandleMouseClick_f handleRightClickFunc;
+	};
+
+XPLMWindowID	XPLMCreateWindowEx(XPLMCreateWindow_t *inParams);
+void		XPLMDestroyWindow(XPLMWindowID inWindowID);
+void		XPLMGetScreenBoundsGlobal(int *outLeft, int *outTop, int *outRight, int *outBottom);
+void		XPLMGetWindowGeometry(XPLMWindowID inWindowID, int *outLeft, int *outTop, int *outRight, int *outBottom);
+void		XPLMSetWindowResizingLimits(XPLMWindowID inWindowID, int inMinWidthBoxels, int inMinHeightBoxels, int inMaxWidthBoxels, int inMaxHeightBoxels);
+void		XPLMSetWindowPositioningMode(XPLMWindowID inWindowID, XPLMWindowPositioningMode inPositioningMode, int inMonitorIndex);
+void		XPLMSetWindowTitle(XPLMWindowID inWindowID, const char *inWindowTitle);
+
+}
@@ -0,0 +1,22 @@
+/*
+	XPLMGraphics
+	
+	The part of the X-Plane SDK's graphics API the plugin uses, for the headless harness (harness.h)
+	
+	Declared only; the harness doesn't draw.
+*/
+
+#pragma once
+
+extern "C" {
+
+enum {
+	xplmFont_Basic = 0,
+	xplmFont_Proportional = 18
+	};
+typedef int	XPLMFontID;
+
+void		XPLMSetGraphicsState(int inEnableFog, int inNumberTexUnits, int inEnableLighting, int inEnableAlphaTesting, int inEnableAlphaBlending, int inEnableDepthTesting, int inEnableDepthWriting);
+void		XPLMDrawString(float *inColorRGB, int inXOffset, int inYOffset, char *inChar, int *inWordWrapWidth, XPLMFontID inFontID);
+
+}
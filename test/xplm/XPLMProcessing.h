@@ -0,0 +1,32 @@
+/*
+	XPLMProcessing
+	
+	The part of the X-Plane SDK's flight loop API the plugin uses, for the headless harness (harness.h)
+*/
+
+#pragma once
+
+extern "C" {
+
+typedef void	*XPLMFlightLoopID;
+
+enum {
+	xplm_FlightLoop_Phase_BeforeFlightModel = 0,
+	xplm_FlightLoop_Phase_AfterFlightModel = 1
+	};
+typedef int	XPLMFlightLoopPhaseType;
+
+typedef float	(*XPLMFlightLoop_f)(float inElapsedSinceLastCall, float inElapsedTimeSinceLastFlightLoop, int inCounter, void *inRefcon);
+
+struct XPLMCreateFlightLoop_t {
+	int		structSize;
+	XPLMFlightLoopPhaseType phase;
+	XPLMFlightLoop_f callbackFunc;
+	void		*refcon;
+	};
+
+XPLMFlightLoopID XPLMCreateFlightLoop(XPLMCreateFlightLoop_t *inParams);
+void		XPLMDestroyFlightLoop(XPLMFlightLoopID inFlightLoopID);
+void		XPLMScheduleFlightLoop(XPLMFlightLoopID inFlightLoopID, float inInterval, int inRelativeToNow);
+
+}
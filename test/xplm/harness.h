@@ -0,0 +1,266 @@
+/*
+	harness
+	
+	Headless X-Plane, for the host tests to load the plugin's parts into
+	
+	Keeps a dataref registry and runs flight loops on a simulated clock, frame by frame, as X-Plane does;
+	other plugins reading datarefs are the test calling XPLMFindDataRef and XPLMGetData.  Only the part of
+	the SDK the plugin uses is declared (the XPLM headers here), and windows and drawing aren't there at all.
+	Included by one test program only, since it defines the SDK's functions.
+*/
+
+#pragma once
+
+#include <map>
+#include <string>
+
+#include "XPLMDataAccess.h"
+#include "XPLMProcessing.h"
+
+
+/*	Harness
+	Simulator state
+*/
+namespace Harness {
+	/*	DataRef
+		Registered dataref
+	*/
+	struct DataRef {
+		XPLMDataTypeID	type;
+		bool		writable;
+		XPLMGetDatai_f	readInt;
+		XPLMSetDatai_f	writeInt;
+		XPLMGetDataf_f	readFloat;
+		XPLMSetDataf_f	writeFloat;
+		void		*readRefcon,
+				*writeRefcon;
+		};
+	
+	
+	/*	FlightLoop
+		Created flight loop, and when it is next due
+	*/
+	struct FlightLoop {
+		XPLMCreateFlightLoop_t params;
+		bool		scheduled;
+		float		due,		// simulated seconds, if scheduled in time
+				last;		// when it was last called, or created
+		int		frames;		// frames until due, if scheduled in frames
+		};
+	
+	
+	constexpr float kFrame = 1 / 60.f;	// seconds per frame
+	
+	inline std::map<std::string, DataRef> gDataRefs;
+	inline std::map<FlightLoop*, bool> gFlightLoops;
+	inline float gNow;			// simulated seconds
+	inline int gCounter;			// frames run
+	
+	void		Fly(float seconds);
+	}
+
+
+/*	Fly
+	Run frames for the simulated seconds, calling every flight loop that comes due
+*/
+void Harness::Fly(
+	float		seconds
+	)
+{
+for (const float end = gNow + seconds; gNow + kFrame / 2 < end;) {
+	gNow += kFrame;
+	gCounter++;
+	
+	for (auto &[loop, unused] : gFlightLoops) {
+		if (!loop->scheduled || (loop->frames > 0 ? --loop->frames > 0 : loop->due > gNow + kFrame / 2)) continue;
+		
+		const float interval = loop->params.callbackFunc(gNow - loop->last, kFrame, gCounter, loop->params.refcon);
+		loop->last = gNow;
+		XPLMScheduleFlightLoop(loop, interval, true);
+		}
+	}
+}
+
+
+extern "C" {
+
+/*	XPLMRegisterDataAccessor
+	Publish a dataref; only int and float ones are supported
+*/
+XPLMDataRef XPLMRegisterDataAccessor(
+	const char	*inDataName,
+	XPLMDataTypeID	inDataType,
+	int		inIsWritable,
+	XPLMGetDatai_f	inReadInt,
+	XPLMSetDatai_f	inWriteInt,
+	XPLMGetDataf_f	inReadFloat,
+	XPLMSetDataf_f	inWriteFloat,
+	XPLMGetDatad_f,
+	XPLMSetDatad_f,
+	XPLMGetDatavi_f,
+	XPLMSetDatavi_f,
+	XPLMGetDatavf_f,
+	XPLMSetDatavf_f,
+	XPLMGetDatab_f,
+	XPLMSetDatab_f,
+	void		*inReadRefcon,
+	void		*inWriteRefcon
+	)
+{
+const auto [entry, added] = Harness::gDataRefs.emplace(inDataName,
+	Harness::DataRef{ inDataType, inIsWritable != 0, inReadInt, inWriteInt, inReadFloat, inWriteFloat, inReadRefcon, inWriteRefcon });
+
+// X-Plane keeps the first owner of a name
+return added ? &entry->second : nullptr;
+}
+
+
+/*	XPLMUnregisterDataRef
+	Withdraw a dataref
+*/
+void XPLMUnregisterDataRef(
+	XPLMDataRef	inDataRef
+	)
+{
+for (auto entry = Harness::gDataRefs.begin(); entry != Harness::gDataRefs.end(); ++entry)
+	if (&entry->second == inDataRef) {
+		Harness::gDataRefs.erase(entry);
+		break;
+		}
+}
+
+
+/*	XPLMFindDataRef
+	Look up a dataref by name
+*/
+XPLMDataRef XPLMFindDataRef(
+	const char	*inDataRefName
+	)
+{
+const auto entry = Harness::gDataRefs.find(inDataRefName);
+
+return entry != Harness::gDataRefs.end() ? &entry->second : nullptr;
+}
+
+
+/*	XPLMCanWriteDataRef
+	Whether a dataref takes writes
+*/
+int XPLMCanWriteDataRef(
+	XPLMDataRef	inDataRef
+	)
+{
+return inDataRef && static_cast<const Harness::DataRef*>(inDataRef)->writable;
+}
+
+
+/*	XPLMGetDataRefTypes
+	Types a dataref can be read as
+*/
+XPLMDataTypeID XPLMGetDataRefTypes(
+	XPLMDataRef	inDataRef
+	)
+{
+return inDataRef ? static_cast<const Harness::DataRef*>(inDataRef)->type : xplmType_Unknown;
+}
+
+
+/*	XPLMGetDatai
+	Read an int dataref; 0 if it can't be
+*/
+int XPLMGetDatai(
+	XPLMDataRef	inDataRef
+	)
+{
+const auto *const dataRef = static_cast<const Harness::DataRef*>(inDataRef);
+
+return dataRef && dataRef->readInt ? dataRef->readInt(dataRef->readRefcon) : 0;
+}
+
+
+/*	XPLMSetDatai
+	Write an int dataref, if it takes writes
+*/
+void XPLMSetDatai(
+	XPLMDataRef	inDataRef,
+	int		inValue
+	)
+{
+const auto *const dataRef = static_cast<const Harness::DataRef*>(inDataRef);
+
+if (dataRef && dataRef->writable && dataRef->writeInt) dataRef->writeInt(dataRef->writeRefcon, inValue);
+}
+
+
+/*	XPLMGetDataf
+	Read a float dataref; 0 if it can't be
+*/
+float XPLMGetDataf(
+	XPLMDataRef	inDataRef
+	)
+{
+const auto *const dataRef = static_cast<const Harness::DataRef*>(inDataRef);
+
+return dataRef && dataRef->readFloat ? dataRef->readFloat(dataRef->readRefcon) : 0;
+}
+
+
+/*	XPLMSetDataf
+	Write a float dataref, if it takes writes
+*/
+void XPLMSetDataf(
+	XPLMDataRef	inDataRef,
+	float		inValue
+	)
+{
+const auto *const dataRef = static_cast<const Harness::DataRef*>(inDataRef);
+
+if (dataRef && dataRef->writable && dataRef->writeFloat) dataRef->writeFloat(dataRef->writeRefcon, inValue);
+}
+
+
+/*	XPLMCreateFlightLoop
+	Create a flight loop, not scheduled yet
+*/
+XPLMFlightLoopID XPLMCreateFlightLoop(
+	XPLMCreateFlightLoop_t *inParams
+	)
+{
+Harness::FlightLoop *const loop = new Harness::FlightLoop{ *inParams, false, 0, Harness::gNow, 0 };
+Harness::gFlightLoops.emplace(loop, true);
+
+return loop;
+}
+
+
+/*	XPLMDestroyFlightLoop
+	Stop calling a flight loop, and forget it
+*/
+void XPLMDestroyFlightLoop(
+	XPLMFlightLoopID inFlightLoopID
+	)
+{
+Harness::FlightLoop *const loop = static_cast<Harness::FlightLoop*>(inFlightLoopID);
+
+Harness::gFlightLoops.erase(loop);
+delete loop;
+}
+
+
+/*	XPLMScheduleFlightLoop
+	Call a flight loop after seconds (positive), frames (negative), or not at all (zero)
+*/
+void XPLMScheduleFlightLoop(
+	XPLMFlightLoopID inFlightLoopID,
+	float		inInterval,
+	int		inRelativeToNow
+	)
+{
+Harness::FlightLoop *const loop = static_cast<Harness::FlightLoop*>(inFlightLoopID);
+
+loop->scheduled = inInterval != 0;
+loop->frames = inInterval < 0 ? static_cast<int>(-inInterval) : 0;
+loop->due = (inRelativeToNow ? Harness::gNow : loop->last) + (inInterval > 0 ? inInterval : 0);
+}
+
+}